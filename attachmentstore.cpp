@@ -0,0 +1,421 @@
+//attachmentstore.cpp
+#include "attachmentstore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QDebug>
+#include <algorithm>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const qint64 kDefaultQuotaMB = 2048;
+const int kMaxRememberedFiles = 4096;
+const int kSaveDelayMs = 2000;
+
+} // namespace
+
+AttachmentStore::AttachmentStore(QObject *parent)
+    : QObject(parent)
+{
+    QSettings settings("YourCompany", "VoIPClient");
+    quota = settings.value("attachmentQuotaMB", kDefaultQuotaMB).toLongLong() * 1024 * 1024;
+
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(kSaveDelayMs);
+    connect(&saveTimer, &QTimer::timeout, this, &AttachmentStore::save);
+
+    root = rootPath();
+    load();
+}
+
+AttachmentStore::~AttachmentStore()
+{
+    if (saveTimer.isActive()) {
+        save();
+    }
+}
+
+QString AttachmentStore::rootPath() const
+{
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataPath.isEmpty()) {
+        qWarning() << "Failed to get writable location";
+        return QString();
+    }
+
+    QDir dir(dataPath);
+    if (!dir.mkpath("blobs")) {
+        qWarning() << "Failed to create directory:" << dir.filePath("blobs");
+        return QString();
+    }
+    return dir.filePath("blobs");
+}
+
+QString AttachmentStore::blobPathLocked(const QByteArray &sha256) const
+{
+    if (root.isEmpty() || sha256.size() < 2) return QString();
+    return QDir(root).filePath(QString::fromLatin1(sha256.left(2)) + "/" + QString::fromLatin1(sha256));
+}
+
+QString AttachmentStore::blobPath(const QByteArray &sha256) const
+{
+    QMutexLocker locker(&mutex);
+    return blobPathLocked(sha256);
+}
+
+bool AttachmentStore::contains(const QByteArray &sha256) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.constFind(sha256);
+    return it != entries.cend() && it->hasBlob;
+}
+
+bool AttachmentStore::isUploaded(const QByteArray &sha256, const QString &server) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.constFind(sha256);
+    return it != entries.cend() && it->uploadedTo.contains(server);
+}
+
+bool AttachmentStore::hasUploadedOfSize(qint64 size, const QString &server) const
+{
+    QMutexLocker locker(&mutex);
+    return std::any_of(entries.cbegin(), entries.cend(), [size, &server](const Entry &entry) {
+        return entry.size == size && entry.uploadedTo.contains(server);
+    });
+}
+
+void AttachmentStore::markUploaded(const QByteArray &sha256, qint64 size, const QString &server)
+{
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[sha256];
+    entry.size = size;
+    entry.uploadedTo.insert(server);
+    entry.lastAccess = QDateTime::currentSecsSinceEpoch();
+    scheduleSave();
+}
+
+QString AttachmentStore::fileKey(const QString &filePath)
+{
+    const QFileInfo info(filePath);
+    return QString("%1|%2|%3").arg(info.canonicalFilePath())
+        .arg(info.size())
+        .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QByteArray AttachmentStore::knownHashForFile(const QString &filePath) const
+{
+    const QString key = fileKey(filePath);
+    QMutexLocker locker(&mutex);
+    return fileHashes.value(key);
+}
+
+void AttachmentStore::rememberFileHash(const QString &filePath, const QByteArray &sha256)
+{
+    const QString key = fileKey(filePath);
+    QMutexLocker locker(&mutex);
+    if (fileHashes.size() >= kMaxRememberedFiles) {
+        fileHashes.clear();
+    }
+    fileHashes.insert(key, sha256);
+    scheduleSave();
+}
+
+bool AttachmentStore::adopt(const QString &sourcePath, const QByteArray &sha256, const QString &conversation)
+{
+    QString target;
+    {
+        QMutexLocker locker(&mutex);
+        target = blobPathLocked(sha256);
+        if (target.isEmpty()) return false;
+
+        Entry &entry = entries[sha256];
+        entry.lastAccess = QDateTime::currentSecsSinceEpoch();
+        ++entry.refs[conversation];
+        scheduleSave();
+
+        if (entry.hasBlob && QFile::exists(target)) {
+            QFile::remove(sourcePath);
+            return true;
+        }
+    }
+
+    // The move can be a full copy across filesystems, so it goes to a
+    // private name next to the blob without holding the lock; only the
+    // final same-directory rename happens under it.
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    const QString staging = target + "." + QUuid::createUuid().toString(QUuid::Id128) + ".tmp";
+    if (!QFile::rename(sourcePath, staging)) {
+        if (!cloneFile(sourcePath, staging)) {
+            qWarning() << "Failed to move attachment into store:" << sourcePath;
+            QFile::remove(staging);
+            return false;
+        }
+        QFile::remove(sourcePath);
+    }
+
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[sha256];
+    if (entry.hasBlob && QFile::exists(target)) {
+        // Another adopt of the same hash got there first.
+        QFile::remove(staging);
+        return true;
+    }
+    QFile::remove(target);
+    if (!QFile::rename(staging, target)) {
+        qWarning() << "Failed to move attachment into store:" << staging;
+        QFile::remove(staging);
+        return false;
+    }
+
+    // Read-only keeps the blob matching its hash.
+    QFile::setPermissions(target, QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+
+    if (entry.hasBlob) storedBytes -= entry.size;
+    entry.hasBlob = true;
+    entry.size = QFileInfo(target).size();
+    storedBytes += entry.size;
+    scheduleSave();
+    return true;
+}
+
+bool AttachmentStore::linkOut(const QByteArray &sha256, const QString &destination)
+{
+    QString source;
+    {
+        QMutexLocker locker(&mutex);
+        auto it = entries.find(sha256);
+        if (it == entries.end() || !it->hasBlob) return false;
+        it->lastAccess = QDateTime::currentSecsSinceEpoch();
+        source = blobPathLocked(sha256);
+        scheduleSave();
+    }
+    return cloneFile(source, destination);
+}
+
+void AttachmentStore::addRef(const QByteArray &sha256, const QString &conversation)
+{
+    QMutexLocker locker(&mutex);
+    Entry &entry = entries[sha256];
+    ++entry.refs[conversation];
+    entry.lastAccess = QDateTime::currentSecsSinceEpoch();
+    scheduleSave();
+}
+
+QString AttachmentStore::conversationKey(const QString &accountId, const QString &peer)
+{
+    return accountId + '/' + peer;
+}
+
+bool AttachmentStore::hasLegacyRefs() const
+{
+    QMutexLocker locker(&mutex);
+    for (const Entry &entry : entries) {
+        for (auto ref = entry.refs.cbegin(); ref != entry.refs.cend(); ++ref) {
+            if (!ref.key().contains('/')) return true;
+        }
+    }
+    return false;
+}
+
+void AttachmentStore::adoptLegacyRefs(const QString &accountId)
+{
+    QMutexLocker locker(&mutex);
+    for (Entry &entry : entries) {
+        QHash<QString, int> rekeyed;
+        for (auto ref = entry.refs.cbegin(); ref != entry.refs.cend(); ++ref) {
+            const QString key = ref.key().contains('/') ? ref.key() : conversationKey(accountId, ref.key());
+            rekeyed[key] += ref.value();
+        }
+        entry.refs = rekeyed;
+    }
+    scheduleSave();
+}
+
+void AttachmentStore::releaseConversation(const QString &conversation)
+{
+    {
+        QMutexLocker locker(&mutex);
+        for (Entry &entry : entries) {
+            entry.refs.remove(conversation);
+        }
+        scheduleSave();
+    }
+    enforceQuota();
+}
+
+qint64 AttachmentStore::quotaBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return quota;
+}
+
+void AttachmentStore::setQuotaBytes(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&mutex);
+        quota = bytes;
+    }
+    QSettings settings("YourCompany", "VoIPClient");
+    settings.setValue("attachmentQuotaMB", bytes / (1024 * 1024));
+    enforceQuota();
+}
+
+void AttachmentStore::enforceQuota()
+{
+    qint64 stored;
+    qint64 limit;
+    {
+        QMutexLocker locker(&mutex);
+        if (storedBytes <= quota) return;
+
+        // Only unreferenced blobs, least recently used first. A blob a
+        // conversation still shows has to stay so it can be forwarded by hash.
+        QList<QByteArray> candidates;
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            if (it->hasBlob && it->refs.isEmpty()) candidates.append(it.key());
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](const QByteArray &a, const QByteArray &b) {
+            return entries[a].lastAccess < entries[b].lastAccess;
+        });
+
+        for (const QByteArray &hash : std::as_const(candidates)) {
+            if (storedBytes <= quota) break;
+            Entry &entry = entries[hash];
+            QFile::remove(blobPathLocked(hash));
+            entry.hasBlob = false;
+            storedBytes -= entry.size;
+            if (entry.uploadedTo.isEmpty()) {
+                entries.remove(hash);
+            }
+        }
+        scheduleSave();
+        stored = storedBytes;
+        limit = quota;
+    }
+    if (stored > limit) emit quotaExceeded(stored, limit);
+}
+
+bool AttachmentStore::cloneFile(const QString &source, const QString &destination)
+{
+    if (QFile::exists(destination)) return false;
+
+#if defined(Q_OS_LINUX)
+    // Copy-on-write clone where the filesystem supports it (btrfs, XFS).
+    const QByteArray src = QFile::encodeName(source);
+    const QByteArray dst = QFile::encodeName(destination);
+    const int in = ::open(src.constData(), O_RDONLY | O_CLOEXEC);
+    if (in >= 0) {
+        const int out = ::open(dst.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (out >= 0) {
+            const bool cloned = ::ioctl(out, FICLONE, in) == 0;
+            ::close(out);
+            if (cloned) {
+                ::close(in);
+                return true;
+            }
+            ::unlink(dst.constData());
+        }
+        ::close(in);
+    }
+#endif
+
+    // A plain copy otherwise. Never a hard link: the copy is the user's to
+    // edit, and blobs are read-only.
+    if (!QFile::copy(source, destination)) return false;
+    QFile::setPermissions(destination, QFile::permissions(destination) | QFileDevice::WriteOwner);
+    return true;
+}
+
+void AttachmentStore::scheduleSave()
+{
+    QMetaObject::invokeMethod(this, [this]() { saveTimer.start(); }, Qt::QueuedConnection);
+}
+
+void AttachmentStore::load()
+{
+    if (root.isEmpty()) return;
+
+    QFile file(QDir(root).filePath("index.json"));
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const QJsonObject index = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonObject blobs = index["blobs"].toObject();
+    for (auto it = blobs.constBegin(); it != blobs.constEnd(); ++it) {
+        const QJsonObject object = it.value().toObject();
+        Entry entry;
+        entry.size = qint64(object["size"].toDouble());
+        // Indexes from before uploads were tracked per server carry a bare
+        // "uploaded" flag; it cannot say which server, so it is dropped and
+        // the file is streamed again once.
+        for (const QJsonValue &server : object["uploadedTo"].toArray()) {
+            entry.uploadedTo.insert(server.toString());
+        }
+        entry.lastAccess = qint64(object["atime"].toDouble());
+        const QJsonObject refs = object["refs"].toObject();
+        for (auto ref = refs.constBegin(); ref != refs.constEnd(); ++ref) {
+            entry.refs.insert(ref.key(), ref.value().toInt());
+        }
+
+        const QByteArray hash = it.key().toLatin1();
+        entry.hasBlob = object["blob"].toBool() && QFile::exists(blobPathLocked(hash));
+        if (entry.hasBlob) {
+            storedBytes += entry.size;
+        }
+        entries.insert(hash, entry);
+    }
+
+    const QJsonObject files = index["files"].toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        fileHashes.insert(it.key(), it.value().toString().toLatin1());
+    }
+}
+
+void AttachmentStore::save()
+{
+    QJsonObject blobs;
+    QJsonObject files;
+    {
+        QMutexLocker locker(&mutex);
+        if (root.isEmpty()) return;
+
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            QJsonObject refs;
+            for (auto ref = it->refs.cbegin(); ref != it->refs.cend(); ++ref) {
+                refs.insert(ref.key(), ref.value());
+            }
+            blobs.insert(QString::fromLatin1(it.key()),
+                         QJsonObject{{"size", it->size},
+                                     {"blob", it->hasBlob},
+                                     {"uploadedTo", QJsonArray::fromStringList(it->uploadedTo.values())},
+                                     {"atime", it->lastAccess},
+                                     {"refs", refs}});
+        }
+        for (auto it = fileHashes.cbegin(); it != fileHashes.cend(); ++it) {
+            files.insert(it.key(), QString::fromLatin1(it.value()));
+        }
+    }
+
+    QSaveFile file(QDir(root).filePath("index.json"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open attachment index for writing:" << file.fileName();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{{"blobs", blobs}, {"files", files}}).toJson(QJsonDocument::Compact));
+    file.commit();
+}
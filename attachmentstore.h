@@ -0,0 +1,95 @@
+//attachmentstore.h
+#ifndef ATTACHMENTSTORE_H
+#define ATTACHMENTSTORE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+// Local content-addressed store for chat attachments, keyed by SHA-256.
+// Blobs live under <AppData>/blobs/<aa>/<hash>. Each blob counts references
+// per conversation; clearing a chat drops that conversation's references.
+// When the store exceeds its quota, unreferenced blobs are evicted, least
+// recently used first; blobs a conversation still shows are never evicted,
+// and quotaExceeded() is emitted instead. The store also remembers which
+// hashes each server already has and the hash of recently sent local files,
+// so a re-send can go out as a bare hash. One store serves every signed-in
+// account; callers key conversations per account. All methods are
+// thread-safe.
+class AttachmentStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AttachmentStore(QObject *parent = nullptr);
+    ~AttachmentStore();
+
+    bool contains(const QByteArray &sha256) const;
+    QString blobPath(const QByteArray &sha256) const;
+
+    // server is AccountData::server; a hash one PBX holds says nothing
+    // about another.
+    bool isUploaded(const QByteArray &sha256, const QString &server) const;
+    bool hasUploadedOfSize(qint64 size, const QString &server) const;
+    void markUploaded(const QByteArray &sha256, qint64 size, const QString &server);
+
+    // Hash of a local file seen before with the same size and mtime.
+    QByteArray knownHashForFile(const QString &filePath) const;
+    void rememberFileHash(const QString &filePath, const QByteArray &sha256);
+
+    // Moves sourcePath into the store; the source is gone afterwards. The
+    // blob is referenced by conversation before it becomes evictable.
+    bool adopt(const QString &sourcePath, const QByteArray &sha256, const QString &conversation);
+    // Materialises a blob at destination as a copy-on-write reflink or, where
+    // the filesystem cannot, a writable copy.
+    bool linkOut(const QByteArray &sha256, const QString &destination);
+
+    void addRef(const QByteArray &sha256, const QString &conversation);
+    void releaseConversation(const QString &conversation);
+    static QString conversationKey(const QString &accountId, const QString &peer);
+    // References from before conversations were keyed per account are just
+    // the peer name; adoptLegacyRefs() rekeys them under accountId.
+    bool hasLegacyRefs() const;
+    void adoptLegacyRefs(const QString &accountId);
+
+    qint64 quotaBytes() const;
+    void setQuotaBytes(qint64 bytes);
+    void enforceQuota();
+
+    static bool cloneFile(const QString &source, const QString &destination);
+
+signals:
+    // Only referenced blobs are left and they still exceed the quota.
+    void quotaExceeded(qint64 storedBytes, qint64 quotaBytes);
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        bool hasBlob = false;
+        QSet<QString> uploadedTo;  // servers
+        qint64 lastAccess = 0;
+        QHash<QString, int> refs;
+    };
+
+    QString rootPath() const;
+    QString blobPathLocked(const QByteArray &sha256) const;
+    static QString fileKey(const QString &filePath);
+    void load();
+    void scheduleSave();
+    void save();
+
+    mutable QMutex mutex;
+    QString root;
+    QHash<QByteArray, Entry> entries;
+    QHash<QString, QByteArray> fileHashes;
+    qint64 quota;
+    qint64 storedBytes = 0;
+    QTimer saveTimer;
+};
+
+#endif // ATTACHMENTSTORE_H
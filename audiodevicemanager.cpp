@@ -0,0 +1,263 @@
+//audiodevicemanager.cpp
+#include "audiodevicemanager.h"
+#include "tracer.h"
+#include "metrics.h"
+#include <QDebug>
+
+AudioDeviceManager::AudioDeviceManager(QObject *parent)
+    : QObject(parent), mediaDevices(new QMediaDevices(this))
+{
+    connect(mediaDevices, &QMediaDevices::audioInputsChanged,
+            this, &AudioDeviceManager::onAudioInputsChanged);
+
+    device = QMediaDevices::defaultAudioInput();
+    if (!device.isNull()) {
+        format = negotiateFormat(device);
+    }
+}
+
+AudioDeviceManager::~AudioDeviceManager()
+{
+    if (source) {
+        source->disconnect(this);
+        source->stop();
+        delete source;
+        source = nullptr;
+    }
+}
+
+bool AudioDeviceManager::hasInputDevice() const
+{
+    return !device.isNull();
+}
+
+QAudioDevice AudioDeviceManager::currentDevice() const
+{
+    return device;
+}
+
+QAudioFormat AudioDeviceManager::captureFormat() const
+{
+    return format;
+}
+
+bool AudioDeviceManager::isCapturing() const
+{
+    return capturing;
+}
+
+void AudioDeviceManager::addSink(QIODevice *sink)
+{
+    if (sink && !sinks.contains(sink)) {
+        sinks.append(sink);
+    }
+}
+
+void AudioDeviceManager::removeSink(QIODevice *sink)
+{
+    sinks.removeAll(sink);
+}
+
+QAudioFormat AudioDeviceManager::negotiateFormat(const QAudioDevice &dev)
+{
+    auto cached = formatCache.constFind(dev.id());
+    if (cached != formatCache.constEnd()) {
+        return cached.value();
+    }
+
+    // Prefer formats the pipeline can take as-is; anything else the device
+    // offers is converted, so there is always a usable answer.
+    QAudioFormat negotiated = dev.preferredFormat();
+    const QAudioFormat pipeline = AudioFormatConverter::pipelineFormat();
+    QAudioFormat int16Mono = pipeline;
+    int16Mono.setSampleFormat(QAudioFormat::Int16);
+    for (const QAudioFormat &candidate : {pipeline, int16Mono}) {
+        if (dev.isFormatSupported(candidate)) {
+            negotiated = candidate;
+            break;
+        }
+    }
+
+    formatCache.insert(dev.id(), negotiated);
+    return negotiated;
+}
+
+bool AudioDeviceManager::startCapture()
+{
+    if (capturing) return true;
+
+    if (device.isNull()) {
+        device = QMediaDevices::defaultAudioInput();
+    }
+    if (device.isNull()) {
+        emit errorOccurred("No audio input device found");
+        return false;
+    }
+
+    capturing = true;
+    if (!openSource(device)) {
+        capturing = false;
+        return false;
+    }
+    return true;
+}
+
+void AudioDeviceManager::stopCapture()
+{
+    capturing = false;
+    if (source) {
+        QAudioSource *old = source;
+        source = nullptr;
+        captureIo = nullptr;
+        releaseSource(old);
+    }
+}
+
+void AudioDeviceManager::acquireCapture(QObject *owner)
+{
+    captureOwners.insert(owner);
+    startCapture();
+}
+
+void AudioDeviceManager::releaseCapture(QObject *owner)
+{
+    if (!captureOwners.remove(owner)) return;
+    if (captureOwners.isEmpty()) stopCapture();
+}
+
+bool AudioDeviceManager::openSource(const QAudioDevice &dev)
+{
+    QAudioFormat negotiated = negotiateFormat(dev);
+    if (!negotiated.isValid()) {
+        emit errorOccurred(QString("Audio device %1 reports no usable format").arg(dev.description()));
+        return false;
+    }
+
+    // Bring the new stream up before tearing down the old one so sinks see
+    // at most one missed period during a hot-plug.
+    QAudioSource *next = new QAudioSource(dev, negotiated, this);
+    QIODevice *nextIo = nullptr;
+    if (capturing) {
+        nextIo = next->start();
+        if (!nextIo) {
+            delete next;
+            emit errorOccurred(QString("Failed to open audio device %1").arg(dev.description()));
+            return false;
+        }
+        connect(nextIo, &QIODevice::readyRead, this, &AudioDeviceManager::onCaptureReadyRead);
+    }
+    connect(next, &QAudioSource::stateChanged, this, &AudioDeviceManager::onSourceStateChanged);
+
+    QAudioSource *old = source;
+    source = next;
+    captureIo = nextIo;
+    device = dev;
+    format = negotiated;
+    if (!converter || converter->deviceFormat() != negotiated) {
+        converter.reset(new AudioFormatConverter(negotiated));
+    }
+
+    if (old) {
+        releaseSource(old);
+    }
+    return true;
+}
+
+void AudioDeviceManager::releaseSource(QAudioSource *old)
+{
+    old->disconnect(this);
+    old->stop();
+    old->deleteLater();
+}
+
+void AudioDeviceManager::onAudioInputsChanged()
+{
+    const QAudioDevice preferred = QMediaDevices::defaultAudioInput();
+
+    if (preferred.isNull()) {
+        if (source) {
+            QAudioSource *old = source;
+            source = nullptr;
+            captureIo = nullptr;
+            releaseSource(old);
+        }
+        device = QAudioDevice();
+        emit deviceLost();
+        return;
+    }
+
+    if (preferred.id() == device.id() && source) return;
+
+    if (!capturing) {
+        device = preferred;
+        format = negotiateFormat(preferred);
+        emit deviceChanged(device);
+        return;
+    }
+
+    if (openSource(preferred)) {
+        emit deviceChanged(device);
+    }
+}
+
+void AudioDeviceManager::onCaptureReadyRead()
+{
+    if (!captureIo) return;
+    TRACE_SCOPE("audio", "AudioDeviceManager::capture");
+
+    const qint64 available = captureIo->bytesAvailable();
+    if (available <= 0) return;
+
+    if (readBuffer.size() < available) {
+        readBuffer.resize(available);
+    }
+    const qint64 read = captureIo->read(readBuffer.data(), available);
+    if (read <= 0 || !converter) return;
+
+    const qsizetype frames = converter->toPipeline(readBuffer.constData(), read, pipelineBuffer);
+    if (frames <= 0) return;
+    TRACE_COUNTER("audio", "capture frames", frames);
+
+    const char *bytes = reinterpret_cast<const char *>(pipelineBuffer.constData());
+    const qint64 length = qint64(frames) * qint64(sizeof(float));
+    for (const QPointer<QIODevice> &sink : std::as_const(sinks)) {
+        if (sink) {
+            sink->write(bytes, length);
+        }
+    }
+}
+
+void AudioDeviceManager::onSourceStateChanged(QAudio::State state)
+{
+    // The source going idle mid-capture means the device delivered nothing
+    // for a period: the capture side of an underrun.
+    if (state == QAudio::IdleState && capturing) {
+        static MetricCounter &underruns = Metrics::counter("voip_audio_underruns_total", "Capture periods with no audio from the device.");
+        underruns.add();
+    }
+
+    if (state != QAudio::StoppedState || !source || source->error() == QAudio::NoError) {
+        return;
+    }
+
+    qWarning() << "Audio input stopped with error" << source->error() << "on" << device.description();
+
+    // The device most likely vanished; fall back to whatever is the default
+    // now instead of tearing the call down.
+    const QAudioDevice fallback = QMediaDevices::defaultAudioInput();
+    if (fallback.isNull()) {
+        QAudioSource *old = source;
+        source = nullptr;
+        captureIo = nullptr;
+        releaseSource(old);
+        device = QAudioDevice();
+        emit deviceLost();
+        return;
+    }
+
+    if (openSource(fallback)) {
+        emit deviceChanged(device);
+    } else {
+        emit errorOccurred("Audio error occurred");
+    }
+}
@@ -0,0 +1,82 @@
+//audiodevicemanager.h
+#ifndef AUDIODEVICEMANAGER_H
+#define AUDIODEVICEMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSet>
+#include <QByteArray>
+#include <QVector>
+#include <QIODevice>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QAudioSource>
+#include <QMediaDevices>
+#include "audioformatconverter.h"
+
+// Owns the capture device for the whole client. Follows the system default
+// input through QMediaDevices, caches the negotiated format per device and
+// moves a running capture stream to the new device without stopping it.
+// Whatever the device delivers is converted to the pipeline format
+// (AudioFormatConverter::pipelineFormat()) before it reaches the sinks.
+class AudioDeviceManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioDeviceManager(QObject *parent = nullptr);
+    ~AudioDeviceManager();
+
+    bool hasInputDevice() const;
+    QAudioDevice currentDevice() const;
+    QAudioFormat captureFormat() const;
+    bool isCapturing() const;
+
+    // Sinks receive captured audio in the pipeline format. They stay
+    // attached across device migrations.
+    void addSink(QIODevice *sink);
+    void removeSink(QIODevice *sink);
+
+    // For callers sharing the device, e.g. one call per signed-in account:
+    // capture runs while any owner holds it. Releasing twice is harmless.
+    void acquireCapture(QObject *owner);
+    void releaseCapture(QObject *owner);
+
+public slots:
+    bool startCapture();
+    void stopCapture();
+
+signals:
+    void deviceChanged(const QAudioDevice &device);
+    void deviceLost();
+    void errorOccurred(const QString &message);
+
+private slots:
+    void onAudioInputsChanged();
+    void onCaptureReadyRead();
+    void onSourceStateChanged(QAudio::State state);
+
+private:
+    QAudioFormat negotiateFormat(const QAudioDevice &device);
+    bool openSource(const QAudioDevice &device);
+    void releaseSource(QAudioSource *source);
+
+    QMediaDevices *mediaDevices;
+    QAudioDevice device;
+    QAudioFormat format;
+    QAudioSource *source = nullptr;
+    QIODevice *captureIo = nullptr;
+    bool capturing = false;
+    QSet<QObject *> captureOwners;
+
+    QHash<QByteArray, QAudioFormat> formatCache;
+    QList<QPointer<QIODevice>> sinks;
+    QScopedPointer<AudioFormatConverter> converter;
+    QByteArray readBuffer;
+    QVector<float> pipelineBuffer;
+};
+
+#endif // AUDIODEVICEMANAGER_H
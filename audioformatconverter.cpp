@@ -0,0 +1,163 @@
+//audioformatconverter.cpp
+#include "audioformatconverter.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int kPipelineRate = 48000;
+
+} // namespace
+
+AudioFormatConverter::AudioFormatConverter(const QAudioFormat &deviceFormat)
+    : device(deviceFormat),
+      channels(std::max(1, deviceFormat.channelCount())),
+      bytesPerFrame(std::max(1, deviceFormat.bytesPerFrame())),
+      captureResampler(deviceFormat.sampleRate(), kPipelineRate),
+      playbackResampler(kPipelineRate, deviceFormat.sampleRate())
+{
+}
+
+QAudioFormat AudioFormatConverter::pipelineFormat()
+{
+    QAudioFormat format;
+    format.setSampleRate(kPipelineRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Float);
+    return format;
+}
+
+qsizetype AudioFormatConverter::toPipeline(const char *data, qint64 bytes, QVector<float> &out)
+{
+    const char *frames = data;
+    qint64 available = bytes;
+
+    if (!pending.isEmpty()) {
+        pending.append(data, bytes);
+        frames = pending.constData();
+        available = pending.size();
+    }
+
+    const qsizetype frameCount = available / bytesPerFrame;
+    if (mono.size() < frameCount) {
+        mono.resize(frameCount);
+    }
+    decodeToMono(frames, frameCount, mono.data());
+
+    const qint64 leftover = available - frameCount * bytesPerFrame;
+    if (leftover > 0) {
+        QByteArray tail(frames + frameCount * bytesPerFrame, leftover);
+        pending = tail;
+    } else {
+        pending.clear();
+    }
+
+    const int capacity = captureResampler.maxOutputFrames(int(frameCount));
+    if (out.size() < capacity) {
+        out.resize(capacity);
+    }
+    return captureResampler.process(mono.constData(), int(frameCount), out.data(), capacity);
+}
+
+void AudioFormatConverter::fromPipeline(const float *samples, qsizetype frames, QByteArray &out)
+{
+    const int capacity = playbackResampler.maxOutputFrames(int(frames));
+    if (resampled.size() < capacity) {
+        resampled.resize(capacity);
+    }
+    const int produced = playbackResampler.process(samples, int(frames), resampled.data(), capacity);
+
+    out.resize(qsizetype(produced) * bytesPerFrame);
+    encodeFromMono(resampled.constData(), produced, out.data());
+}
+
+void AudioFormatConverter::decodeToMono(const char *data, qsizetype frames, float *out) const
+{
+    const float scale = 1.0f / channels;
+
+    switch (device.sampleFormat()) {
+    case QAudioFormat::UInt8: {
+        const auto *in = reinterpret_cast<const quint8 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            int sum = 0;
+            for (int c = 0; c < channels; ++c) sum += int(*in++) - 128;
+            out[f] = sum * scale * (1.0f / 128.0f);
+        }
+        break;
+    }
+    case QAudioFormat::Int16: {
+        const auto *in = reinterpret_cast<const qint16 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            int sum = 0;
+            for (int c = 0; c < channels; ++c) sum += *in++;
+            out[f] = sum * scale * (1.0f / 32768.0f);
+        }
+        break;
+    }
+    case QAudioFormat::Int32: {
+        const auto *in = reinterpret_cast<const qint32 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            double sum = 0;
+            for (int c = 0; c < channels; ++c) sum += *in++;
+            out[f] = float(sum * scale * (1.0 / 2147483648.0));
+        }
+        break;
+    }
+    case QAudioFormat::Float: {
+        const auto *in = reinterpret_cast<const float *>(data);
+        if (channels == 1) {
+            std::memcpy(out, in, sizeof(float) * frames);
+            break;
+        }
+        for (qsizetype f = 0; f < frames; ++f) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; ++c) sum += *in++;
+            out[f] = sum * scale;
+        }
+        break;
+    }
+    default:
+        std::fill(out, out + frames, 0.0f);
+        break;
+    }
+}
+
+void AudioFormatConverter::encodeFromMono(const float *samples, qsizetype frames, char *data) const
+{
+    switch (device.sampleFormat()) {
+    case QAudioFormat::UInt8: {
+        auto *out = reinterpret_cast<quint8 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            const quint8 v = quint8(std::clamp(samples[f], -1.0f, 1.0f) * 127.0f + 128.0f);
+            for (int c = 0; c < channels; ++c) *out++ = v;
+        }
+        break;
+    }
+    case QAudioFormat::Int16: {
+        auto *out = reinterpret_cast<qint16 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            const qint16 v = qint16(std::clamp(samples[f], -1.0f, 1.0f) * 32767.0f);
+            for (int c = 0; c < channels; ++c) *out++ = v;
+        }
+        break;
+    }
+    case QAudioFormat::Int32: {
+        auto *out = reinterpret_cast<qint32 *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            const qint32 v = qint32(double(std::clamp(samples[f], -1.0f, 1.0f)) * 2147483647.0);
+            for (int c = 0; c < channels; ++c) *out++ = v;
+        }
+        break;
+    }
+    case QAudioFormat::Float: {
+        auto *out = reinterpret_cast<float *>(data);
+        for (qsizetype f = 0; f < frames; ++f) {
+            for (int c = 0; c < channels; ++c) *out++ = samples[f];
+        }
+        break;
+    }
+    default:
+        std::memset(data, 0, size_t(frames) * bytesPerFrame);
+        break;
+    }
+}
@@ -0,0 +1,45 @@
+//audioformatconverter.h
+#ifndef AUDIOFORMATCONVERTER_H
+#define AUDIOFORMATCONVERTER_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QVector>
+#include "audioresampler.h"
+
+// Converts between a device's native format and the internal pipeline
+// format (48 kHz, mono, float): sample decoding, channel down/up-mixing
+// and sample-rate conversion.
+class AudioFormatConverter
+{
+public:
+    explicit AudioFormatConverter(const QAudioFormat &deviceFormat);
+
+    static QAudioFormat pipelineFormat();
+
+    QAudioFormat deviceFormat() const { return device; }
+
+    // Device bytes in, pipeline samples out. Partial frames at the end of
+    // data are kept and prepended to the next call. Returns frame count.
+    qsizetype toPipeline(const char *data, qint64 bytes, QVector<float> &out);
+
+    // Pipeline samples in, device bytes out.
+    void fromPipeline(const float *samples, qsizetype frames, QByteArray &out);
+
+private:
+    void decodeToMono(const char *data, qsizetype frames, float *out) const;
+    void encodeFromMono(const float *samples, qsizetype frames, char *out) const;
+
+    QAudioFormat device;
+    int channels;
+    int bytesPerFrame;
+
+    AudioResampler captureResampler;
+    AudioResampler playbackResampler;
+
+    QByteArray pending;
+    QVector<float> mono;
+    QVector<float> resampled;
+};
+
+#endif // AUDIOFORMATCONVERTER_H
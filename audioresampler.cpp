@@ -0,0 +1,184 @@
+//audioresampler.cpp
+#include "audioresampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define AUDIORESAMPLER_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIORESAMPLER_NEON
+#endif
+
+struct AudioResampler::FilterBank {
+    int phases;
+    int taps;
+    // phases * taps coefficients, each phase stored oldest-sample first so
+    // the inner loop is a straight dot product against the input buffer.
+    std::vector<float> coeffs;
+};
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const double kKaiserBeta = 8.0;
+const double kPassband = 0.92;
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double half = x / 2.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+} // namespace
+
+AudioResampler::AudioResampler(int inputRate, int outputRate, int tapsPerPhase)
+    : inRate(inputRate), outRate(outputRate)
+{
+    const int divisor = std::gcd(inputRate, outputRate);
+    upFactor = outputRate / divisor;
+    downFactor = inputRate / divisor;
+    taps = (std::max(tapsPerPhase, 4) + 3) & ~3;
+
+    if (!isPassthrough()) {
+        bank = filterBank(upFactor, downFactor, taps);
+    }
+    reset();
+}
+
+std::shared_ptr<const AudioResampler::FilterBank> AudioResampler::filterBank(int up, int down, int taps)
+{
+    static std::mutex cacheMutex;
+    static std::map<std::tuple<int, int, int>, std::shared_ptr<const FilterBank>> cache;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    const auto key = std::make_tuple(up, down, taps);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    // Prototype low-pass at the upsampled rate, cut just below the Nyquist
+    // frequency of the slower side.
+    const int length = up * taps;
+    const double cutoff = kPassband * 0.5 / std::max(up, down);
+    const double centre = (length - 1) / 2.0;
+    const double norm = besselI0(kKaiserBeta);
+
+    std::vector<double> prototype(length);
+    for (int n = 0; n < length; ++n) {
+        const double t = n - centre;
+        const double x = 2.0 * cutoff * t;
+        const double sinc = (t == 0.0) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        const double r = 2.0 * t / (length - 1);
+        const double window = besselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+        prototype[n] = 2.0 * cutoff * sinc * window * up;
+    }
+
+    auto result = std::make_shared<FilterBank>();
+    result->phases = up;
+    result->taps = taps;
+    result->coeffs.resize(static_cast<size_t>(up) * taps);
+    for (int p = 0; p < up; ++p) {
+        float *row = &result->coeffs[static_cast<size_t>(p) * taps];
+        for (int j = 0; j < taps; ++j) {
+            row[j] = static_cast<float>(prototype[p + (taps - 1 - j) * up]);
+        }
+    }
+
+    cache.emplace(key, result);
+    return result;
+}
+
+void AudioResampler::reset()
+{
+    phase = 0;
+    inPos = 0;
+    buffer.assign(isPassthrough() ? 0 : taps - 1, 0.0f);
+}
+
+int AudioResampler::maxOutputFrames(int inFrames) const
+{
+    if (isPassthrough()) return inFrames;
+    return static_cast<int>((static_cast<long long>(inFrames) * upFactor) / downFactor) + 2;
+}
+
+float AudioResampler::dot(const float *a, const float *b, int n)
+{
+#if defined(AUDIORESAMPLER_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(AUDIORESAMPLER_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+    for (int i = 0; i < n; i += 4) {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+#endif
+}
+
+int AudioResampler::process(const float *in, int inFrames, float *out, int outCapacity)
+{
+    if (inFrames <= 0) return 0;
+
+    if (isPassthrough()) {
+        const int n = std::min(inFrames, outCapacity);
+        std::memcpy(out, in, sizeof(float) * n);
+        return n;
+    }
+
+    // buffer holds taps-1 samples of history followed by the new block.
+    const size_t history = static_cast<size_t>(taps - 1);
+    buffer.resize(history + inFrames);
+    std::memcpy(buffer.data() + history, in, sizeof(float) * inFrames);
+
+    const float *coeffs = bank->coeffs.data();
+    int produced = 0;
+    while (inPos < inFrames && produced < outCapacity) {
+        out[produced++] = dot(coeffs + static_cast<size_t>(phase) * taps, buffer.data() + inPos, taps);
+        phase += downFactor;
+        inPos += phase / upFactor;
+        phase %= upFactor;
+    }
+
+    // Callers size out with maxOutputFrames(); if they did not, drop the
+    // remainder rather than reading before the buffer on the next call.
+    if (inPos < inFrames) {
+        inPos = inFrames;
+    }
+
+    // Keep the tail as history for the next block.
+    std::memmove(buffer.data(), buffer.data() + inFrames, sizeof(float) * history);
+    buffer.resize(history);
+    inPos -= inFrames;
+    return produced;
+}
@@ -0,0 +1,45 @@
+//audioresampler.h
+#ifndef AUDIORESAMPLER_H
+#define AUDIORESAMPLER_H
+
+#include <memory>
+#include <vector>
+
+// Streaming rational polyphase resampler for a single channel of float
+// samples. The ratio outputRate/inputRate is reduced to L/M and a
+// Kaiser-windowed sinc prototype is split into L phases once per ratio;
+// banks are shared between instances with the same ratio.
+class AudioResampler
+{
+public:
+    AudioResampler(int inputRate, int outputRate, int tapsPerPhase = 32);
+
+    int inputRate() const { return inRate; }
+    int outputRate() const { return outRate; }
+    bool isPassthrough() const { return upFactor == downFactor; }
+
+    // Upper bound of frames produced for inFrames of input.
+    int maxOutputFrames(int inFrames) const;
+
+    // Consumes all of in and returns the number of frames written to out.
+    int process(const float *in, int inFrames, float *out, int outCapacity);
+    void reset();
+
+private:
+    struct FilterBank;
+    static std::shared_ptr<const FilterBank> filterBank(int up, int down, int taps);
+    static float dot(const float *a, const float *b, int n);
+
+    int inRate;
+    int outRate;
+    int upFactor;
+    int downFactor;
+    int taps;
+    int phase = 0;
+    int inPos = 0;
+
+    std::shared_ptr<const FilterBank> bank;
+    std::vector<float> buffer;
+};
+
+#endif // AUDIORESAMPLER_H
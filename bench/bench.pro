@@ -0,0 +1,8 @@
+# Headless benchmarks. Each prints one JSON line on stdout; run them with
+# QT_QPA_PLATFORM=offscreen (ingest sets it itself).
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    fakeserver \
+    ingest \
+    themeswitch
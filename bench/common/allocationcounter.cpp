@@ -0,0 +1,41 @@
+//allocationcounter.cpp
+// Replaces the global allocation functions so benchmarks can report how
+// many allocations a code path makes. Linked into benchmark binaries only.
+#include "benchutil.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<quint64> allocations{0};
+std::atomic<quint64> allocatedBytes{0};
+
+void *allocate(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+quint64 Bench::allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+quint64 Bench::allocatedBytes()
+{
+    return ::allocatedBytes.load(std::memory_order_relaxed);
+}
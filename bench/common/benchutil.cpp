@@ -0,0 +1,114 @@
+//benchutil.cpp
+#include "benchutil.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <algorithm>
+
+namespace {
+
+// VmRSS/VmHWM from /proc; 0 where that is not available.
+qint64 procStatusBytes(const QByteArray &field)
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith(field + ':')) {
+            return line.mid(field.size() + 1).trimmed().split(' ').value(0).toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+void Bench::useOffscreenPlatform()
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+}
+
+qint64 Bench::residentBytes()
+{
+    return procStatusBytes("VmRSS");
+}
+
+qint64 Bench::peakResidentBytes()
+{
+    return procStatusBytes("VmHWM");
+}
+
+bool Bench::waitUntil(const std::function<bool()> &done, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > timeoutMs) return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+    }
+    return true;
+}
+
+void Bench::runFor(int ms)
+{
+    waitUntil([]() { return false; }, ms);
+}
+
+QJsonObject Bench::summarize(QList<double> samplesMs)
+{
+    if (samplesMs.isEmpty()) {
+        return QJsonObject{{"samples", 0}};
+    }
+    std::sort(samplesMs.begin(), samplesMs.end());
+    double total = 0.0;
+    for (double sample : std::as_const(samplesMs)) {
+        total += sample;
+    }
+    const qsizetype n = samplesMs.size();
+    return QJsonObject{{"samples", int(n)},
+                       {"median_ms", samplesMs[n / 2]},
+                       {"p95_ms", samplesMs[std::min<qsizetype>(n - 1, n * 95 / 100)]},
+                       {"max_ms", samplesMs.last()},
+                       {"mean_ms", total / double(n)}};
+}
+
+void Bench::printResult(const QJsonObject &result)
+{
+    QTextStream(stdout) << QJsonDocument(result).toJson(QJsonDocument::Compact) << '\n';
+}
+
+FrameProbe::FrameProbe(QObject *parent)
+    : QObject(parent)
+{
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.setInterval(FRAME_INTERVAL_MS);
+    connect(&timer, &QTimer::timeout, this, &FrameProbe::onTick);
+}
+
+void FrameProbe::start()
+{
+    framesMs.clear();
+    clock.start();
+    lastTickNs = 0;
+    timer.start();
+}
+
+void FrameProbe::stop()
+{
+    timer.stop();
+}
+
+void FrameProbe::onTick()
+{
+    const qint64 now = clock.nsecsElapsed();
+    framesMs.append((now - lastTickNs) / 1e6);
+    lastTickNs = now;
+}
+
+QJsonObject FrameProbe::result() const
+{
+    return Bench::summarize(framesMs);
+}
@@ -0,0 +1,59 @@
+//benchutil.h
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+
+namespace Bench {
+
+// Point offscreen unless the caller chose a platform; call before
+// QApplication.
+void useOffscreenPlatform();
+
+quint64 allocationCount();
+quint64 allocatedBytes();
+qint64 residentBytes();
+qint64 peakResidentBytes();
+
+// Spins the event loop until done() or timeoutMs; returns done().
+bool waitUntil(const std::function<bool()> &done, int timeoutMs);
+void runFor(int ms);
+
+// median/p95/max/mean of samples in milliseconds.
+QJsonObject summarize(QList<double> samplesMs);
+
+void printResult(const QJsonObject &result);
+
+} // namespace Bench
+
+// Measures how late a 16 ms timer fires while the loop is busy: the frame
+// time a user would see.
+class FrameProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameProbe(QObject *parent = nullptr);
+
+    void start();
+    void stop();
+    QJsonObject result() const;
+
+private slots:
+    void onTick();
+
+private:
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 lastTickNs = 0;
+    QList<double> framesMs;
+
+    static const int FRAME_INTERVAL_MS = 16;
+};
+
+#endif // BENCHUTIL_H
@@ -0,0 +1,14 @@
+# Helpers shared by the benchmarks: the synthetic server, allocation
+# counting and result formatting.
+QT += network websockets
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/allocationcounter.cpp \
+    $$PWD/benchutil.cpp \
+    $$PWD/syntheticserver.cpp
+
+HEADERS += \
+    $$PWD/benchutil.h \
+    $$PWD/syntheticserver.h
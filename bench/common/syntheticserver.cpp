@@ -0,0 +1,197 @@
+//syntheticserver.cpp
+#include "syntheticserver.h"
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const char *const kStatuses[] = {"Online", "Offline", "Busy"};
+const char *const kDepartments[] = {"Engineering", "Sales", "Support", "Finance", "Operations", "Legal"};
+const int kDepartmentCount = 6;
+const quint32 kSeed = 20240611;
+
+} // namespace
+
+SyntheticServer::SyntheticServer(QObject *parent)
+    : QObject(parent),
+      server("synthetic", QWebSocketServer::NonSecureMode),
+      random(kSeed)
+{
+    connect(&server, &QWebSocketServer::newConnection, this, &SyntheticServer::onNewConnection);
+    tickTimer.setTimerType(Qt::PreciseTimer);
+    tickTimer.setInterval(TICK_MS);
+    connect(&tickTimer, &QTimer::timeout, this, &SyntheticServer::onTick);
+}
+
+bool SyntheticServer::listen(quint16 port)
+{
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "Synthetic server failed to listen on port" << port << ":" << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+int SyntheticServer::clientCount() const
+{
+    return int(clients.size());
+}
+
+void SyntheticServer::onNewConnection()
+{
+    while (QWebSocket *socket = server.nextPendingConnection()) {
+        clients.append(socket);
+        connect(socket, &QWebSocket::disconnected, this, [this, socket]() {
+            clients.removeAll(socket);
+            scopes.remove(socket);
+            socket->deleteLater();
+        });
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString &message) {
+            const QJsonObject frame = QJsonDocument::fromJson(message.toUtf8()).object();
+            if (frame["type"].toString() != "presence_scope") return;
+            QSet<QString> &scope = scopes[socket];
+            scope.clear();
+            for (const char *list : {"pinned", "visible"}) {
+                for (const QJsonValue &name : frame[list].toArray()) {
+                    scope.insert(name.toString());
+                }
+            }
+        });
+        emit clientConnected();
+    }
+}
+
+void SyntheticServer::setRosterSize(int size)
+{
+    names.clear();
+    statuses.clear();
+    names.reserve(size);
+    statuses.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        names.append(QString("user%1").arg(i, 6, 10, QChar('0')));
+        statuses.append(quint8(random.bounded(3)));
+    }
+}
+
+int SyntheticServer::rosterSize() const
+{
+    return int(names.size());
+}
+
+QByteArray SyntheticServer::buildRoster() const
+{
+    // Built by hand: QJsonDocument would double the cost at 100k entries
+    // and this is the server's time, not the client's.
+    QByteArray frame;
+    frame.reserve(names.size() * 90 + 2);
+    frame += '[';
+    for (qsizetype i = 0; i < names.size(); ++i) {
+        if (i) frame += ',';
+        frame += "{\"name\":\"" + names[i].toLatin1() + "\",\"status\":\"" + kStatuses[statuses[i]]
+                 + "\",\"dialplan\":\"" + QByteArray::number(10000 + i)
+                 + "\",\"department\":\"" + kDepartments[i % kDepartmentCount] + "\"}";
+    }
+    frame += ']';
+    return frame;
+}
+
+void SyntheticServer::broadcast(const QByteArray &frame)
+{
+    const QString text = QString::fromUtf8(frame);
+    for (QWebSocket *socket : std::as_const(clients)) {
+        socket->sendTextMessage(text);
+        ++frames;
+    }
+}
+
+qint64 SyntheticServer::sendRoster()
+{
+    const QByteArray frame = buildRoster();
+    broadcast(frame);
+    return frame.size();
+}
+
+void SyntheticServer::setChurnRate(double changesPerSecond)
+{
+    churnRate = changesPerSecond;
+    if (!tickTimer.isActive()) {
+        trafficClock.start();
+        lastTickMs = 0;
+        tickTimer.start();
+    }
+}
+
+void SyntheticServer::setChatRate(double messagesPerSecond, int senders)
+{
+    chatRate = messagesPerSecond;
+    chatSenders = std::max(1, senders);
+    if (!tickTimer.isActive()) {
+        trafficClock.start();
+        lastTickMs = 0;
+        tickTimer.start();
+    }
+}
+
+void SyntheticServer::setPresenceDeltas(bool deltas)
+{
+    presenceDeltas = deltas;
+}
+
+void SyntheticServer::stopTraffic()
+{
+    tickTimer.stop();
+    churnRate = 0.0;
+    chatRate = 0.0;
+    churnDue = 0.0;
+    chatDue = 0.0;
+}
+
+qint64 SyntheticServer::framesSent() const
+{
+    return frames;
+}
+
+void SyntheticServer::onTick()
+{
+    // Rates are honoured on average even when ticks arrive late.
+    const qint64 now = trafficClock.elapsed();
+    const double seconds = (now - lastTickMs) / 1000.0;
+    lastTickMs = now;
+    churnDue += churnRate * seconds;
+    chatDue += chatRate * seconds;
+
+    if (churnDue >= 1.0 && !names.isEmpty()) {
+        for (; churnDue >= 1.0; churnDue -= 1.0) {
+            const int index = int(random.bounded(quint32(names.size())));
+            statuses[index] = quint8((statuses[index] + 1) % 3);
+            if (presenceDeltas) {
+                const QJsonObject change{{"type", "presence"},
+                                         {"name", names[index]},
+                                         {"status", kStatuses[statuses[index]]}};
+                const QString text = QString::fromUtf8(QJsonDocument(change).toJson(QJsonDocument::Compact));
+                for (QWebSocket *socket : std::as_const(clients)) {
+                    // Clients that sent a scope only hear about it.
+                    const auto scope = scopes.constFind(socket);
+                    if (scope != scopes.cend() && !scope->contains(names[index])) continue;
+                    socket->sendTextMessage(text);
+                    ++frames;
+                }
+            }
+        }
+        if (!presenceDeltas) {
+            sendRoster();
+        }
+    }
+
+    for (; chatDue >= 1.0; chatDue -= 1.0) {
+        const QString from = QString("user%1").arg(chatSequence % chatSenders, 6, 10, QChar('0'));
+        const QJsonObject message{{"type", "chat"},
+                                  {"from", from},
+                                  {"text", QString("Synthetic message %1").arg(++chatSequence)}};
+        broadcast(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    }
+}
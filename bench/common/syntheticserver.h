@@ -0,0 +1,76 @@
+//syntheticserver.h
+#ifndef SYNTHETICSERVER_H
+#define SYNTHETICSERVER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTimer>
+#include <QWebSocket>
+#include <QWebSocketServer>
+
+// Local stand-in for the presence/chat server. Speaks the client's wire
+// protocol: roster snapshots as bare JSON arrays and chat as typed
+// objects. Presence churn is sent as full snapshots coalesced to one per
+// tick, or with setPresenceDeltas() as one "presence" message per change,
+// sent only to clients whose presence_scope includes the contact.
+// Seeded, so runs are repeatable.
+class SyntheticServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyntheticServer(QObject *parent = nullptr);
+
+    bool listen(quint16 port);
+    int clientCount() const;
+
+    void setRosterSize(int size);
+    int rosterSize() const;
+    QByteArray buildRoster() const;
+    void broadcast(const QByteArray &frame);
+    // Returns the number of bytes sent to each client.
+    qint64 sendRoster();
+
+    void setChurnRate(double changesPerSecond);
+    void setPresenceDeltas(bool deltas);
+    void setChatRate(double messagesPerSecond, int senders = 20);
+    void stopTraffic();
+
+    qint64 framesSent() const;
+
+signals:
+    void clientConnected();
+
+private slots:
+    void onNewConnection();
+    void onTick();
+
+private:
+    QWebSocketServer server;
+    QList<QWebSocket *> clients;
+    QHash<QWebSocket *, QSet<QString>> scopes;
+    QStringList names;
+    QList<quint8> statuses;
+    QRandomGenerator random;
+
+    QTimer tickTimer;
+    QElapsedTimer trafficClock;
+    double churnRate = 0.0;
+    bool presenceDeltas = false;
+    double chatRate = 0.0;
+    int chatSenders = 20;
+    double churnDue = 0.0;
+    double chatDue = 0.0;
+    qint64 lastTickMs = 0;
+    qint64 chatSequence = 0;
+    qint64 frames = 0;
+
+    static const int TICK_MS = 20;
+};
+
+#endif // SYNTHETICSERVER_H
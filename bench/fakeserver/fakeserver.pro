@@ -0,0 +1,12 @@
+QT       += core network websockets
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = fakeserver
+
+include(../common/common.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,56 @@
+//main.cpp
+// Stand-alone synthetic server for driving a real client by hand or from a
+// script, e.g.
+//   fakeserver --roster 100000 --churn 200 --chat 1000 --duration 60
+// Sends the roster to every client as it connects, then the configured
+// traffic; prints a JSON summary when it stops.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonObject>
+#include <QTimer>
+#include "benchutil.h"
+#include "syntheticserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("port", "Port to listen on.", "port", "12345"));
+    parser.addOption(QCommandLineOption("roster", "Roster entries.", "count", "1000"));
+    parser.addOption(QCommandLineOption("churn", "Presence changes per second.", "rate", "0"));
+    parser.addOption(QCommandLineOption("deltas", "Send presence changes one by one instead of as snapshots."));
+    parser.addOption(QCommandLineOption("chat", "Chat messages per second.", "rate", "0"));
+    parser.addOption(QCommandLineOption("senders", "Distinct chat senders.", "count", "20"));
+    parser.addOption(QCommandLineOption("duration", "Seconds to run; 0 runs until killed.", "seconds", "0"));
+    parser.process(app);
+
+    SyntheticServer server;
+    server.setRosterSize(parser.value("roster").toInt());
+    server.setPresenceDeltas(parser.isSet("deltas"));
+    if (!server.listen(quint16(parser.value("port").toUInt()))) {
+        return 1;
+    }
+
+    QObject::connect(&server, &SyntheticServer::clientConnected, &server, [&server, &parser]() {
+        server.sendRoster();
+        if (parser.value("churn").toDouble() > 0) {
+            server.setChurnRate(parser.value("churn").toDouble());
+        }
+        if (parser.value("chat").toDouble() > 0) {
+            server.setChatRate(parser.value("chat").toDouble(), parser.value("senders").toInt());
+        }
+    });
+
+    const int duration = parser.value("duration").toInt();
+    if (duration > 0) {
+        QTimer::singleShot(duration * 1000, &app, &QCoreApplication::quit);
+    }
+
+    const int status = app.exec();
+    Bench::printResult(QJsonObject{{"benchmark", "fakeserver"},
+                                   {"roster", server.rosterSize()},
+                                   {"frames_sent", server.framesSent()}});
+    return status;
+}
@@ -0,0 +1,10 @@
+include(../../clientui1.pri)
+include(../common/common.pri)
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = ingest
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,205 @@
+//main.cpp
+// Runs a ClientWindow against the synthetic server on the port the client
+// dials (12345) and prints one JSON line covering:
+//  - roster ingest: snapshot sent -> snapshot applied to the roster model,
+//    the apply time alone, allocations and repaint time per roster size
+//  - roster search: per-keystroke filter time on the largest roster
+//  - presence churn: frame time while snapshots keep arriving
+//  - presence storm: frame time and frames delivered under single-user
+//    presence changes, which the server scopes to what the client shows
+//  - chat flood: frame time and allocations while chat messages arrive
+// Defaults to the offscreen platform.
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QStandardPaths>
+#include <QDebug>
+#include "benchutil.h"
+#include "syntheticserver.h"
+#include "clientwindow.h"
+#include "metrics.h"
+#include "themeengine.h"
+
+namespace {
+
+const quint16 kClientPort = 12345;
+const int kIngestTimeoutMs = 120000;
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Bench::useOffscreenPlatform();
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("sizes", "Roster sizes to ingest.", "list", "1000,10000,100000"));
+    parser.addOption(QCommandLineOption("seconds", "Length of the churn and chat phases.", "seconds", "5"));
+    parser.addOption(QCommandLineOption("churn", "Presence changes per second.", "rate", "100"));
+    parser.addOption(QCommandLineOption("storm", "Presence changes per second sent one by one.", "rate", "10000"));
+    parser.addOption(QCommandLineOption("chat", "Chat messages per second.", "rate", "500"));
+    parser.addOption(QCommandLineOption("query", "Search typed one key at a time.", "text", "user04217"));
+    parser.process(app);
+    const int phaseMs = parser.value("seconds").toInt() * 1000;
+
+    ThemeEngine::install();
+
+    SyntheticServer server;
+    if (!server.listen(kClientPort)) {
+        return 1;
+    }
+
+    ClientServices services;
+    ClientWindow window(nullptr, AccountData{"bench", QString(), "127.0.0.1"}, &services);
+    window.resize(1024, 768);
+    window.show();
+    if (!Bench::waitUntil([&server]() { return server.clientCount() > 0; }, 10000)) {
+        qWarning() << "Client did not connect to the synthetic server";
+        return 1;
+    }
+
+    // The same instances ClientWindow and ChatHistoryStore update.
+    MetricSummary &rosterRefresh = Metrics::summary("voip_roster_refresh_seconds", "Time to apply a roster snapshot.");
+    MetricSummary &chatWrite = Metrics::summary("voip_chat_write_seconds", "Time to append a chat message to history.");
+
+    // Roster ingest
+    QJsonArray rosterResults;
+    for (const QString &size : parser.value("sizes").split(',', Qt::SkipEmptyParts)) {
+        server.setRosterSize(size.toInt());
+        const QByteArray frame = server.buildRoster();
+        const int repeats = size.toInt() >= 100000 ? 3 : 5;
+
+        QList<double> ingestMs;
+        QList<double> applyMs;
+        quint64 allocations = 0;
+        for (int i = 0; i < repeats; ++i) {
+            const qint64 before = rosterRefresh.observations();
+            const qint64 applyBeforeUs = rosterRefresh.totalUs();
+            const quint64 allocationsBefore = Bench::allocationCount();
+            QElapsedTimer timer;
+            timer.start();
+            server.broadcast(frame);
+            if (!Bench::waitUntil([&]() { return rosterRefresh.observations() > before; }, kIngestTimeoutMs)) {
+                qWarning() << "Roster of" << size << "was not applied in time";
+                return 1;
+            }
+            ingestMs.append(timer.nsecsElapsed() / 1e6);
+            applyMs.append((rosterRefresh.totalUs() - applyBeforeUs) / 1e3);
+            allocations += Bench::allocationCount() - allocationsBefore;
+        }
+
+        QList<double> repaintMs;
+        for (int i = 0; i < 10; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            window.repaint();
+            repaintMs.append(timer.nsecsElapsed() / 1e6);
+        }
+
+        rosterResults.append(QJsonObject{{"entries", size.toInt()},
+                                         {"frame_bytes", frame.size()},
+                                         {"ingest", Bench::summarize(ingestMs)},
+                                         {"apply", Bench::summarize(applyMs)},
+                                         {"allocations_per_snapshot", double(allocations) / repeats},
+                                         {"repaint", Bench::summarize(repaintMs)},
+                                         {"rss_bytes", Bench::residentBytes()}});
+    }
+
+    // Roster search on the last roster ingested. The first keystroke
+    // builds the index and is reported on its own.
+    QLineEdit *search = window.findChild<QLineEdit *>("rosterSearch");
+    QJsonObject searchResult;
+    if (search) {
+        const QString query = parser.value("query");
+        double indexMs = 0.0;
+        QList<double> keystrokeMs;
+        for (int round = 0; round < 5; ++round) {
+            for (int length = 1; length <= query.size(); ++length) {
+                QElapsedTimer timer;
+                timer.start();
+                search->setText(query.left(length));
+                const double ms = timer.nsecsElapsed() / 1e6;
+                if (round == 0 && length == 1) {
+                    indexMs = ms;
+                } else {
+                    keystrokeMs.append(ms);
+                }
+            }
+            search->clear();
+        }
+        searchResult = QJsonObject{{"query", query},
+                                   {"first_keystroke_ms", indexMs},
+                                   {"keystroke", Bench::summarize(keystrokeMs)},
+                                   {"rss_bytes", Bench::residentBytes()}};
+    } else {
+        qWarning() << "Roster search box not found";
+    }
+
+    // Presence churn on a mid-sized roster
+    server.setRosterSize(10000);
+    const qint64 seeded = rosterRefresh.observations();
+    server.sendRoster();
+    Bench::waitUntil([&]() { return rosterRefresh.observations() > seeded; }, kIngestTimeoutMs);
+    FrameProbe probe;
+    const qint64 refreshesBefore = rosterRefresh.observations();
+    const qint64 refreshUsBefore = rosterRefresh.totalUs();
+    probe.start();
+    server.setChurnRate(parser.value("churn").toDouble());
+    Bench::runFor(phaseMs);
+    server.stopTraffic();
+    probe.stop();
+    const qint64 refreshes = rosterRefresh.observations() - refreshesBefore;
+    const QJsonObject churn{{"entries", 10000},
+                            {"changes_per_second", parser.value("churn").toDouble()},
+                            {"snapshots_applied", refreshes},
+                            {"mean_apply_ms", refreshes ? (rosterRefresh.totalUs() - refreshUsBefore) / 1e3 / refreshes : 0.0},
+                            {"frame", probe.result()},
+                            {"rss_bytes", Bench::residentBytes()}};
+
+    // Presence storm, as after a switch reboot
+    server.setPresenceDeltas(true);
+    const qint64 stormFramesBefore = rosterRefresh.observations();
+    const qint64 stormSentBefore = server.framesSent();
+    probe.start();
+    server.setChurnRate(parser.value("storm").toDouble());
+    Bench::runFor(phaseMs);
+    server.stopTraffic();
+    probe.stop();
+    server.setPresenceDeltas(false);
+    const QJsonObject storm{{"entries", 10000},
+                            {"changes_per_second", parser.value("storm").toDouble()},
+                            {"model_updates", rosterRefresh.observations() - stormFramesBefore},
+                            {"presence_frames_received", server.framesSent() - stormSentBefore},
+                            {"frame", probe.result()},
+                            {"rss_bytes", Bench::residentBytes()}};
+
+    // Chat flood
+    const qint64 writesBefore = chatWrite.observations();
+    const qint64 writeUsBefore = chatWrite.totalUs();
+    const quint64 allocationsBefore = Bench::allocationCount();
+    probe.start();
+    server.setChatRate(parser.value("chat").toDouble());
+    Bench::runFor(phaseMs);
+    server.stopTraffic();
+    probe.stop();
+    const qint64 writes = chatWrite.observations() - writesBefore;
+    const QJsonObject chat{{"messages_per_second", parser.value("chat").toDouble()},
+                           {"messages_received", writes},
+                           {"mean_history_write_ms", writes ? (chatWrite.totalUs() - writeUsBefore) / 1e3 / writes : 0.0},
+                           {"allocations_per_message", writes ? double(Bench::allocationCount() - allocationsBefore) / writes : 0.0},
+                           {"frame", probe.result()},
+                           {"rss_bytes", Bench::residentBytes()}};
+
+    Bench::printResult(QJsonObject{{"benchmark", "ingest"},
+                                   {"roster", rosterResults},
+                                   {"search", searchResult},
+                                   {"churn", churn},
+                                   {"presence_storm", storm},
+                                   {"chat_flood", chat},
+                                   {"peak_rss_bytes", Bench::peakResidentBytes()}});
+    return 0;
+}
@@ -0,0 +1,63 @@
+//main.cpp
+// Times a light/dark switch with 50 open conversations, one of them on
+// screen, and prints the result as JSON. Run offscreen with
+// QT_QPA_PLATFORM=offscreen.
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStackedWidget>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+#include "messagewindow.h"
+#include "themeengine.h"
+
+int main(int argc, char *argv[])
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication app(argc, argv);
+    ThemeEngine::install();
+
+    const int conversations = 50;
+    const int iterations = 40;
+
+    ChatHistoryStore history;
+    QStackedWidget stack;
+    QList<MessageWindow *> windows;
+    for (int i = 0; i < conversations; ++i) {
+        MessageWindow *window = new MessageWindow(QString("bench%1").arg(i), "bench@127.0.0.1", false, &history, &stack);
+        stack.addWidget(window);
+        windows.append(window);
+    }
+    stack.resize(800, 600);
+    ThemeEngine::apply(&stack, false);
+    stack.show();
+    app.processEvents();
+
+    // Same sequence as ClientWindow::toggleTheme(), plus the repaint it causes.
+    QList<double> samples;
+    bool dark = false;
+    for (int i = 0; i < iterations; ++i) {
+        dark = !dark;
+        QElapsedTimer timer;
+        timer.start();
+        ThemeEngine::apply(&stack, dark);
+        for (MessageWindow *window : std::as_const(windows)) {
+            window->updateTheme(dark);
+        }
+        stack.repaint();
+        app.processEvents();
+        samples.append(timer.nsecsElapsed() / 1e6);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const QJsonObject result{{"benchmark", "theme_switch"},
+                             {"conversations", conversations},
+                             {"iterations", iterations},
+                             {"median_ms", samples[iterations / 2]},
+                             {"p95_ms", samples[iterations * 95 / 100]},
+                             {"max_ms", samples.last()}};
+    QTextStream(stdout) << QJsonDocument(result).toJson(QJsonDocument::Compact) << '\n';
+    return 0;
+}
@@ -0,0 +1,9 @@
+include(../../clientui1.pri)
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = themeswitch
+
+SOURCES += \
+    main.cpp
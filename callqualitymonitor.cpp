@@ -0,0 +1,309 @@
+//callqualitymonitor.cpp
+#include "callqualitymonitor.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kTickIntervalMs = 1000;
+const int kMaxDropout = 3000;
+
+} // namespace
+
+CallQualityMonitor::CallQualityMonitor(QObject *parent)
+    : QObject(parent)
+{
+    timer.setInterval(kTickIntervalMs);
+    connect(&timer, &QTimer::timeout, this, &CallQualityMonitor::tick);
+}
+
+void CallQualityMonitor::beginSession(const QStringList &legNames)
+{
+    if (active) endSession();
+
+    activeLegs = std::min<int>(legNames.size(), MAX_LEGS);
+    for (int i = 0; i < MAX_LEGS; ++i) {
+        Leg &leg = legs[i];
+        leg = Leg();
+        if (i < activeLegs) {
+            leg.name = legNames.at(i);
+            leg.active = true;
+        }
+    }
+
+    active = true;
+    timer.start();
+}
+
+void CallQualityMonitor::endSession()
+{
+    if (!active) return;
+
+    timer.stop();
+    active = false;
+
+    const QString summary = summarize();
+    emit sessionFinished(summary);
+
+    // Keep a per-session trail on disk for "choppy call" reports.
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (!dataPath.isEmpty() && QDir().mkpath(dataPath)) {
+        QFile file(QDir(dataPath).filePath("call_quality.log"));
+        if (file.open(QIODevice::Append | QIODevice::Text)) {
+            QTextStream out(&file);
+            out << summary << "\n";
+        } else {
+            qWarning() << "Failed to open call quality log:" << file.fileName();
+        }
+    }
+}
+
+bool CallQualityMonitor::isActive() const
+{
+    return active;
+}
+
+int CallQualityMonitor::addLeg(const QString &name)
+{
+    if (!active) return -1;
+    const int existing = legIndex(name);
+    if (existing >= 0) return existing;
+
+    // A never-used slot first, so removed legs keep their history longer.
+    int slot = activeLegs < MAX_LEGS ? activeLegs : -1;
+    for (int i = 0; slot < 0 && i < activeLegs; ++i) {
+        if (!legs[i].active) slot = i;
+    }
+    if (slot < 0) return -1;
+
+    legs[slot] = Leg();
+    legs[slot].name = name;
+    legs[slot].active = true;
+    activeLegs = std::max(activeLegs, slot + 1);
+    return slot;
+}
+
+void CallQualityMonitor::removeLeg(const QString &name)
+{
+    const int index = legIndex(name);
+    if (index >= 0) legs[index].active = false;
+}
+
+int CallQualityMonitor::legIndex(const QString &name) const
+{
+    for (int i = 0; i < activeLegs; ++i) {
+        if (legs[i].active && legs[i].name == name) return i;
+    }
+    return -1;
+}
+
+int CallQualityMonitor::legCount() const
+{
+    return activeLegs;
+}
+
+QString CallQualityMonitor::legName(int leg) const
+{
+    return (leg >= 0 && leg < activeLegs) ? legs[leg].name : QString();
+}
+
+void CallQualityMonitor::onRtpPacket(int index, quint16 sequence, quint32 rtpTimestamp, qint64 arrivalUs, int clockRate)
+{
+    if (!active || index < 0 || index >= activeLegs) return;
+    Leg &leg = legs[index];
+
+    if (!leg.seeded) {
+        leg.seeded = true;
+        leg.baseSeq = sequence;
+        leg.maxSeq = sequence;
+        leg.clockRate = std::max(clockRate, 1);
+        leg.firstArrivalUs = arrivalUs;
+    } else {
+        const quint16 delta = quint16(sequence - leg.maxSeq);
+        if (delta < kMaxDropout) {
+            if (sequence < leg.maxSeq) {
+                leg.cycles += 65536;
+            }
+            leg.maxSeq = sequence;
+        }
+    }
+
+    // Interarrival jitter, RFC 3550 section 6.4.1, in timestamp units. Only
+    // differences of transit matter, so arrival counts from the leg's first
+    // packet; epoch microseconds times the clock rate would overflow.
+    const qint64 arrival = (arrivalUs - leg.firstArrivalUs) * leg.clockRate / 1000000;
+    const qint64 transit = arrival - qint64(rtpTimestamp);
+    if (leg.received > 0) {
+        const double d = std::abs(double(transit - leg.lastTransit));
+        leg.jitterUnits += (d - leg.jitterUnits) / 16.0;
+    }
+    leg.lastTransit = transit;
+    ++leg.received;
+}
+
+void CallQualityMonitor::onRttSample(int index, double rttMs)
+{
+    if (!active || index < 0 || index >= activeLegs) return;
+    Leg &leg = legs[index];
+    leg.rttMs = (leg.rttMs == 0.0) ? rttMs : leg.rttMs * 0.875 + rttMs * 0.125;
+}
+
+void CallQualityMonitor::onReceiverReport(int index, double fractionLost, double jitterMs, double rttMs)
+{
+    if (!active || index < 0 || index >= activeLegs) return;
+    Leg &leg = legs[index];
+    leg.hasReport = true;
+    leg.reportLoss = std::clamp(fractionLost, 0.0, 1.0);
+    leg.reportJitterMs = std::max(jitterMs, 0.0);
+    if (rttMs > 0.0) {
+        onRttSample(index, rttMs);
+    }
+}
+
+CallQualitySample CallQualityMonitor::computeSample(Leg &leg, qint64 now)
+{
+    CallQualitySample sample;
+    sample.timestampMs = now;
+    sample.rttMs = float(leg.rttMs);
+
+    if (leg.hasReport) {
+        sample.valid = true;
+        sample.lossPercent = float(leg.reportLoss * 100.0);
+        sample.jitterMs = float(leg.reportJitterMs);
+    } else if (leg.seeded) {
+        sample.valid = true;
+        const quint64 expected = quint64(leg.cycles) + leg.maxSeq - leg.baseSeq + 1;
+        const quint64 expectedInterval = expected - leg.expectedPrior;
+        const quint64 receivedInterval = leg.received - leg.receivedPrior;
+        leg.expectedPrior = expected;
+        leg.receivedPrior = leg.received;
+
+        // A second without a single packet is an outage, not a clean
+        // interval: the sequence does not advance, so nothing is "expected".
+        if (receivedInterval == 0) {
+            sample.lossPercent = 100.0f;
+        } else if (expectedInterval > receivedInterval) {
+            sample.lossPercent = float(100.0 * double(expectedInterval - receivedInterval) / double(expectedInterval));
+        }
+        sample.jitterMs = float(leg.jitterUnits * 1000.0 / leg.clockRate);
+    }
+
+    if (sample.valid) {
+        sample.mos = estimateMos(sample.lossPercent, sample.jitterMs, sample.rttMs);
+    }
+    return sample;
+}
+
+void CallQualityMonitor::tick()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < activeLegs; ++i) {
+        Leg &leg = legs[i];
+        if (!leg.active) continue;
+        leg.samples[leg.head] = computeSample(leg, now);
+        leg.head = (leg.head + 1) % HISTORY_SECONDS;
+        leg.count = std::min(leg.count + 1, HISTORY_SECONDS);
+    }
+    emit statsUpdated();
+}
+
+CallQualitySample CallQualityMonitor::latest(int index) const
+{
+    if (index < 0 || index >= activeLegs || legs[index].count == 0) {
+        return CallQualitySample();
+    }
+    const Leg &leg = legs[index];
+    return leg.samples[(leg.head + HISTORY_SECONDS - 1) % HISTORY_SECONDS];
+}
+
+CallQualitySample CallQualityMonitor::worstLeg() const
+{
+    CallQualitySample worst;
+    bool found = false;
+    for (int i = 0; i < activeLegs; ++i) {
+        if (!legs[i].active || legs[i].count == 0) continue;
+        const CallQualitySample sample = latest(i);
+        if (!sample.valid) continue;
+        if (!found || sample.mos < worst.mos) {
+            worst = sample;
+            found = true;
+        }
+    }
+    return worst;
+}
+
+QVector<CallQualitySample> CallQualityMonitor::history(int index) const
+{
+    QVector<CallQualitySample> result;
+    if (index < 0 || index >= activeLegs) return result;
+
+    const Leg &leg = legs[index];
+    result.reserve(leg.count);
+    const int start = (leg.head + HISTORY_SECONDS - leg.count) % HISTORY_SECONDS;
+    for (int i = 0; i < leg.count; ++i) {
+        result.append(leg.samples[(start + i) % HISTORY_SECONDS]);
+    }
+    return result;
+}
+
+float CallQualityMonitor::estimateMos(float lossPercent, float jitterMs, float rttMs)
+{
+    // Simplified ITU-T G.107 E-model for a G.711-class codec.
+    const float latency = rttMs / 2.0f + 2.0f * jitterMs + 10.0f;
+    float r = (latency < 160.0f) ? 93.2f - latency / 40.0f
+                                 : 93.2f - (latency - 120.0f) / 10.0f;
+    r -= 2.5f * lossPercent;
+    r = std::clamp(r, 0.0f, 100.0f);
+    return 1.0f + 0.035f * r + 0.000007f * r * (r - 60.0f) * (100.0f - r);
+}
+
+QString CallQualityMonitor::formatSample(const CallQualitySample &sample)
+{
+    if (!sample.valid) return QString("MOS -- | no data");
+    return QString("MOS %1 | Loss %2% | Jitter %3 ms | RTT %4 ms")
+        .arg(sample.mos, 0, 'f', 1)
+        .arg(sample.lossPercent, 0, 'f', 1)
+        .arg(sample.jitterMs, 0, 'f', 0)
+        .arg(sample.rttMs, 0, 'f', 0);
+}
+
+QString CallQualityMonitor::summarize() const
+{
+    QStringList parts;
+    for (int i = 0; i < activeLegs; ++i) {
+        const Leg &leg = legs[i];
+        if (leg.count == 0) continue;
+
+        float minMos = 5.0f, maxLoss = 0.0f, maxJitter = 0.0f, sumMos = 0.0f;
+        int validCount = 0;
+        const int start = (leg.head + HISTORY_SECONDS - leg.count) % HISTORY_SECONDS;
+        for (int k = 0; k < leg.count; ++k) {
+            const CallQualitySample &s = leg.samples[(start + k) % HISTORY_SECONDS];
+            if (!s.valid) continue;
+            ++validCount;
+            minMos = std::min(minMos, s.mos);
+            maxLoss = std::max(maxLoss, s.lossPercent);
+            maxJitter = std::max(maxJitter, s.jitterMs);
+            sumMos += s.mos;
+        }
+        if (validCount == 0) {
+            parts << QString("%1: no data").arg(leg.name);
+            continue;
+        }
+        parts << QString("%1: avg MOS %2, min MOS %3, max loss %4%, max jitter %5 ms")
+                     .arg(leg.name)
+                     .arg(sumMos / validCount, 0, 'f', 2)
+                     .arg(minMos, 0, 'f', 2)
+                     .arg(maxLoss, 0, 'f', 1)
+                     .arg(maxJitter, 0, 'f', 0);
+    }
+    return QString("[%1] %2")
+        .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"),
+             parts.isEmpty() ? QString("no media statistics") : parts.join("; "));
+}
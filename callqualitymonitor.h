@@ -0,0 +1,108 @@
+//callqualitymonitor.h
+#ifndef CALLQUALITYMONITOR_H
+#define CALLQUALITYMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <array>
+
+struct CallQualitySample {
+    qint64 timestampMs = 0;
+    // False until the leg has sent media or a receiver report; the other
+    // fields mean nothing then.
+    bool valid = false;
+    float lossPercent = 0.0f;
+    float jitterMs = 0.0f;
+    float rttMs = 0.0f;
+    float mos = 0.0f;
+};
+
+// RTCP-style receive statistics for the current call. Each leg (the peer
+// of a 1:1 call, or every participant of a conference) keeps RFC 3550
+// loss/jitter state and a fixed ring of one-second samples; all storage is
+// reserved when the session starts so the per-second update never allocates.
+class CallQualityMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_LEGS = 32;
+    static constexpr int HISTORY_SECONDS = 300;
+
+    explicit CallQualityMonitor(QObject *parent = nullptr);
+
+    void beginSession(const QStringList &legNames);
+    void endSession();
+    bool isActive() const;
+
+    // Conference joins and leaves; other legs keep their state. A removed
+    // leg's history stays in the session summary until its slot is reused.
+    int addLeg(const QString &name);
+    void removeLeg(const QString &name);
+
+    int legIndex(const QString &name) const;
+    int legCount() const;
+    QString legName(int leg) const;
+
+    // Packet-level input from a media engine.
+    void onRtpPacket(int leg, quint16 sequence, quint32 rtpTimestamp, qint64 arrivalUs, int clockRate);
+    void onRttSample(int leg, double rttMs);
+    // Receiver report computed elsewhere (e.g. relayed by the server).
+    void onReceiverReport(int leg, double fractionLost, double jitterMs, double rttMs);
+
+    CallQualitySample latest(int leg) const;
+    CallQualitySample worstLeg() const;
+    QVector<CallQualitySample> history(int leg) const;
+
+    static float estimateMos(float lossPercent, float jitterMs, float rttMs);
+    static QString formatSample(const CallQualitySample &sample);
+
+signals:
+    void statsUpdated();
+    void sessionFinished(const QString &summary);
+
+private slots:
+    void tick();
+
+private:
+    struct Leg {
+        QString name;
+        bool active = false;
+
+        // RFC 3550 A.1/A.8 receive state
+        bool seeded = false;
+        quint16 maxSeq = 0;
+        quint32 cycles = 0;
+        quint32 baseSeq = 0;
+        quint64 received = 0;
+        quint64 expectedPrior = 0;
+        quint64 receivedPrior = 0;
+        qint64 lastTransit = 0;
+        qint64 firstArrivalUs = 0;
+        double jitterUnits = 0.0;
+        int clockRate = 8000;
+
+        // Report-driven values override packet-derived ones when present.
+        bool hasReport = false;
+        double reportLoss = 0.0;
+        double reportJitterMs = 0.0;
+        double rttMs = 0.0;
+
+        std::array<CallQualitySample, HISTORY_SECONDS> samples;
+        int head = 0;
+        int count = 0;
+    };
+
+    CallQualitySample computeSample(Leg &leg, qint64 now);
+    QString summarize() const;
+
+    std::array<Leg, MAX_LEGS> legs;
+    int activeLegs = 0;
+    bool active = false;
+    QTimer timer;
+};
+
+#endif // CALLQUALITYMONITOR_H
@@ -0,0 +1,282 @@
+//callrecorder.cpp
+#include "callrecorder.h"
+#include "tracer.h"
+#include "metrics.h"
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kChannels = 1;
+const int kBitsPerSample = 16;
+const int kWavHeaderSize = 44;
+// Two seconds of pipeline audio; the writer drains as soon as audio arrives.
+const size_t kRingSamples = kSampleRate * 2;
+// Bounds the delay if a wake lands between the writer's empty check and its
+// wait.
+const unsigned long kWriterWaitMs = 100;
+const qint64 kDefaultSegmentBytes = 256 * 1024 * 1024;
+
+void writeWavHeader(QFile &file, quint32 dataBytes)
+{
+    QByteArray header(kWavHeaderSize, '\0');
+    char *h = header.data();
+    const quint32 byteRate = kSampleRate * kChannels * kBitsPerSample / 8;
+
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + dataBytes, h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    qToLittleEndian<quint16>(1, h + 20);
+    qToLittleEndian<quint16>(kChannels, h + 22);
+    qToLittleEndian<quint32>(kSampleRate, h + 24);
+    qToLittleEndian<quint32>(byteRate, h + 28);
+    qToLittleEndian<quint16>(kChannels * kBitsPerSample / 8, h + 32);
+    qToLittleEndian<quint16>(kBitsPerSample, h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(dataBytes, h + 40);
+
+    file.seek(0);
+    file.write(header);
+}
+
+} // namespace
+
+// Write-only device handed to the audio pipeline. Never blocks: samples
+// that do not fit in the ring are counted and dropped.
+class CallRecorder::RingSink : public QIODevice
+{
+public:
+    explicit RingSink(CallRecorder *recorder)
+        : recorder(recorder),
+          overruns(Metrics::counter("voip_audio_overruns_total", "Audio blocks partly dropped because a consumer fell behind."))
+    {
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+
+    qint64 writeData(const char *data, qint64 len) override
+    {
+        if (!recorder->recording.load(std::memory_order_relaxed)) {
+            return len;
+        }
+        const size_t samples = size_t(len) / sizeof(float);
+        const size_t pushed = recorder->ring.push(reinterpret_cast<const float *>(data), samples);
+        if (pushed < samples) {
+            recorder->dropped.fetch_add(samples - pushed, std::memory_order_relaxed);
+            overruns.add();
+        }
+        recorder->dataReady.wakeOne();
+        return len;
+    }
+
+private:
+    CallRecorder *recorder;
+    MetricCounter &overruns;
+};
+
+class CallRecorder::WriterThread : public QThread
+{
+public:
+    WriterThread(CallRecorder *recorder, qint64 maxSegmentBytes)
+        : recorder(recorder), maxSegmentBytes(maxSegmentBytes)
+    {
+        setObjectName("CallRecorder writer");
+    }
+
+    void requestStop()
+    {
+        stopRequested.store(true, std::memory_order_release);
+        recorder->dataReady.wakeAll();
+    }
+
+protected:
+    void run() override
+    {
+        QVector<float> block(kSampleRate / 10);
+        QVector<qint16> pcm(block.size());
+        int index = 0;
+
+        if (!openSegment(index)) return;
+
+        for (;;) {
+            const size_t n = recorder->ring.pop(block.data(), size_t(block.size()));
+            if (n == 0) {
+                if (stopRequested.load(std::memory_order_acquire)) break;
+                QMutexLocker locker(&recorder->writerMutex);
+                recorder->dataReady.wait(&recorder->writerMutex, kWriterWaitMs);
+                continue;
+            }
+            TRACE_SCOPE("audio", "CallRecorder::write");
+
+            for (size_t i = 0; i < n; ++i) {
+                pcm[i] = qint16(std::clamp(block[i], -1.0f, 1.0f) * 32767.0f);
+            }
+
+            const qint64 bytes = qint64(n * sizeof(qint16));
+            if (dataBytes + bytes + kWavHeaderSize > maxSegmentBytes) {
+                closeSegment();
+                if (!openSegment(++index)) return;
+            }
+            file.write(reinterpret_cast<const char *>(pcm.constData()), bytes);
+            dataBytes += bytes;
+        }
+
+        closeSegment();
+    }
+
+private:
+    bool openSegment(int index)
+    {
+        const QString path = recorder->segmentPath(index);
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QString message = QString("Failed to open recording file %1").arg(path);
+            QMetaObject::invokeMethod(recorder, [r = recorder, message]() {
+                emit r->errorOccurred(message);
+                r->stop();
+            }, Qt::QueuedConnection);
+            return false;
+        }
+        dataBytes = 0;
+        writeWavHeader(file, 0);
+
+        QMetaObject::invokeMethod(recorder, [r = recorder, path, index]() {
+            r->activeFile = path;
+            if (index == 0) {
+                emit r->recordingStarted(path);
+            } else {
+                emit r->segmentRotated(path);
+            }
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
+    void closeSegment()
+    {
+        if (!file.isOpen()) return;
+        writeWavHeader(file, quint32(dataBytes));
+        file.close();
+    }
+
+    CallRecorder *recorder;
+    qint64 maxSegmentBytes;
+    QFile file;
+    qint64 dataBytes = 0;
+    std::atomic<bool> stopRequested{false};
+};
+
+CallRecorder::CallRecorder(QObject *parent)
+    : QObject(parent),
+      ring(kRingSamples),
+      ringSink(new RingSink(this)),
+      maxSegmentBytes(kDefaultSegmentBytes)
+{
+}
+
+CallRecorder::~CallRecorder()
+{
+    stop();
+}
+
+bool CallRecorder::isRecording() const
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+QIODevice *CallRecorder::sink() const
+{
+    return ringSink.data();
+}
+
+QString CallRecorder::currentFile() const
+{
+    return activeFile;
+}
+
+quint64 CallRecorder::droppedSamples() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void CallRecorder::setMaxSegmentBytes(qint64 bytes)
+{
+    maxSegmentBytes = std::max<qint64>(bytes, kWavHeaderSize + kSampleRate);
+}
+
+QString CallRecorder::defaultDirectory()
+{
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataPath.isEmpty()) {
+        return QString();
+    }
+
+    QDir dir(dataPath);
+    if (!dir.mkpath("recordings")) {
+        qWarning() << "Failed to create recordings directory in:" << dataPath;
+        return QString();
+    }
+    return dir.filePath("recordings");
+}
+
+QString CallRecorder::segmentPath(int index) const
+{
+    if (index == 0) {
+        return baseName + ".wav";
+    }
+    return QString("%1-%2.wav").arg(baseName).arg(index, 3, 10, QChar('0'));
+}
+
+bool CallRecorder::start(const QString &label)
+{
+    if (isRecording()) return true;
+
+    const QString directory = defaultDirectory();
+    if (directory.isEmpty()) {
+        emit errorOccurred("No writable location for recordings");
+        return false;
+    }
+
+    QString safeLabel = label;
+    safeLabel.replace(QRegularExpression("[^A-Za-z0-9_.-]+"), "_");
+    baseName = QDir(directory).filePath(QString("%1_%2")
+                                            .arg(safeLabel.left(64),
+                                                 QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+
+    // Nothing is writing yet, so this thread may act as the consumer to
+    // discard audio left over from a previous session.
+    float scratch[256];
+    while (ring.pop(scratch, 256) > 0) {}
+    dropped.store(0, std::memory_order_relaxed);
+
+    writer.reset(new WriterThread(this, maxSegmentBytes));
+    recording.store(true, std::memory_order_release);
+    writer->start(QThread::LowPriority);
+    return true;
+}
+
+void CallRecorder::stop()
+{
+    if (!writer) return;
+
+    recording.store(false, std::memory_order_release);
+    writer->requestStop();
+    writer->wait();
+    writer.reset();
+    activeFile.clear();
+
+    if (dropped.load(std::memory_order_relaxed) > 0) {
+        qWarning() << "Call recorder dropped" << dropped.load() << "samples";
+    }
+    emit recordingStopped();
+}
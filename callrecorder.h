@@ -0,0 +1,67 @@
+//callrecorder.h
+#ifndef CALLRECORDER_H
+#define CALLRECORDER_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QString>
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QScopedPointer>
+#include <atomic>
+#include "spscringbuffer.h"
+
+// Opt-in call recorder. Mixed call audio in the pipeline format is written
+// to sink() from the audio thread, which only pushes into a fixed-size
+// lock-free ring and wakes a background thread; that thread drains the ring
+// into WAV files and rotates them once they reach maxSegmentBytes.
+class CallRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CallRecorder(QObject *parent = nullptr);
+    ~CallRecorder();
+
+    bool isRecording() const;
+    QIODevice *sink() const;
+    QString currentFile() const;
+    quint64 droppedSamples() const;
+
+    void setMaxSegmentBytes(qint64 bytes);
+    static QString defaultDirectory();
+
+public slots:
+    bool start(const QString &label);
+    void stop();
+
+signals:
+    void recordingStarted(const QString &filePath);
+    void recordingStopped();
+    void segmentRotated(const QString &filePath);
+    void errorOccurred(const QString &message);
+
+private:
+    class RingSink;
+    class WriterThread;
+
+    QString segmentPath(int index) const;
+
+    SpscRingBuffer<float> ring;
+    QScopedPointer<RingSink> ringSink;
+    QScopedPointer<WriterThread> writer;
+
+    qint64 maxSegmentBytes;
+    QString baseName;
+    QString activeFile;
+    std::atomic<bool> recording{false};
+    std::atomic<quint64> dropped{0};
+    // The writer sleeps on dataReady; the audio thread signals it without
+    // taking writerMutex.
+    QMutex writerMutex;
+    QWaitCondition dataReady;
+};
+
+#endif // CALLRECORDER_H
@@ -0,0 +1,82 @@
+//chatexporter.cpp
+#include "chatexporter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+
+ChatExporter::ChatExporter(const ChatHistoryStore *store, const QString &account, const QStringList &conversations,
+                           const QString &destination, const ChatExportFormat *format,
+                           QObject *parent)
+    : QThread(parent), destination(destination), format(format)
+{
+    for (const QString &conversation : conversations) {
+        sources.append({conversation, store->filePath(account, conversation)});
+    }
+}
+
+void ChatExporter::cancel()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+void ChatExporter::run()
+{
+    // Sizes are taken up front; messages appended during the export are
+    // left for the next one.
+    QList<qint64> limits;
+    qint64 totalBytes = 0;
+    for (const Source &source : std::as_const(sources)) {
+        const qint64 size = QFileInfo(source.path).size();
+        limits.append(size);
+        totalBytes += size;
+    }
+
+    QSaveFile out(destination);
+    if (!out.open(QIODevice::WriteOnly)) {
+        emit exportFinished(false, out.errorString());
+        return;
+    }
+
+    QTextStream stream(&out);
+    format->begin(stream);
+
+    qint64 doneBytes = 0;
+    int lastPercent = -1;
+    ChatRecord record;
+    for (int i = 0; i < sources.size(); ++i) {
+        const Source &source = sources[i];
+        QFile in(source.path);
+        if (!in.open(QIODevice::ReadOnly)) continue;
+
+        format->beginConversation(stream, source.conversation);
+        while (in.pos() < limits[i] && !in.atEnd()) {
+            if (cancelled.load(std::memory_order_relaxed)) {
+                out.cancelWriting();
+                emit exportFinished(false, "Export cancelled");
+                return;
+            }
+
+            if (ChatHistoryStore::decode(in.readLine(), &record)) {
+                format->writeRecord(stream, source.conversation, record);
+            }
+
+            const int percent = totalBytes > 0 ? int((doneBytes + in.pos()) * 100 / totalBytes) : 100;
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                emit progress(percent);
+            }
+        }
+        format->endConversation(stream, source.conversation);
+        doneBytes += limits[i];
+    }
+
+    format->end(stream);
+    stream.flush();
+    if (stream.status() != QTextStream::Ok || !out.commit()) {
+        emit exportFinished(false, out.errorString());
+        return;
+    }
+    emit progress(100);
+    emit exportFinished(true, QString());
+}
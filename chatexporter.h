@@ -0,0 +1,46 @@
+//chatexporter.h
+#ifndef CHATEXPORTER_H
+#define CHATEXPORTER_H
+
+#include <QThread>
+#include <QStringList>
+#include <atomic>
+#include "chathistorystore.h"
+#include "chatexportformat.h"
+
+// Streams one or more of an account's conversations from the history store
+// into a single export file on its own thread. Lines are read, decoded and
+// written one at a time, so memory does not depend on history length. The
+// output goes through a QSaveFile and is only committed when the export
+// completes; cancel() leaves any existing file at the destination untouched.
+class ChatExporter : public QThread
+{
+    Q_OBJECT
+
+public:
+    ChatExporter(const ChatHistoryStore *store, const QString &account, const QStringList &conversations,
+                 const QString &destination, const ChatExportFormat *format,
+                 QObject *parent = nullptr);
+
+    void cancel();
+
+signals:
+    void progress(int percent);
+    void exportFinished(bool ok, const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    struct Source {
+        QString conversation;
+        QString path;
+    };
+
+    QList<Source> sources;
+    QString destination;
+    const ChatExportFormat *format;
+    std::atomic<bool> cancelled{false};
+};
+
+#endif // CHATEXPORTER_H
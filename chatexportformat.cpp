@@ -0,0 +1,188 @@
+//chatexportformat.cpp
+#include "chatexportformat.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+namespace {
+
+class PlainTextFormat : public ChatExportFormat
+{
+public:
+    QString name() const override { return "Text Files"; }
+    QString suffix() const override { return "txt"; }
+
+    void beginConversation(QTextStream &out, const QString &conversation) const override
+    {
+        out << "=== " << conversation << " ===\n";
+    }
+
+    void writeRecord(QTextStream &out, const QString &, const ChatRecord &record) const override
+    {
+        const QString time = timestampText(record);
+        if (!time.isEmpty()) {
+            out << '[' << time << "] ";
+        }
+        out << record.sender << ": " << record.text << '\n';
+    }
+
+    void endConversation(QTextStream &out, const QString &) const override
+    {
+        out << '\n';
+    }
+};
+
+class JsonLinesFormat : public ChatExportFormat
+{
+public:
+    QString name() const override { return "JSON Lines"; }
+    QString suffix() const override { return "jsonl"; }
+
+    void writeRecord(QTextStream &out, const QString &conversation, const ChatRecord &record) const override
+    {
+        QJsonObject object{{"conversation", conversation},
+                           {"sender", record.sender},
+                           {"text", record.text}};
+        if (record.timestampMs > 0) {
+            object.insert("timestamp", record.timestampMs);
+        }
+        out << QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact)) << '\n';
+    }
+};
+
+class HtmlFormat : public ChatExportFormat
+{
+public:
+    QString name() const override { return "HTML Files"; }
+    QString suffix() const override { return "html"; }
+
+    void begin(QTextStream &out) const override
+    {
+        out << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Chat export</title></head><body>\n";
+    }
+
+    void beginConversation(QTextStream &out, const QString &conversation) const override
+    {
+        out << "<h2>" << conversation.toHtmlEscaped() << "</h2>\n";
+    }
+
+    void writeRecord(QTextStream &out, const QString &, const ChatRecord &record) const override
+    {
+        out << "<p>";
+        const QString time = timestampText(record);
+        if (!time.isEmpty()) {
+            out << "<small>[" << time << "]</small> ";
+        }
+        out << "<b>" << record.sender.toHtmlEscaped() << ":</b> "
+            << record.text.toHtmlEscaped().replace('\n', "<br>") << "</p>\n";
+    }
+
+    void end(QTextStream &out) const override
+    {
+        out << "</body></html>\n";
+    }
+};
+
+class CsvFormat : public ChatExportFormat
+{
+public:
+    QString name() const override { return "CSV Files"; }
+    QString suffix() const override { return "csv"; }
+
+    void begin(QTextStream &out) const override
+    {
+        out << "conversation,timestamp,sender,text\r\n";
+    }
+
+    void writeRecord(QTextStream &out, const QString &conversation, const ChatRecord &record) const override
+    {
+        out << quoted(conversation) << ',' << quoted(timestampText(record)) << ','
+            << quoted(record.sender) << ',' << quoted(record.text) << "\r\n";
+    }
+
+private:
+    static QString quoted(QString value)
+    {
+        // RFC 4180: quote everything, double embedded quotes.
+        return '"' + value.replace('"', "\"\"") + '"';
+    }
+};
+
+} // namespace
+
+QString ChatExportFormat::fileFilter() const
+{
+    return QString("%1 (*.%2)").arg(name(), suffix());
+}
+
+void ChatExportFormat::begin(QTextStream &) const
+{
+}
+
+void ChatExportFormat::beginConversation(QTextStream &, const QString &) const
+{
+}
+
+void ChatExportFormat::endConversation(QTextStream &, const QString &) const
+{
+}
+
+void ChatExportFormat::end(QTextStream &) const
+{
+}
+
+QString ChatExportFormat::timestampText(const ChatRecord &record)
+{
+    if (record.timestampMs <= 0) return QString();
+    return QDateTime::fromMSecsSinceEpoch(record.timestampMs).toString(Qt::ISODate);
+}
+
+QList<const ChatExportFormat *> &ChatExportFormat::registry()
+{
+    static PlainTextFormat plainText;
+    static JsonLinesFormat jsonLines;
+    static HtmlFormat html;
+    static CsvFormat csv;
+    static QList<const ChatExportFormat *> formats{&plainText, &jsonLines, &html, &csv};
+    return formats;
+}
+
+const QList<const ChatExportFormat *> &ChatExportFormat::formats()
+{
+    return registry();
+}
+
+void ChatExportFormat::registerFormat(const ChatExportFormat *format)
+{
+    if (format && !registry().contains(format)) {
+        registry().append(format);
+    }
+}
+
+const ChatExportFormat *ChatExportFormat::forFileFilter(const QString &filter)
+{
+    for (const ChatExportFormat *format : formats()) {
+        if (format->fileFilter() == filter) return format;
+    }
+    return nullptr;
+}
+
+const ChatExportFormat *ChatExportFormat::forFileName(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    for (const ChatExportFormat *format : formats()) {
+        if (format->suffix() == suffix) return format;
+    }
+    return nullptr;
+}
+
+QString ChatExportFormat::fileFilters()
+{
+    QStringList filters;
+    for (const ChatExportFormat *format : formats()) {
+        filters.append(format->fileFilter());
+    }
+    return filters.join(";;");
+}
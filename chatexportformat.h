@@ -0,0 +1,42 @@
+//chatexportformat.h
+#ifndef CHATEXPORTFORMAT_H
+#define CHATEXPORTFORMAT_H
+
+#include <QList>
+#include <QString>
+#include <QTextStream>
+#include "chathistorystore.h"
+
+// An output format for ChatExporter. Formats are stateless and are called
+// from the export thread, one record at a time, so nothing has to hold a
+// whole conversation. Plain text, JSON Lines, HTML and CSV are registered
+// by default; registerFormat() adds more.
+class ChatExportFormat
+{
+public:
+    virtual ~ChatExportFormat() = default;
+
+    virtual QString name() const = 0;
+    virtual QString suffix() const = 0;
+    QString fileFilter() const;
+
+    virtual void begin(QTextStream &out) const;
+    virtual void beginConversation(QTextStream &out, const QString &conversation) const;
+    virtual void writeRecord(QTextStream &out, const QString &conversation, const ChatRecord &record) const = 0;
+    virtual void endConversation(QTextStream &out, const QString &conversation) const;
+    virtual void end(QTextStream &out) const;
+
+    static const QList<const ChatExportFormat *> &formats();
+    static void registerFormat(const ChatExportFormat *format);
+    static const ChatExportFormat *forFileFilter(const QString &filter);
+    static const ChatExportFormat *forFileName(const QString &fileName);
+    static QString fileFilters();
+
+protected:
+    static QString timestampText(const ChatRecord &record);
+
+private:
+    static QList<const ChatExportFormat *> &registry();
+};
+
+#endif // CHATEXPORTFORMAT_H
@@ -0,0 +1,236 @@
+//chathistorystore.cpp
+#include "chathistorystore.h"
+#include "tracer.h"
+#include "metrics.h"
+#include "clientdata.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const char kSeparator[] = "|||";
+const char kChatSuffix[] = "_chat.txt";
+const qint64 kTailBlockBytes = 64 * 1024;
+
+// '|' becomes \p rather than \| so an escaped field never contains a pipe
+// and cannot run into the separator that follows it.
+QString escapeField(const QString &value)
+{
+    QString escaped;
+    escaped.reserve(value.size());
+    for (const QChar c : value) {
+        if (c == '\\') escaped += "\\\\";
+        else if (c == '\n') escaped += "\\n";
+        else if (c == '\r') escaped += "\\r";
+        else if (c == '|') escaped += "\\p";
+        else escaped += c;
+    }
+    return escaped;
+}
+
+QString unescapeField(const QString &value)
+{
+    QString plain;
+    plain.reserve(value.size());
+    for (qsizetype i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            plain += value[i];
+            continue;
+        }
+        const QChar next = value[++i];
+        if (next == 'n') plain += '\n';
+        else if (next == 'r') plain += '\r';
+        else if (next == 'p') plain += '|';
+        else plain += next;
+    }
+    return plain;
+}
+
+} // namespace
+
+ChatHistoryStore::ChatHistoryStore(QObject *parent)
+    : QObject(parent)
+{
+    dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataPath.isEmpty()) {
+        qWarning() << "Failed to get writable location";
+        return;
+    }
+
+    QDir dir(dataPath);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        qWarning() << "Failed to create directory:" << dataPath;
+        dataPath.clear();
+    }
+}
+
+QString ChatHistoryStore::directory() const
+{
+    return dataPath;
+}
+
+QString ChatHistoryStore::accountDirectory(const QString &account) const
+{
+    if (dataPath.isEmpty()) return QString();
+
+    QDir dir(dataPath);
+    const QString relative = "accounts/" + AccountData::directoryName(account);
+    if (!dir.exists(relative) && !dir.mkpath(relative)) {
+        qWarning() << "Failed to create directory:" << dir.filePath(relative);
+        return QString();
+    }
+    return dir.filePath(relative);
+}
+
+bool ChatHistoryStore::hasLegacyHistories() const
+{
+    return !dataPath.isEmpty() && !QDir(dataPath).entryList({QString("*") + kChatSuffix}, QDir::Files).isEmpty();
+}
+
+bool ChatHistoryStore::adoptLegacyHistories(const QString &account)
+{
+    const QString target = accountDirectory(account);
+    if (target.isEmpty()) return false;
+
+    QDir dir(dataPath);
+    bool moved = true;
+    const QStringList legacy = dir.entryList({QString("*") + kChatSuffix}, QDir::Files);
+    for (const QString &file : legacy) {
+        const QString destination = QDir(target).filePath(file);
+        if (QFile::exists(destination) || !QFile::rename(dir.filePath(file), destination)) {
+            qWarning() << "Failed to move chat history" << dir.filePath(file) << "to" << destination;
+            moved = false;
+        }
+    }
+    return moved;
+}
+
+QString ChatHistoryStore::filePath(const QString &account, const QString &conversation) const
+{
+    const QString path = accountDirectory(account);
+    if (path.isEmpty()) return QString();
+    return QDir(path).filePath(conversation + kChatSuffix);
+}
+
+QStringList ChatHistoryStore::conversations(const QString &account) const
+{
+    QStringList result;
+    const QString path = accountDirectory(account);
+    if (path.isEmpty()) return result;
+
+    const QStringList files = QDir(path).entryList({QString("*") + kChatSuffix}, QDir::Files, QDir::Name);
+    for (const QString &file : files) {
+        result.append(file.chopped(int(qstrlen(kChatSuffix))));
+    }
+    return result;
+}
+
+QByteArray ChatHistoryStore::encode(const ChatRecord &record)
+{
+    QByteArray line = "@" + QByteArray::number(record.timestampMs) + kSeparator;
+    line += escapeField(record.sender).toUtf8();
+    line += kSeparator;
+    line += escapeField(record.text).toUtf8();
+    line += '\n';
+    return line;
+}
+
+bool ChatHistoryStore::decode(const QByteArray &rawLine, ChatRecord *record)
+{
+    QByteArray line = rawLine;
+    while (line.endsWith('\n') || line.endsWith('\r')) {
+        line.chop(1);
+    }
+
+    if (line.startsWith('@')) {
+        const qsizetype first = line.indexOf(kSeparator);
+        const qsizetype second = first < 0 ? -1 : line.indexOf(kSeparator, first + 3);
+        bool ok = false;
+        const qint64 timestamp = first < 0 ? 0 : line.mid(1, first - 1).toLongLong(&ok);
+        if (ok && second >= 0) {
+            record->timestampMs = timestamp;
+            record->sender = unescapeField(QString::fromUtf8(line.mid(first + 3, second - first - 3)));
+            record->text = unescapeField(QString::fromUtf8(line.mid(second + 3)));
+            return !record->sender.isEmpty() && !record->text.isEmpty();
+        }
+    }
+
+    // Untimed line from before the history was append-only.
+    const qsizetype split = line.indexOf(kSeparator);
+    if (split <= 0 || line.indexOf(kSeparator, split + 3) >= 0) return false;
+    record->timestampMs = 0;
+    record->sender = QString::fromUtf8(line.left(split));
+    record->text = QString::fromUtf8(line.mid(split + 3));
+    return !record->text.isEmpty();
+}
+
+bool ChatHistoryStore::append(const QString &account, const QString &conversation, const ChatRecord &record)
+{
+    TRACE_SCOPE("history", "ChatHistoryStore::append");
+    static MetricSummary &writeTime = Metrics::summary("voip_chat_write_seconds", "Time to append a chat message to history.");
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString path = filePath(account, conversation);
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open chat history file for writing:" << path;
+        return false;
+    }
+    const bool written = file.write(encode(record)) > 0;
+    file.close();
+    writeTime.observeUs(timer.nsecsElapsed() / 1000);
+    return written;
+}
+
+void ChatHistoryStore::clear(const QString &account, const QString &conversation)
+{
+    TRACE_SCOPE("history", "ChatHistoryStore::clear");
+    const QString path = filePath(account, conversation);
+    QFile file(path);
+    if (!path.isEmpty() && file.exists() && !file.resize(0)) {
+        qWarning() << "Failed to clear chat history file:" << path;
+    }
+}
+
+QList<ChatRecord> ChatHistoryStore::tail(const QString &account, const QString &conversation, int count) const
+{
+    TRACE_SCOPE("history", "ChatHistoryStore::tail");
+    QList<ChatRecord> records;
+    QFile file(filePath(account, conversation));
+    if (count <= 0 || !file.open(QIODevice::ReadOnly)) return records;
+
+    // Read backwards from the end until enough lines are in, so opening a
+    // chat costs the same however long its history is.
+    QByteArray buffer;
+    qint64 start = file.size();
+    qsizetype lines = 0;
+    while (start > 0 && lines <= count) {
+        const qint64 chunk = std::min<qint64>(kTailBlockBytes, start);
+        start -= chunk;
+        if (!file.seek(start)) break;
+        const QByteArray block = file.read(chunk);
+        lines += block.count('\n');
+        buffer.prepend(block);
+    }
+
+    QList<QByteArray> rawLines = buffer.split('\n');
+    if (start > 0 && !rawLines.isEmpty()) {
+        rawLines.removeFirst();  // partial line at the cut
+    }
+
+    ChatRecord record;
+    for (const QByteArray &line : std::as_const(rawLines)) {
+        if (decode(line, &record)) {
+            records.append(record);
+        }
+    }
+    if (records.size() > count) {
+        records.remove(0, records.size() - count);
+    }
+    return records;
+}
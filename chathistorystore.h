@@ -0,0 +1,57 @@
+//chathistorystore.h
+#ifndef CHATHISTORYSTORE_H
+#define CHATHISTORYSTORE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+struct ChatRecord {
+    qint64 timestampMs = 0;
+    QString sender;
+    QString text;
+};
+
+// Append-only chat history, one <AppData>/accounts/<account>/<peer>_chat.txt
+// per conversation, so the same peer on two servers keeps two histories.
+// account is AccountData::id().
+// Each line is "@<ms since epoch>|||sender|||text" with backslash, CR, LF
+// and '|' escaped; older "sender|||text" lines are still read, without a
+// time.
+// Messages are appended as they arrive, so the file is never rewritten and
+// can grow far past what a chat window keeps in memory.
+class ChatHistoryStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChatHistoryStore(QObject *parent = nullptr);
+
+    QString directory() const;
+    QString filePath(const QString &account, const QString &conversation) const;
+    QStringList conversations(const QString &account) const;
+
+    bool append(const QString &account, const QString &conversation, const ChatRecord &record);
+    void clear(const QString &account, const QString &conversation);
+
+    // The newest count records, read from the end of the file.
+    QList<ChatRecord> tail(const QString &account, const QString &conversation, int count) const;
+
+    // Histories from before they were kept per account sit directly in
+    // directory(). adoptLegacyHistories() moves them under account and
+    // returns false if any could not be moved; those stay where they are.
+    bool hasLegacyHistories() const;
+    bool adoptLegacyHistories(const QString &account);
+
+    static QByteArray encode(const ChatRecord &record);
+    static bool decode(const QByteArray &line, ChatRecord *record);
+
+private:
+    QString accountDirectory(const QString &account) const;
+
+    QString dataPath;
+};
+
+#endif // CHATHISTORYSTORE_H
@@ -0,0 +1,271 @@
+//chatoutbox.cpp
+#include "chatoutbox.h"
+#include "clientdata.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+QJsonObject toJson(const QString &id, const QString &recipient, const QString &text, qint64 createdAt)
+{
+    return QJsonObject{{"id", id}, {"to", recipient}, {"text", text}, {"ts", createdAt}};
+}
+
+QString compact(const QJsonObject &object)
+{
+    return QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+} // namespace
+
+ChatOutbox::ChatOutbox(SocketFrameQueue *queue, const QString &account, QObject *parent)
+    : QObject(parent), queue(queue), account(account)
+{
+    retryTimer.setInterval(1000);
+    connect(&retryTimer, &QTimer::timeout, this, &ChatOutbox::retryDue);
+    loadSpool();
+}
+
+QString ChatOutbox::enqueue(const QString &recipient, const QString &text, const QString &id)
+{
+    Entry entry;
+    entry.id = id.isEmpty() ? QUuid::createUuid().toString(QUuid::WithoutBraces) : id;
+    entry.recipient = recipient;
+    entry.text = text;
+    entry.createdAt = QDateTime::currentMSecsSinceEpoch();
+
+    if (online) {
+        transmit(entry, entry.createdAt);
+    }
+    entries.append(entry);
+    appendToSpool(entry);
+
+    emit stateChanged(recipient, entry.id, Pending);
+    return entry.id;
+}
+
+void ChatOutbox::setOnline(bool isOnline)
+{
+    online = isOnline;
+    if (online) {
+        retryTimer.start();
+    } else {
+        retryTimer.stop();
+    }
+}
+
+int ChatOutbox::pendingCount() const
+{
+    return int(entries.size());
+}
+
+void ChatOutbox::transmit(Entry &entry, qint64 now)
+{
+    queue->enqueue(SocketFrameQueue::Chat,
+                   compact(QJsonObject{{"type", "chat"},
+                                       {"id", entry.id},
+                                       {"to", entry.recipient},
+                                       {"text", entry.text},
+                                       {"ts", entry.createdAt}}));
+    scheduleRetry(entry, now);
+}
+
+void ChatOutbox::scheduleRetry(Entry &entry, qint64 now)
+{
+    ++entry.attempts;
+    const int exponent = std::min(entry.attempts - 1, 5);
+    const int backoff = std::min(BASE_BACKOFF_MS << exponent, int(MAX_BACKOFF_MS));
+    const int jitter = QRandomGenerator::global()->bounded(backoff / 4 + 1);
+    entry.nextAttemptAt = now + backoff + jitter;
+}
+
+void ChatOutbox::flush()
+{
+    if (!online || entries.isEmpty()) return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonArray batch;
+    for (Entry &entry : entries) {
+        batch.append(toJson(entry.id, entry.recipient, entry.text, entry.createdAt));
+        scheduleRetry(entry, now);
+
+        if (batch.size() == BATCH_SIZE) {
+            queue->enqueue(SocketFrameQueue::Chat, compact(QJsonObject{{"type", "chat_batch"}, {"messages", batch}}));
+            batch = QJsonArray();
+        }
+    }
+    if (!batch.isEmpty()) {
+        queue->enqueue(SocketFrameQueue::Chat, compact(QJsonObject{{"type", "chat_batch"}, {"messages", batch}}));
+    }
+}
+
+void ChatOutbox::retryDue()
+{
+    if (!online) return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (Entry &entry : entries) {
+        if (entry.nextAttemptAt <= now) {
+            transmit(entry, now);
+        }
+    }
+}
+
+void ChatOutbox::handleAck(const QStringList &ids)
+{
+    bool changed = false;
+    for (const QString &id : ids) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&id](const Entry &entry) { return entry.id == id; });
+        if (it == entries.end()) continue;
+
+        const QString recipient = it->recipient;
+        entries.erase(it);
+        changed = true;
+
+        awaitingDelivery.insert(id, recipient);
+        awaitingOrder.append(id);
+        if (awaitingOrder.size() > MAX_TRACKED_DELIVERIES) {
+            awaitingDelivery.remove(awaitingOrder.takeFirst());
+        }
+        emit stateChanged(recipient, id, Sent);
+    }
+
+    if (changed) {
+        saveSpool();
+    }
+}
+
+void ChatOutbox::handleDelivered(const QStringList &ids)
+{
+    for (const QString &id : ids) {
+        const QString recipient = awaitingDelivery.take(id);
+        if (recipient.isEmpty()) continue;
+        awaitingOrder.removeOne(id);
+        emit stateChanged(recipient, id, Delivered);
+    }
+}
+
+QString ChatOutbox::spoolPath() const
+{
+    return spoolPathFor(account);
+}
+
+QString ChatOutbox::legacySpoolPath()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return dataPath.isEmpty() ? QString() : QDir(dataPath).filePath("outbox.jsonl");
+}
+
+bool ChatOutbox::hasLegacySpool()
+{
+    const QString legacy = legacySpoolPath();
+    return !legacy.isEmpty() && QFile::exists(legacy);
+}
+
+bool ChatOutbox::adoptLegacySpool(const QString &account)
+{
+    const QString legacy = legacySpoolPath();
+    const QString target = spoolPathFor(account);
+    if (legacy.isEmpty() || target.isEmpty()) return false;
+
+    if (!QFile::exists(target)) {
+        if (QFile::rename(legacy, target)) return true;
+    }
+
+    // Both exist, or the rename failed: append, as the spool is one JSON
+    // object per line.
+    QFile source(legacy);
+    QFile destination(target);
+    if (!source.open(QIODevice::ReadOnly) || !destination.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to move outbox spool" << legacy << "to" << target;
+        return false;
+    }
+    QByteArray data = source.readAll();
+    if (!data.isEmpty() && !data.endsWith('\n')) data += '\n';
+    if (destination.write(data) != data.size() || !destination.flush()) {
+        qWarning() << "Failed to write outbox spool:" << destination.errorString();
+        return false;
+    }
+    source.close();
+    return QFile::remove(legacy);
+}
+
+QString ChatOutbox::spoolPathFor(const QString &account)
+{
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataPath.isEmpty()) {
+        qWarning() << "Failed to get writable location";
+        return QString();
+    }
+
+    QDir dir(dataPath);
+    const QString accountDir = "accounts/" + AccountData::directoryName(account);
+    if (!dir.mkpath(accountDir)) {
+        qWarning() << "Failed to create directory:" << dir.filePath(accountDir);
+        return QString();
+    }
+
+    return dir.filePath(accountDir + "/outbox.jsonl");
+}
+
+void ChatOutbox::loadSpool()
+{
+    QFile file(spoolPath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+
+    while (!file.atEnd()) {
+        const QJsonObject object = QJsonDocument::fromJson(file.readLine()).object();
+        Entry entry;
+        entry.id = object["id"].toString();
+        entry.recipient = object["to"].toString();
+        entry.text = object["text"].toString();
+        entry.createdAt = qint64(object["ts"].toDouble());
+        if (!entry.id.isEmpty() && !entry.recipient.isEmpty()) {
+            entries.append(entry);
+        }
+    }
+}
+
+void ChatOutbox::appendToSpool(const Entry &entry)
+{
+    const QString path = spoolPath();
+    if (path.isEmpty()) return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Failed to open outbox spool for writing:" << path;
+        return;
+    }
+    file.write(QJsonDocument(toJson(entry.id, entry.recipient, entry.text, entry.createdAt))
+                   .toJson(QJsonDocument::Compact));
+    file.write("\n");
+}
+
+void ChatOutbox::saveSpool()
+{
+    const QString path = spoolPath();
+    if (path.isEmpty()) return;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Failed to open outbox spool for writing:" << path;
+        return;
+    }
+    for (const Entry &entry : std::as_const(entries)) {
+        file.write(QJsonDocument(toJson(entry.id, entry.recipient, entry.text, entry.createdAt))
+                       .toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+    file.commit();
+}
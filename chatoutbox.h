@@ -0,0 +1,88 @@
+//chatoutbox.h
+#ifndef CHATOUTBOX_H
+#define CHATOUTBOX_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include "socketframequeue.h"
+
+// Outbound chat messages that the server has not acknowledged yet. Every
+// message gets an id, is spooled to disk until acked and is retried with
+// exponential backoff. While offline messages only accumulate; flush()
+// sends them in batches once the socket is back. Each account has its own
+// spool, so messages only ever go to the server they were written for.
+class ChatOutbox : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Pending,
+        Sent,
+        Delivered
+    };
+
+    // account is AccountData::id().
+    ChatOutbox(SocketFrameQueue *queue, const QString &account, QObject *parent = nullptr);
+
+    QString enqueue(const QString &recipient, const QString &text, const QString &id = QString());
+    void setOnline(bool online);
+    int pendingCount() const;
+
+    void handleAck(const QStringList &ids);
+    void handleDelivered(const QStringList &ids);
+
+    // The spool from before it was kept per account, <AppData>/outbox.jsonl.
+    // adoptLegacySpool() appends its messages to account's spool and removes
+    // it; call it before that account's outbox is created.
+    static bool hasLegacySpool();
+    static bool adoptLegacySpool(const QString &account);
+
+public slots:
+    void flush();
+
+signals:
+    void stateChanged(const QString &recipient, const QString &id, ChatOutbox::State state);
+
+private slots:
+    void retryDue();
+
+private:
+    struct Entry {
+        QString id;
+        QString recipient;
+        QString text;
+        qint64 createdAt = 0;
+        int attempts = 0;
+        qint64 nextAttemptAt = 0;
+    };
+
+    void transmit(Entry &entry, qint64 now);
+    void scheduleRetry(Entry &entry, qint64 now);
+    QString spoolPath() const;
+    static QString spoolPathFor(const QString &account);
+    static QString legacySpoolPath();
+    void loadSpool();
+    // New messages are appended; the file is only rewritten when acks
+    // remove entries.
+    void appendToSpool(const Entry &entry);
+    void saveSpool();
+
+    SocketFrameQueue *queue;
+    QString account;
+    QList<Entry> entries;
+    QHash<QString, QString> awaitingDelivery;
+    QStringList awaitingOrder;
+    QTimer retryTimer;
+    bool online = false;
+
+    static const int BATCH_SIZE = 50;
+    static const int BASE_BACKOFF_MS = 2000;
+    static const int MAX_BACKOFF_MS = 60000;
+    static const int MAX_TRACKED_DELIVERIES = 1000;
+};
+
+#endif // CHATOUTBOX_H
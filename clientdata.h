@@ -3,6 +3,7 @@
 #define CLIENTDATA_H
 
 #include <QString>
+#include <QUrl>
 
 struct ClientData {
     QString username;
@@ -11,4 +12,21 @@ struct ClientData {
     QString status;
 };
 
+// One signed-in account. Several can be open at once, one per server or
+// user.
+struct AccountData {
+    QString username;
+    QString password;
+    QString server;  // IPv4 address of the PBX
+
+    QString id() const { return username + '@' + server; }
+    QUrl url() const { return QUrl(QString("ws://%1:12345").arg(server)); }
+
+    // Per-account data lives under <AppData>/accounts/<directoryName>.
+    static QString directoryName(const QString &accountId)
+    {
+        return QString::fromLatin1(QUrl::toPercentEncoding(accountId));
+    }
+};
+
 #endif // CLIENTDATA_H
@@ -0,0 +1,79 @@
+//clientservices.cpp
+#include "clientservices.h"
+#include "attachmentstore.h"
+#include "audiodevicemanager.h"
+#include "chathistorystore.h"
+#include "chatoutbox.h"
+#include "thumbnailpipeline.h"
+#include <QDir>
+#include <QSettings>
+#include <QDebug>
+
+ClientServices::ClientServices(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AudioDeviceManager *ClientServices::audio()
+{
+    if (!audioManager) {
+        audioManager = new AudioDeviceManager(this);
+    }
+    return audioManager;
+}
+
+ChatHistoryStore *ClientServices::history()
+{
+    if (!chatHistory) {
+        chatHistory = new ChatHistoryStore(this);
+    }
+    return chatHistory;
+}
+
+AttachmentStore *ClientServices::attachments()
+{
+    if (!attachmentStore) {
+        attachmentStore = new AttachmentStore(this);
+    }
+    return attachmentStore;
+}
+
+ThumbnailPipeline *ClientServices::thumbnails()
+{
+    if (!thumbnailPipeline) {
+        thumbnailPipeline = new ThumbnailPipeline(this);
+    }
+    return thumbnailPipeline;
+}
+
+ClientServices::MigrationResult ClientServices::migrateLegacyData(const AccountData &account)
+{
+    ChatHistoryStore *store = history();
+    AttachmentStore *attachmentStore = attachments();
+    if (!store->hasLegacyHistories() && !ChatOutbox::hasLegacySpool() && !attachmentStore->hasLegacyRefs()) {
+        return NothingToMigrate;
+    }
+
+    // The old layout had no owner. It is only safe to hand it to this
+    // account if no other account has been used here since.
+    const QString own = AccountData::directoryName(account.id());
+    QStringList others = QDir(store->directory() + "/accounts").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    QSettings settings("YourCompany", "VoIPClient");
+    settings.beginGroup("accounts");
+    for (const QString &id : settings.childGroups()) {
+        others.append(AccountData::directoryName(id));
+    }
+    settings.endGroup();
+    others.removeAll(own);
+    if (!others.isEmpty()) {
+        qWarning() << "Not migrating pre-account data; other accounts exist:" << others;
+        return Ambiguous;
+    }
+
+    bool ok = store->adoptLegacyHistories(account.id());
+    if (ChatOutbox::hasLegacySpool()) {
+        ok = ChatOutbox::adoptLegacySpool(account.id()) && ok;
+    }
+    attachmentStore->adoptLegacyRefs(account.id());
+    return ok ? Migrated : Failed;
+}
@@ -0,0 +1,48 @@
+//clientservices.h
+#ifndef CLIENTSERVICES_H
+#define CLIENTSERVICES_H
+
+#include <QObject>
+#include "clientdata.h"
+
+class AttachmentStore;
+class AudioDeviceManager;
+class ChatHistoryStore;
+class ThumbnailPipeline;
+
+// What every signed-in account shares: the capture device, chat history
+// and attachments on disk, and the thumbnail workers. Each is created on
+// first use; account windows borrow them and must be gone before this is
+// destroyed.
+class ClientServices : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClientServices(QObject *parent = nullptr);
+
+    AudioDeviceManager *audio();
+    ChatHistoryStore *history();
+    AttachmentStore *attachments();
+    ThumbnailPipeline *thumbnails();
+
+    enum MigrationResult {
+        NothingToMigrate,
+        Migrated,
+        Ambiguous,  // other accounts exist; the data was left alone
+        Failed      // some files stayed behind; retried at the next sign-in
+    };
+
+    // Moves chat histories, the outbox spool and attachment references from
+    // before sessions were kept per account to account. Call at sign-in,
+    // before the account's window exists.
+    MigrationResult migrateLegacyData(const AccountData &account);
+
+private:
+    AudioDeviceManager *audioManager = nullptr;
+    ChatHistoryStore *chatHistory = nullptr;
+    AttachmentStore *attachmentStore = nullptr;
+    ThumbnailPipeline *thumbnailPipeline = nullptr;
+};
+
+#endif // CLIENTSERVICES_H
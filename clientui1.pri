@@ -0,0 +1,94 @@
+# Everything but main.cpp, shared by the application and the benchmarks
+# under bench/.
+QT       += core gui multimedia network websockets \
+    quick
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+INCLUDEPATH += $$PWD
+
+CONFIG += c++17
+
+# CONFIG+=no_tracing compiles the TRACE_* macros out
+no_tracing {
+    DEFINES += VOIP_NO_TRACING
+}
+
+SOURCES += \
+    $$PWD/mainwindow.cpp \
+    $$PWD/clientwindow.cpp \
+    $$PWD/clientwidget.cpp \
+    $$PWD/conferancecallwindow.cpp \
+    $$PWD/messagewindow.cpp \
+    $$PWD/audiodevicemanager.cpp \
+    $$PWD/audioformatconverter.cpp \
+    $$PWD/audioresampler.cpp \
+    $$PWD/callrecorder.cpp \
+    $$PWD/callqualitymonitor.cpp \
+    $$PWD/socketframequeue.cpp \
+    $$PWD/chatoutbox.cpp \
+    $$PWD/filetransfermanager.cpp \
+    $$PWD/filetransferworker.cpp \
+    $$PWD/attachmentstore.cpp \
+    $$PWD/thumbnailpipeline.cpp \
+    $$PWD/chathistorystore.cpp \
+    $$PWD/chatexportformat.cpp \
+    $$PWD/chatexporter.cpp \
+    $$PWD/themeengine.cpp \
+    $$PWD/startuptracer.cpp \
+    $$PWD/tracer.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/metricsserver.cpp \
+    $$PWD/deferredinit.cpp \
+    $$PWD/rostermodel.cpp \
+    $$PWD/rosterdelegate.cpp \
+    $$PWD/rosterupdatescheduler.cpp \
+    $$PWD/networkclient.cpp \
+    $$PWD/rostersearchindex.cpp \
+    $$PWD/rosterfiltermodel.cpp \
+    $$PWD/rostergroupmodel.cpp \
+    $$PWD/contacthotset.cpp \
+    $$PWD/presencesubscriptions.cpp \
+    $$PWD/clientservices.cpp
+
+HEADERS += \
+    $$PWD/clientdata.h \
+    $$PWD/mainwindow.h \
+    $$PWD/clientwindow.h \
+    $$PWD/clientwidget.h \
+    $$PWD/conferancecallwindow.h \
+    $$PWD/messagewindow.h \
+    $$PWD/audiodevicemanager.h \
+    $$PWD/audioformatconverter.h \
+    $$PWD/audioresampler.h \
+    $$PWD/callrecorder.h \
+    $$PWD/callqualitymonitor.h \
+    $$PWD/socketframequeue.h \
+    $$PWD/chatoutbox.h \
+    $$PWD/filetransfermanager.h \
+    $$PWD/filetransferworker.h \
+    $$PWD/attachmentstore.h \
+    $$PWD/thumbnailpipeline.h \
+    $$PWD/chathistorystore.h \
+    $$PWD/chatexportformat.h \
+    $$PWD/chatexporter.h \
+    $$PWD/themeengine.h \
+    $$PWD/startuptracer.h \
+    $$PWD/tracer.h \
+    $$PWD/metrics.h \
+    $$PWD/metricsserver.h \
+    $$PWD/deferredinit.h \
+    $$PWD/rostermodel.h \
+    $$PWD/rosterdelegate.h \
+    $$PWD/rosterupdatescheduler.h \
+    $$PWD/networkclient.h \
+    $$PWD/rostersearchindex.h \
+    $$PWD/rosterfiltermodel.h \
+    $$PWD/rostergroupmodel.h \
+    $$PWD/contacthotset.h \
+    $$PWD/presencesubscriptions.h \
+    $$PWD/clientservices.h \
+    $$PWD/spscringbuffer.h
+
+FORMS += \
+    $$PWD/mainwindow.ui
@@ -5,8 +5,7 @@
 #include <QMainWindow>
 #include <QLayout>
 #include <QPushButton>
-#include <QListWidget>
-#include <QListWidgetItem>
+#include <QListView>
 #include <QLabel>
 #include <QComboBox>
 #include <QDebug>
@@ -23,6 +22,11 @@
 #include <QApplication>
 #include <QMessageBox>
 #include "clientwidget.h"
+#include "deferredinit.h"
+#include "startuptracer.h"
+#include "tracer.h"
+#include "metrics.h"
+#include "networkclient.h"
 #include <QStandardPaths>
 #include <QSettings>
 #include <QPainter>
@@ -30,13 +34,21 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonValue>
-#include <QMediaDevices>
-#include <QAudioSource>
-#include <QAudioFormat>
-
-ClientWindow::ClientWindow(MainWindow *mainwindow, QWidget *parent)
-    : QMainWindow(parent), mainWindow(mainwindow)
+#include <QStatusBar>
+#include <QShortcut>
+#include <QMenu>
+#include <QUuid>
+#include <QDateTime>
+#include <QDir>
+#include <algorithm>
+
+ClientWindow::ClientWindow(MainWindow *mainwindow, const AccountData &account, ClientServices *services,
+                           QWidget *parent)
+    : QMainWindow(parent), mainWindow(mainwindow), account(account), services(services)
 {
+    setWindowTitle(account.id());
+
+    StartupTracer::Phase layoutPhase("ClientWindow::layouts");
     mainWidget = new QWidget(this);
     setCentralWidget(mainWidget);
 
@@ -65,25 +77,97 @@ ClientWindow::ClientWindow(MainWindow *mainwindow, QWidget *parent)
     // Top box setup with proper initial connection status
     clientStatusCircle = new QLabel(this);
     clientStatusCircle->setFixedSize(25, 25);
-    clientStatusCircle->setStyleSheet("border-radius: 12px; background-color: red;");
+    ThemeEngine::applyStatusIndicator(clientStatusCircle, false);
     clientName = new QLabel("Not Connected to Server", this);
     themeBtn = new QPushButton("Dark/Light Mode", this);
     exitBtn = new QPushButton("Exit", this);
     logout = new QPushButton("Logout", this);
+    addAccountBtn = new QPushButton("Add Account", this);
 
     topBox->addWidget(clientStatusCircle, 1);
     topBox->addWidget(clientName, 1);
     topBox->addWidget(themeBtn, 1);
     topBox->addWidget(exitBtn, 1);
     topBox->addWidget(volumeSlider, 1);
+    topBox->addWidget(addAccountBtn, 1);
     topBox->addWidget(logout, 1);
 
-    // Client list setup
-    clientList = new QListWidget(this);
+    // Client list setup. Rows are painted by the delegate and presence
+    // updates reach the model at most once per frame.
+    rosterModel = new RosterModel(this);
+    rosterFilter = new RosterFilterModel(rosterModel, this);
+    rosterGroups = new RosterGroupModel(this);
+    rosterGroups->setSourceModel(rosterFilter);
+    clientList = new QListView(this);
+    clientList->setModel(rosterGroups);
+    clientList->setUniformItemSizes(true);
+    RosterDelegate *rosterDelegate = new RosterDelegate(clientList);
+    clientList->setItemDelegate(rosterDelegate);
+    connect(rosterDelegate, &RosterDelegate::messageClicked, this, &ClientWindow::showMessageScreen);
+    connect(rosterDelegate, &RosterDelegate::headerClicked, rosterGroups, &RosterGroupModel::toggleGroup);
+
+    // Favorites and recent contacts are pinned above the directory and
+    // shown from the saved list until the server's roster arrives.
+    hotSet = new ContactHotSet(account.id(), this);
+    rosterGroups->setPinned(hotSet->nameSet());
+    connect(hotSet, &ContactHotSet::changed, this, [this]() {
+        rosterGroups->setPinned(hotSet->nameSet());
+        presence->setPinned(hotSet->names());
+    });
+    clientList->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(clientList, &QWidget::customContextMenuRequested, this, [this](const QPoint &pos) {
+        const QModelIndex index = clientList->indexAt(pos);
+        if (!index.isValid() || rosterGroups->isGroupHeader(index)) return;
+        const QString name = index.data(Qt::DisplayRole).toString();
+        const bool favorite = hotSet->isFavorite(name);
+        QMenu menu;
+        QAction *toggle = menu.addAction(favorite ? "Remove from favorites" : "Add to favorites");
+        if (menu.exec(clientList->viewport()->mapToGlobal(pos)) == toggle) {
+            hotSet->setFavorite(name, !favorite);
+        }
+    });
+    connect(rosterDelegate, &RosterDelegate::callClicked, this, [this](const QString &name) {
+        currentClient = name;
+        onCallBtnClicked();
+    });
+    rosterUpdates = new RosterUpdateScheduler(rosterModel, clientList, account.id(), this);
+    showHotSet();
+
+    // Presence is only subscribed for pinned contacts and what is on screen.
+    presence = new PresenceSubscriptions(rosterModel, clientList, this);
+    presence->setPinned(hotSet->names());
+
+    // Search filters per keystroke; the status box narrows it further.
+    // Search results keep their ranking instead of the sorted sections.
+    rosterSearch = new QLineEdit(this);
+    rosterSearch->setObjectName("rosterSearch");
+    rosterSearch->setPlaceholderText("Search contacts");
+    rosterSearch->setClearButtonEnabled(true);
+    connect(rosterSearch, &QLineEdit::textChanged, this, [this](const QString &text) {
+        rosterGroups->setSortingEnabled(text.trimmed().isEmpty());
+        rosterFilter->setQuery(text);
+    });
+    rosterStatusFilter = new QComboBox(this);
+    rosterStatusFilter->addItems({"All", "Online", "Busy", "Offline"});
+    connect(rosterStatusFilter, &QComboBox::currentIndexChanged, this, [this](int index) {
+        rosterFilter->setStatusFilter(index > 0 ? rosterStatusFilter->itemText(index) : QString());
+    });
+    rosterGrouping = new QComboBox(this);
+    rosterGrouping->addItem("No sections", RosterGroupModel::NoGrouping);
+    rosterGrouping->addItem("By department", RosterGroupModel::ByDepartment);
+    rosterGrouping->addItem("By extension", RosterGroupModel::ByDialplanPrefix);
+    connect(rosterGrouping, &QComboBox::currentIndexChanged, this, [this](int index) {
+        rosterGroups->setGroupBy(RosterGroupModel::GroupBy(rosterGrouping->itemData(index).toInt()));
+    });
+    QHBoxLayout *searchLayout = new QHBoxLayout();
+    searchLayout->addWidget(rosterSearch, 1);
+    searchLayout->addWidget(rosterStatusFilter);
+    searchLayout->addWidget(rosterGrouping);
 
     // Create left panel
     QWidget *leftPanel = new QWidget(this);
     QVBoxLayout *leftLayout = new QVBoxLayout(leftPanel);
+    leftLayout->addLayout(searchLayout);
     leftLayout->addWidget(clientList);
 
     // Create right panel
@@ -102,11 +186,15 @@ ClientWindow::ClientWindow(MainWindow *mainwindow, QWidget *parent)
     mainLayout->addLayout(MidBox);
     mainLayout->addLayout(makeConfCallLayout);
     mainWidget->setLayout(mainLayout);
+    layoutPhase.end();
 
     // Connect signals and apply theme
     connectSignals();
-    loadThemePreference();
-    applyTheme(isDarkTheme);
+    {
+        StartupTracer::Phase phase("ClientWindow::theme");
+        loadThemePreference();
+        applyTheme(isDarkTheme);
+    }
 
     // Set layout properties
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -121,6 +209,24 @@ ClientWindow::ClientWindow(MainWindow *mainwindow, QWidget *parent)
     themeBtn->setMinimumHeight(40);
     exitBtn->setMinimumHeight(40);
     logout->setMinimumHeight(40);
+
+    {
+        StartupTracer::Phase phase("ClientWindow::websocket");
+        initializeWebSocket();
+    }
+
+    // Audio and call plumbing is only needed once a call starts, so it is
+    // set up after the roster is on screen. Audio capture follows the
+    // system default input.
+    DeferredInit *deferred = new DeferredInit(this);
+    deferred->add("ClientWindow::initializeAudioDevice", [this]() { initializeAudioDevice(); });
+    deferred->add("ClientWindow::handleHardwareErrors", [this]() { handleHardwareErrors(); });
+    deferred->add("ClientWindow::setupCallRecording", [this]() { setupCallRecording(); });
+    deferred->add("ClientWindow::setupCallQuality", [this]() { setupCallQuality(); });
+    connect(deferred, &DeferredInit::finished, this, []() {
+        StartupTracer::mark("client ready");
+        StartupTracer::flush();
+    });
 }
 
 void ClientWindow::setupCallLayouts() {
@@ -148,8 +254,19 @@ void ClientWindow::setupCallLayouts() {
     ongoingCallWidget = new QWidget(this);
     ongoingCallLayout = new QVBoxLayout(ongoingCallWidget);
     ongoingClientLabel = new QLabel("Client Name", this);
+    callStatsLabel = new QLabel(this);
+    callStatsLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    QHBoxLayout *ongoingHeaderLayout = new QHBoxLayout();
+    ongoingHeaderLayout->addWidget(ongoingClientLabel, 1);
+    ongoingHeaderLayout->addWidget(callStatsLabel);
+    recordCall_btn = new QPushButton("Record", this);
+    recordCall_btn->setCheckable(true);
     leaveCall_btn = new QPushButton("End Call", this);
-    ongoingCallLayout->addWidget(ongoingClientLabel);
+    participantsBtn = new QPushButton("Participants", this);
+    participantsBtn->hide();
+    ongoingCallLayout->addLayout(ongoingHeaderLayout);
+    ongoingCallLayout->addWidget(participantsBtn);
+    ongoingCallLayout->addWidget(recordCall_btn);
     ongoingCallLayout->addWidget(leaveCall_btn);
     mainStack->addWidget(ongoingCallWidget);
 
@@ -169,59 +286,92 @@ void ClientWindow::setupCallLayouts() {
 }
 
 void ClientWindow::populateList() {
+    QList<RosterEntry> entries;
+    entries.reserve(clients.size());
     for (const auto &client : clients) {
-        QWidget *clientWidget = new QWidget(this);
-        QHBoxLayout *layout = new QHBoxLayout(clientWidget);
-        layout->setSpacing(10);
-        layout->setContentsMargins(5, 5, 5, 5);
+        entries.append({client.username, client.status, client.dialplan});
+    }
+    rosterUpdates->submitSnapshot(entries);
+}
 
-        QLabel *status = new QLabel(clientWidget);
-        status->setPixmap(getStatusIcon(client.status));
-        status->setFixedSize(16, 16);
+void ClientWindow::showMessageScreen(const QString &username) {
+    hotSet->touch(username);
+    mainStack->setCurrentWidget(ensureMessageWindow(username));
+}
 
-        QLabel *username = new QLabel(client.username, clientWidget);
-        username->setMinimumWidth(100);
+MessageWindow *ClientWindow::ensureMessageWindow(const QString &username) {
+    messageWindowOrder.removeOne(username);
+    messageWindowOrder.append(username);
 
-        QCheckBox *selectBox = new QCheckBox(clientWidget);
-        selectBox->hide();
+    if (messageWindows.contains(username)) {
+        return messageWindows[username];
+    }
 
-        QPushButton *msgBtn = new QPushButton("Msg", clientWidget);
-        msgBtn->setFixedWidth(60);
-        connect(msgBtn, &QPushButton::clicked, this, [this, username]() {
-            showMessageScreen(username->text());
-        });
+    if (!thumbnails) {
+        thumbnails = services->thumbnails();
+    }
+    if (!chatHistory) {
+        chatHistory = services->history();
+    }
 
-        QPushButton *callBtn = new QPushButton("Call", clientWidget);
-        callBtn->setFixedWidth(60);
-        connect(callBtn, &QPushButton::clicked, this, [this, username]() {
-            currentClient = username->text();
-            onCallBtnClicked();
-        });
+    MessageWindow *window = new MessageWindow(username, account.id(), isDarkTheme, chatHistory, this);
+    window->setThumbnailPipeline(thumbnails);
+    messageWindows[username] = window;
+    mainStack->addWidget(window);
 
-        layout->addWidget(status);
-        layout->addWidget(username, 1);
-        layout->addWidget(selectBox);
-        layout->addWidget(msgBtn);
-        layout->addWidget(callBtn);
-        layout->addStretch();
+    connect(window, &MessageWindow::backButtonClicked, this, &ClientWindow::showHomeScreen);
+    connect(window, &MessageWindow::closed, this, [this, username]() {
+        removeMessageWindow(username);
+    });
 
-        QListWidgetItem *item = new QListWidgetItem(clientList);
-        item->setSizeHint(clientWidget->sizeHint());
-        clientList->setItemWidget(item, clientWidget);
-    }
+    connect(window, &MessageWindow::historyCleared, this, [this](const QString &peer) {
+        if (attachmentStore) attachmentStore->releaseConversation(AttachmentStore::conversationKey(account.id(), peer));
+    });
+    connect(window, &MessageWindow::fileAttached, this, [this](const QString &recipient, const QString &filePath) {
+        if (fileTransfers) fileTransfers->sendFile(recipient, filePath);
+    });
+    connect(window, &MessageWindow::messageSent, this,
+            [this](const QString &recipient, const QString &message, const QString &messageId) {
+                if (chatOutbox) chatOutbox->enqueue(recipient, message, messageId);
+            });
+
+    // Typing and read receipts are low-priority and coalesced per peer.
+    connect(window, &MessageWindow::typingChanged, this, [this](const QString &recipient, bool typing) {
+        if (!frameQueue) return;
+        QJsonObject frame{{"type", "typing"}, {"to", recipient}, {"active", typing}};
+        frameQueue->enqueueCoalesced("typing:" + recipient,
+                                     QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+    });
+    connect(window, &MessageWindow::messagesRead, this, [this](const QString &sender, qint64 upTo) {
+        if (!frameQueue) return;
+        QJsonObject frame{{"type", "read"}, {"to", sender}, {"upTo", upTo}};
+        frameQueue->enqueueCoalesced("read:" + sender,
+                                     QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+    });
+
+    evictIdleMessageWindows(username);
+    return window;
 }
-void ClientWindow::showMessageScreen(const QString &username) {
-    if (!messageWindows.contains(username)) {
-        MessageWindow *window = new MessageWindow(username, isDarkTheme, this);
-        messageWindows[username] = window;
-        mainStack->addWidget(window);
-
-        connect(window, &MessageWindow::backButtonClicked, this, &ClientWindow::showHomeScreen);
-        connect(window, &MessageWindow::closed, this, [this, username]() {
-            removeMessageWindow(username);
-        });
+
+void ClientWindow::evictIdleMessageWindows(const QString &keep) {
+    qint64 total = 0;
+    for (MessageWindow *window : std::as_const(messageWindows)) {
+        total += window->memoryEstimate();
+    }
+
+    // Least recently used first; anything on screen or mid-transfer stays,
+    // and so does keep, the window the caller is about to hand out. An
+    // evicted chat is rebuilt from its history file when next opened.
+    const QStringList order = messageWindowOrder;
+    for (const QString &username : order) {
+        if (total <= MESSAGE_WINDOW_CACHE_BYTES) break;
+        if (username == keep) continue;
+        MessageWindow *window = messageWindows.value(username);
+        if (!window || !window->isIdle()) continue;
+
+        total -= window->memoryEstimate();
+        removeMessageWindow(username);
     }
-    mainStack->setCurrentWidget(messageWindows[username]);
 }
 
 void ClientWindow::showHomeScreen() {
@@ -232,6 +382,7 @@ void ClientWindow::removeMessageWindow(const QString &username) {
     if (messageWindows.contains(username)) {
         MessageWindow *window = messageWindows[username];
         messageWindows.remove(username);
+        messageWindowOrder.removeOne(username);
         mainStack->removeWidget(window);
         window->deleteLater();
     }
@@ -241,12 +392,21 @@ void ClientWindow::switchToLayout(int index) {
     switch(index) {
     case 0: // No call
         mainStack->setCurrentWidget(noCallWidget);
+        recordCall_btn->setChecked(false);
+        if (qualityMonitor) qualityMonitor->endSession();
+        callStatsLabel->clear();
+        conferenceId.clear();
+        conferenceParticipants.clear();
+        participantsBtn->hide();
+        if (conferenceWindow) conferenceWindow->setIdle();
+        if (audioManager) audioManager->releaseCapture(this);
         break;
     case 1: // Incoming call
         mainStack->setCurrentWidget(incomingCallWidget);
         break;
     case 2: // Ongoing call
         mainStack->setCurrentWidget(ongoingCallWidget);
+        if (audioManager) audioManager->acquireCapture(this);
         break;
     case 3: // Outgoing call
         mainStack->setCurrentWidget(outgoingCallWidget);
@@ -257,6 +417,10 @@ void ClientWindow::switchToLayout(int index) {
 void ClientWindow::setupConferenceUI() {
     QPushButton *conferenceToggle = new QPushButton("Conference Mode", this);
     makeConfCallLayout->addWidget(conferenceToggle);
+    QPushButton *newConference = new QPushButton("New Conference...", this);
+    makeConfCallLayout->addWidget(newConference);
+    connect(newConference, &QPushButton::clicked, this, [this]() { showConferenceWindow(); });
+    connect(participantsBtn, &QPushButton::clicked, this, [this]() { showConferenceWindow(); });
 
     conferencePanel = new QWidget(this);
     QVBoxLayout *confLayout = new QVBoxLayout(conferencePanel);
@@ -265,6 +429,9 @@ void ClientWindow::setupConferenceUI() {
     selectAllCheckbox = new QCheckBox("Select All", conferencePanel);
     confLayout->addWidget(selectAllCheckbox);
 
+    recordConferenceCheckbox = new QCheckBox("Record Conference", conferencePanel);
+    confLayout->addWidget(recordConferenceCheckbox);
+
     startConferenceBtn = new QPushButton("Start Conference", conferencePanel);
     confLayout->addWidget(startConferenceBtn);
 
@@ -273,80 +440,199 @@ void ClientWindow::setupConferenceUI() {
     connect(conferenceToggle, &QPushButton::clicked, this, &ClientWindow::toggleConferenceMode);
     connect(selectAllCheckbox, &QCheckBox::checkStateChanged, this, &ClientWindow::handleSelectAll);
     connect(startConferenceBtn, &QPushButton::clicked, this, &ClientWindow::startConference);
+    connect(rosterModel, &RosterModel::selectionChanged, this, [this]() {
+        const int selected = rosterModel->checkedCount();
+        startConferenceBtn->setText(selected > 0 ? QString("Start Conference (%1)").arg(selected)
+                                                 : QString("Start Conference"));
+    });
 }
 
 void ClientWindow::handleSelectAll(Qt::CheckState state) {
-    for (int i = 0; i < clientList->count(); i++) {
-        QWidget *widget = clientList->itemWidget(clientList->item(i));
-        QCheckBox *checkbox = widget->findChild<QCheckBox*>();
-        if (checkbox) {
-            checkbox->setCheckState(state);
-        }
-    }
+    rosterModel->setAllChecked(state == Qt::Checked);
 }
 
 void ClientWindow::toggleConferenceMode() {
     bool isConferenceMode = !conferencePanel->isVisible();
     conferencePanel->setVisible(isConferenceMode);
-
-    for (int i = 0; i < clientList->count(); i++) {
-        QWidget *widget = clientList->itemWidget(clientList->item(i));
-        widget->findChild<QCheckBox*>()->setVisible(isConferenceMode);
-    }
+    rosterModel->setCheckable(isConferenceMode);
 }
 
 void ClientWindow::startConference() {
-    QList<QString> selectedClients;
-
-    for (int i = 0; i < clientList->count(); i++) {
-        QWidget *widget = clientList->itemWidget(clientList->item(i));
-        QCheckBox *checkbox = widget->findChild<QCheckBox*>();
-        if (checkbox && checkbox->isChecked()) {
-            QLabel *username = widget->findChild<QLabel*>();
-            selectedClients.append(username->text());
-        }
-    }
-
-    if (selectedClients.size() < 2) {
+    if (rosterModel->checkedCount() < 2) {
         QMessageBox::warning(this, "Conference Call",
                              "Please select at least 2 participants");
         return;
     }
-
-    switchToLayout(2);
-    ongoingClientLabel->setText("Conference Call: " + selectedClients.join(", "));
+    if (!beginConference(rosterModel->checkedNames())) return;
+    if (recordConferenceCheckbox->isChecked()) {
+        recordCall_btn->setChecked(true);
+    }
     conferencePanel->hide();
+    rosterModel->setCheckable(false);
     selectAllCheckbox->setChecked(false);
     handleSelectAll(Qt::Unchecked);
 }
 
+int ClientWindow::conferenceLimit() const {
+    const int limit = conferenceWindow ? conferenceWindow->participantLimit()
+                                       : ConferanceCallWindow::DEFAULT_PARTICIPANT_LIMIT;
+    return std::min(limit, CallQualityMonitor::MAX_LEGS);
+}
+
+bool ClientWindow::beginConference(const QStringList &participants) {
+    // The picker enforces this, but Select All in the roster does not.
+    const int limit = conferenceLimit();
+    if (participants.size() > limit) {
+        QMessageBox::warning(this, "Conference Call",
+                             QString("A conference can have at most %1 participants; %2 are selected.")
+                                 .arg(limit).arg(participants.size()));
+        return false;
+    }
+
+    currentClient.clear();
+    switchToLayout(2);
+    initiateConferenceCall(participants);
+    startQualitySession(participants);
+    participantsBtn->show();
+    if (conferenceWindow) conferenceWindow->setInCall(participants);
+    return true;
+}
+
+void ClientWindow::initiateConferenceCall(const QList<QString> &participants) {
+    conferenceId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    conferenceParticipants = participants;
+    updateConferenceLabel();
+
+    // One invite for the whole conference; the server fans it out.
+    if (!frameQueue) return;
+    QJsonObject frame{{"type", "conference_invite"},
+                      {"id", conferenceId},
+                      {"participants", QJsonArray::fromStringList(participants)},
+                      {"record", recordConferenceCheckbox->isChecked()}};
+    frameQueue->enqueue(SocketFrameQueue::Signaling,
+                        QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+}
+
+void ClientWindow::updateConferenceLabel() {
+    // Name a few; a label listing thousands would lay out for seconds.
+    const int NAMED_PARTICIPANTS = 5;
+    QString label = "Conference Call: " + conferenceParticipants.mid(0, NAMED_PARTICIPANTS).join(", ");
+    if (conferenceParticipants.size() > NAMED_PARTICIPANTS) {
+        label += QString(" and %1 others").arg(conferenceParticipants.size() - NAMED_PARTICIPANTS);
+    }
+    ongoingClientLabel->setText(label);
+}
+
+void ClientWindow::showConferenceWindow() {
+    if (!conferenceWindow) {
+        conferenceWindow = new ConferanceCallWindow(rosterModel, this);
+        conferenceWindow->setWindowFlag(Qt::Window);
+        connect(conferenceWindow, &ConferanceCallWindow::startCallClicked, this, &ClientWindow::beginConference);
+        connect(conferenceWindow, &ConferanceCallWindow::participantsAdded, this, [this](const QStringList &names) {
+            updateConference(names, {});
+        });
+        connect(conferenceWindow, &ConferanceCallWindow::participantRemoved, this, [this](const QString &name) {
+            updateConference({}, {name});
+        });
+    }
+    if (!conferenceId.isEmpty()) {
+        conferenceWindow->setInCall(conferenceParticipants);
+    } else {
+        conferenceWindow->setIdle();
+    }
+    conferenceWindow->show();
+    conferenceWindow->raise();
+}
+
+void ClientWindow::updateConference(const QStringList &requested, const QStringList &removed) {
+    if (conferenceId.isEmpty()) return;
+
+    // Only the legs that changed are set up or torn down.
+    for (const QString &name : removed) {
+        conferenceParticipants.removeOne(name);
+        if (qualityMonitor) qualityMonitor->removeLeg(name);
+    }
+    QStringList added;
+    for (const QString &name : requested) {
+        if (conferenceParticipants.contains(name)) continue;
+        if (conferenceParticipants.size() >= conferenceLimit()) {
+            statusBar()->showMessage(QString("Conference is full at %1 participants; not everyone was added")
+                                         .arg(conferenceParticipants.size()), 5000);
+            break;
+        }
+        conferenceParticipants.append(name);
+        added.append(name);
+        if (qualityMonitor) qualityMonitor->addLeg(name);
+    }
+    updateConferenceLabel();
+    if (added.isEmpty() && removed.isEmpty()) return;
+
+    if (!frameQueue) return;
+    QJsonObject frame{{"type", "conference_update"}, {"id", conferenceId}};
+    if (!added.isEmpty()) frame["add"] = QJsonArray::fromStringList(added);
+    if (!removed.isEmpty()) frame["remove"] = QJsonArray::fromStringList(removed);
+    frameQueue->enqueue(SocketFrameQueue::Signaling,
+                        QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+}
+
 void ClientWindow::connectSignals() {
     connect(acceptCall_btn, &QPushButton::clicked, this, &ClientWindow::onOngoingCall);
     connect(leaveCall_btn, &QPushButton::clicked, [this]() { switchToLayout(0); });
     connect(endCall_btn, &QPushButton::clicked, [this]() { switchToLayout(0); });
     connect(rejectCall_btn, &QPushButton::clicked, [this]() { switchToLayout(0); });
     connect(logout, &QPushButton::clicked, this, &ClientWindow::onLogoutBtnClicked);
+    connect(addAccountBtn, &QPushButton::clicked, this, [this]() {
+        if (!mainWindow) return;
+        mainWindow->show();
+        mainWindow->raise();
+        mainWindow->activateWindow();
+    });
     connect(exitBtn, &QPushButton::clicked, this, &ClientWindow::onExitBtnClicked);
     connect(themeBtn, &QPushButton::clicked, this, &ClientWindow::toggleTheme);
+
+    QShortcut *traceShortcut = new QShortcut(QKeySequence("Ctrl+Shift+T"), this);
+    connect(traceShortcut, &QShortcut::activated, this, &ClientWindow::toggleTracing);
+}
+
+void ClientWindow::toggleTracing() {
+    // First press starts recording; each later press writes what has been
+    // recorded so far and keeps going.
+    if (!Tracer::isEnabled()) {
+        Tracer::setEnabled(true);
+        statusBar()->showMessage("Tracing started; press Ctrl+Shift+T again to save", 5000);
+        return;
+    }
+
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir dir(dataPath);
+    if (dataPath.isEmpty() || !dir.mkpath("traces")) {
+        qWarning() << "Failed to create traces directory in:" << dataPath;
+        return;
+    }
+    const QString path = dir.filePath(
+        "traces/trace-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".json");
+    if (Tracer::dump(path)) {
+        statusBar()->showMessage("Trace saved to " + path, 5000);
+    } else {
+        statusBar()->showMessage("Failed to save trace", 5000);
+    }
 }
 
 void ClientWindow::toggleTheme() {
+    TRACE_SCOPE("theme", "ClientWindow::toggleTheme");
     isDarkTheme = !isDarkTheme;
     applyTheme(isDarkTheme);
     saveThemePreference();
 
-    // Update theme for all message windows
+    // Hidden message windows only note the change and apply it when shown
     for (auto window : messageWindows) {
         window->updateTheme(isDarkTheme);
     }
 }
 
 void ClientWindow::applyTheme(bool isDark) {
-    QString styleSheet = isDark ? getDarkThemeStyleSheet() : getLightThemeStyleSheet();
-    mainWidget->setStyleSheet(styleSheet);
-    QString statusCircleStyle = QString("border-radius: 12px; background-color: %1;")
-                                    .arg(isDark ? "#404040" : "#e0e0e0");
-    clientStatusCircle->setStyleSheet(statusCircleStyle);
+    // The status circle keeps its connection colour across theme changes.
+    ThemeEngine::apply(this, isDark);
 }
 
 void ClientWindow::saveThemePreference() {
@@ -359,26 +645,6 @@ void ClientWindow::loadThemePreference() {
     isDarkTheme = settings.value("darkTheme", false).toBool();
 }
 
-QPixmap ClientWindow::getStatusIcon(const QString &status) {
-    QPixmap pixmap(16, 16);
-    pixmap.fill(Qt::transparent);
-    QPainter painter(&pixmap);
-    painter.setRenderHint(QPainter::Antialiasing);
-
-    if (status == "Online")
-        painter.setBrush(Qt::green);
-    else if (status == "Offline")
-        painter.setBrush(Qt::red);
-    else if (status == "Busy")
-        painter.setBrush(Qt::yellow);
-    else
-        painter.setBrush(Qt::gray);
-
-    painter.setPen(Qt::NoPen);
-    painter.drawEllipse(0, 0, 16, 16);
-    return pixmap;
-}
-
 void ClientWindow::handleIncomingCall(const QString &caller) {
     currentClient = caller;
     incomingClientLabel->setText(caller);
@@ -388,6 +654,7 @@ void ClientWindow::handleIncomingCall(const QString &caller) {
 void ClientWindow::onCallAccepted() {
     ongoingClientLabel->setText(currentClient);
     switchToLayout(2);
+    startQualitySession({currentClient});
 }
 
 void ClientWindow::onCallRejected() {
@@ -397,6 +664,7 @@ void ClientWindow::onCallRejected() {
 
 void ClientWindow::onCallBtnClicked() {
     if (!currentClient.isEmpty()) {
+        hotSet->touch(currentClient);
         outgoingClientLabel->setText(currentClient);
         switchToLayout(3);
     }
@@ -412,80 +680,38 @@ void ClientWindow::onLogoutBtnClicked() {
     this->close();
 }
 
-void ClientWindow::onExitBtnClicked() {
-    QApplication::quit();
-}
-
-QString ClientWindow::getDarkThemeStyleSheet()
-{
-    return R"(
-        QWidget {
-            background-color: #1E2922;
-            color: #E0E3DE;
-        }
-        QPushButton {
-            background-color: #3F4A3C;
-            border: 1px solid #2F3E2C;
-            padding: 5px;
-            border-radius: 4px;
-            color: white;
-        }
-        QListWidget {
-            background-color: #2A362F;
-            border: 1px solid #3F4A3C;
-        }
-    )";
+const AccountData &ClientWindow::accountData() const {
+    return account;
 }
 
-QString ClientWindow::getLightThemeStyleSheet()
-{
-    return R"(
-        QWidget {
-            background-color: #E0E3DE;
-            color: #2F3E2C;
-        }
-        QPushButton {
-            background-color: #4A5D45;
-            border: 1px solid #2F3E2C;
-            padding: 5px;
-            border-radius: 4px;
-            color: white;
-        }
-        QListWidget {
-            background-color: #FFFFFF;
-            border: 1px solid #A3A69F;
-        }
-    )";
+void ClientWindow::onExitBtnClicked() {
+    QApplication::quit();
 }
 
 void ClientWindow::onOngoingCall()
 {
     switchToLayout(2);
     ongoingClientLabel->setText(currentClient);
+    startQualitySession({currentClient});
 }
 
 void ClientWindow::handleServerUpdate(const QByteArray &data)
 {
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (!doc.isArray()) {
+    TRACE_SCOPE("roster", "ClientWindow::handleServerUpdate");
+
+    QList<RosterEntry> entries;
+    if (!NetworkClient::decodeRoster(data, &entries)) {
         qWarning() << "Invalid server data format.";
         return;
     }
+    handleRoster(entries);
+}
 
-    QJsonArray clientArray = doc.array();
-    clientList->clear();
-
-    for (const QJsonValue &value : clientArray) {
-        QJsonObject clientObj = value.toObject();
-        QString clientName = clientObj["name"].toString();
-        QString status = clientObj["status"].toString(); // "Online", "Offline", "Busy"
-
-        // Create a new ClientWidget for each client
-        QWidget *clientWidget = new ClientWidget(clientName, "", "", status, this);
-        QListWidgetItem *item = new QListWidgetItem(clientList);
-        item->setSizeHint(clientWidget->sizeHint());
-        clientList->setItemWidget(item, clientWidget);
-    }
+void ClientWindow::handleRoster(const QList<RosterEntry> &entries)
+{
+    TRACE_COUNTER("roster", "roster size", entries.size());
+    // Applied on the next frame; a newer snapshot before then replaces it.
+    rosterUpdates->submitSnapshot(entries);
 }
 
 void ClientWindow::handleVolumeChange(int value) {
@@ -494,51 +720,67 @@ void ClientWindow::handleVolumeChange(int value) {
 }
 
 void ClientWindow::handleWebSocketDisconnection() {
-    clientStatusCircle->setStyleSheet("background-color: red;");
+    ThemeEngine::applyStatusIndicator(clientStatusCircle, false);
     clientName->setText("Disconnected - Attempting to reconnect...");
-    clientList->clear();
+    rosterUpdates->clear();
+    rosterModel->clear();
+    if (chatOutbox) chatOutbox->setOnline(false);
+    if (fileTransfers) fileTransfers->setOnline(false);
 
     const int RECONNECT_INTERVAL = 5000;
     QTimer::singleShot(RECONNECT_INTERVAL, this, [this]() {
-        if (webSocket) {
-            webSocket->open(QUrl("ws://localhost:12345"));
+        if (network) {
+            static MetricCounter &reconnects = Metrics::counter("voip_ws_reconnects_total", "WebSocket reconnect attempts.");
+            reconnects.add();
+            network->open();
         }
     });
 }
 
-void ClientWindow::handleWebSocketError(QAbstractSocket::SocketError error) {
-    QString errorMessage = QString("Connection error: %1 (Code: %2)")
-    .arg(webSocket->errorString())
-        .arg(static_cast<int>(error));
+void ClientWindow::handleWebSocketError(const QString &error) {
+    QString errorMessage = QString("Connection error: %1").arg(error);
     clientName->setText(errorMessage);
     handleWebSocketDisconnection();
 }
 
 bool ClientWindow::initializeAudioDevice() {
-    const auto devices = QMediaDevices::audioInputs();
-    if (!devices.isEmpty()) {
-        audioFormat.setSampleRate(48000);
-        audioFormat.setChannelCount(2);
-
-        const QAudioDevice &defaultDevice = QMediaDevices::defaultAudioInput();
-        if (!defaultDevice.isFormatSupported(audioFormat)) {
-            QMessageBox::warning(this, "Audio Error", "Default format not supported");
-            return false;
-        }
-
-        audioDevice = new QAudioSource(defaultDevice, audioFormat, this);
-        return true;
+    if (!audioManager) {
+        audioManager = services->audio();
     }
 
-    QMessageBox::critical(this, "Audio Error", "No audio input device found");
-    return false;
+    if (!audioManager->hasInputDevice()) {
+        statusBar()->showMessage("No audio input device found", 5000);
+        return false;
+    }
+    return true;
 }
 
 
 // Add these implementations
 void ClientWindow::onWebSocketConnected() {
-    clientStatusCircle->setStyleSheet("background-color: green;");
+    ThemeEngine::applyStatusIndicator(clientStatusCircle, true);
     clientName->setText("Connected");
+
+    // Send whatever was written while offline
+    if (chatOutbox) {
+        chatOutbox->setOnline(true);
+        chatOutbox->flush();
+    }
+    if (fileTransfers) fileTransfers->setOnline(true);
+
+    // Ask for the hot set's presence ahead of the full directory.
+    showHotSet();
+    presence->sendNow();
+}
+
+void ClientWindow::showHotSet() {
+    // Only stands in until the roster arrives; it never replaces one.
+    if (rosterModel->rowCount() > 0) return;
+    QList<RosterEntry> entries;
+    for (const QString &name : hotSet->names()) {
+        entries.append({name, QString()});
+    }
+    if (!entries.isEmpty()) rosterUpdates->submitSnapshot(entries);
 }
 
 void ClientWindow::onWebSocketDisconnected() {
@@ -546,83 +788,214 @@ void ClientWindow::onWebSocketDisconnected() {
 }
 
 void ClientWindow::initializeWebSocket() {
-    webSocket = new QWebSocket();
-    connect(webSocket, &QWebSocket::connected, this, &ClientWindow::onWebSocketConnected);
-    connect(webSocket, &QWebSocket::disconnected, this, &ClientWindow::onWebSocketDisconnected);
-    connect(webSocket, &QWebSocket::errorOccurred, this, &ClientWindow::handleWebSocketError);
-    webSocket->open(QUrl("ws://localhost:12345"));
+    // Socket I/O and JSON decoding run on the network thread; the UI gets
+    // decoded batches through queued signals.
+    network = new NetworkClient(account.url(), account.id(), this);
+    frameQueue = network->frameQueue();
+    presence->setFrameQueue(frameQueue);
+    connect(presence, &PresenceSubscriptions::scopeChanged, network, &NetworkClient::setPresenceScope);
+    chatOutbox = new ChatOutbox(frameQueue, account.id(), this);
+    connect(chatOutbox, &ChatOutbox::stateChanged, this,
+            [this](const QString &recipient, const QString &id, ChatOutbox::State state) {
+                MessageWindow *window = messageWindows.value(recipient);
+                if (window) window->setMessageState(id, state);
+            });
+
+    // Shared with the other accounts; uploads are tracked per server and
+    // references per account and peer.
+    attachmentStore = services->attachments();
+    connect(attachmentStore, &AttachmentStore::quotaExceeded, this, [this](qint64 stored, qint64 quota) {
+        statusBar()->showMessage(QString("Attachments use %1 MB of a %2 MB quota; clear old chats to free space")
+                                     .arg(stored / (1024 * 1024)).arg(quota / (1024 * 1024)), 5000);
+    });
+    fileTransfers = new FileTransferManager(frameQueue, attachmentStore, account, this);
+    connect(network, &NetworkClient::binaryReceived, fileTransfers, &FileTransferManager::handleBinaryFrame);
+    connect(fileTransfers, &FileTransferManager::progress, this,
+            [this](const QString &peer, const QString &id, const QString &fileName,
+                   qint64 done, qint64 total, bool incoming) {
+                ensureMessageWindow(peer)->showTransferProgress(id, fileName, done, total, incoming);
+            });
+    connect(fileTransfers, &FileTransferManager::finished, this,
+            [this](const QString &peer, const QString &id, const QString &fileName,
+                   bool ok, const QString &localPath, bool incoming, const QByteArray &sha256) {
+                // Incoming blobs are referenced by the transfer worker itself.
+                if (ok && !incoming && !sha256.isEmpty()) {
+                    attachmentStore->addRef(sha256, AttachmentStore::conversationKey(account.id(), peer));
+                }
+                ensureMessageWindow(peer)->finishTransfer(id, fileName, ok, localPath, incoming);
+            });
+    connect(network, &NetworkClient::connected, this, &ClientWindow::onWebSocketConnected);
+    connect(network, &NetworkClient::disconnected, this, &ClientWindow::onWebSocketDisconnected);
+    connect(network, &NetworkClient::errorOccurred, this, &ClientWindow::handleWebSocketError);
+    connect(network, &NetworkClient::rosterReceived, this, &ClientWindow::handleRoster);
+    connect(network, &NetworkClient::controlReceived, this, [this](const QList<QJsonObject> &messages) {
+        TRACE_SCOPE("control", "ClientWindow::controlBatch");
+        for (const QJsonObject &message : messages) {
+            handleControlMessage(message);
+        }
+    });
+    network->open();
 }
 
 
+void ClientWindow::handleControlMessage(const QJsonObject &message) {
+    const QString type = message["type"].toString();
 
-void ClientWindow::handleHardwareErrors() {
-    if (audioDevice) {
-        connect(audioDevice, &QAudioSource::stateChanged, this,
-                [this](QAudio::State state) {
-                    if (state == QAudio::StoppedState) {
-                        if (audioDevice->error() != QAudio::NoError) {
-                            QString errorStr = QString("Audio error occurred");
-                            QMessageBox::warning(this, "Hardware Error", errorStr);
-                            initializeAudioDevice();
-                        }
-                    }
-                });
+    if (type.startsWith("file_")) {
+        if (fileTransfers) fileTransfers->handleControl(message);
+        return;
     }
-}
 
-ClientWindow::~ClientWindow() {
-    // Clean up message windows with proper Qt parent-child cleanup
-    for (auto window : messageWindows) {
-        window->deleteLater();
+    if (type == "chat") {
+        const QString from = message["from"].toString();
+        if (from.isEmpty()) return;
+        ensureMessageWindow(from)->receiveMessage(from, message["text"].toString());
+    } else if (type == "typing") {
+        MessageWindow *window = messageWindows.value(message["from"].toString());
+        if (window) window->setPeerTyping(message["active"].toBool());
+    } else if (type == "read") {
+        MessageWindow *window = messageWindows.value(message["from"].toString());
+        if (window) window->setPeerReadUpTo(qint64(message["upTo"].toDouble()));
+    } else if (type == "ack" || type == "delivered") {
+        if (!chatOutbox) return;
+        QStringList ids;
+        for (const QJsonValue &id : message["ids"].toArray()) {
+            ids.append(id.toString());
+        }
+        if (type == "ack") {
+            chatOutbox->handleAck(ids);
+        } else {
+            chatOutbox->handleDelivered(ids);
+        }
+    } else if (type == "presence") {
+        rosterUpdates->submitChange(message["name"].toString(), message["status"].toString());
+    } else if (type == "rtcp") {
+        if (!qualityMonitor) return;
+        qualityMonitor->onReceiverReport(qualityMonitor->legIndex(message["leg"].toString()),
+                                         message["fractionLost"].toDouble(),
+                                         message["jitter"].toDouble(),
+                                         message["rtt"].toDouble());
     }
-    messageWindows.clear();
+}
 
-    // WebSocket cleanup
-    if (webSocket) {
-        webSocket->close();
-        delete webSocket;
-        webSocket = nullptr;
-    }
+void ClientWindow::handleHardwareErrors() {
+    if (!audioManager) return;
+
+    // Report device problems without blocking the event loop; the manager
+    // keeps the call alive on whatever input is available.
+    connect(audioManager, &AudioDeviceManager::deviceChanged, this,
+            [this](const QAudioDevice &device) {
+                statusBar()->showMessage("Audio input: " + device.description(), 3000);
+            });
+    connect(audioManager, &AudioDeviceManager::deviceLost, this, [this]() {
+        statusBar()->showMessage("Audio input disconnected", 5000);
+    });
+    connect(audioManager, &AudioDeviceManager::errorOccurred, this,
+            [this](const QString &message) {
+                statusBar()->showMessage("Hardware Error: " + message, 5000);
+            });
+}
 
-    // Audio device cleanup
-    if (audioDevice) {
-        audioDevice->stop();
-        delete audioDevice;
-        audioDevice = nullptr;
+void ClientWindow::setupCallRecording() {
+    callRecorder = new CallRecorder(this);
+    if (audioManager) {
+        audioManager->addSink(callRecorder->sink());
     }
 
-    // Reset system volume
-    system("amixer -c 0 sset Master 50%");
-
-    // UI widgets cleanup - setting nullptr after deletion
-    delete mainWidget;
-    mainWidget = nullptr;
+    connect(recordCall_btn, &QPushButton::toggled, this, &ClientWindow::setCallRecording);
+    connect(callRecorder, &CallRecorder::recordingStarted, this, [this](const QString &filePath) {
+        statusBar()->showMessage("Recording to " + filePath, 5000);
+    });
+    connect(callRecorder, &CallRecorder::errorOccurred, this, [this](const QString &message) {
+        statusBar()->showMessage("Recording Error: " + message, 5000);
+        recordCall_btn->setChecked(false);
+    });
+}
 
-    delete clientStatusCircle;
-    clientStatusCircle = nullptr;
+void ClientWindow::setCallRecording(bool enabled) {
+    if (!callRecorder) return;
 
-    delete clientName;
-    clientName = nullptr;
+    if (enabled) {
+        const QString label = currentClient.isEmpty() ? QString("conference") : currentClient;
+        if (!callRecorder->start(label)) {
+            recordCall_btn->setChecked(false);
+            return;
+        }
+        recordCall_btn->setText("Stop Recording");
+    } else {
+        callRecorder->stop();
+        recordCall_btn->setText("Record");
+    }
+}
 
-    delete themeBtn;
-    themeBtn = nullptr;
+void ClientWindow::setupCallQuality() {
+    qualityMonitor = new CallQualityMonitor(this);
+    connect(qualityMonitor, &CallQualityMonitor::statsUpdated, this, &ClientWindow::updateCallStats);
+
+    // One sample per leg of the call in progress; nothing between calls.
+    // Labelled by account, since each signed-in account has its own calls.
+    const QString accountLabel = Metrics::labelValue(account.id());
+    auto perLeg = [monitor = qualityMonitor, accountLabel](float CallQualitySample::*field) {
+        QList<MetricSample> samples;
+        if (!monitor->isActive()) return samples;
+        for (int leg = 0; leg < monitor->legCount(); ++leg) {
+            const CallQualitySample sample = monitor->latest(leg);
+            if (!sample.valid) continue;
+            const QString name = Metrics::labelValue(monitor->legName(leg));
+            samples.append({QString("account=\"%1\",leg=\"%2\"").arg(accountLabel, name),
+                            double(sample.*field)});
+        }
+        return samples;
+    };
+    Metrics::addCollector(qualityMonitor, "voip_call_jitter_ms", "Interarrival jitter per call leg.", "gauge",
+                          [perLeg]() { return perLeg(&CallQualitySample::jitterMs); });
+    Metrics::addCollector(qualityMonitor, "voip_call_loss_percent", "Packet loss per call leg.", "gauge",
+                          [perLeg]() { return perLeg(&CallQualitySample::lossPercent); });
+}
 
-    delete exitBtn;
-    exitBtn = nullptr;
+void ClientWindow::startQualitySession(const QStringList &legs) {
+    if (!qualityMonitor) return;
+    qualityMonitor->beginSession(legs);
+    callStatsLabel->setText("Collecting call statistics...");
+}
 
-    delete logout;
-    logout = nullptr;
+void ClientWindow::updateCallStats() {
+    // Conferences show their worst leg; that is the one users complain about.
+    callStatsLabel->setText(CallQualityMonitor::formatSample(qualityMonitor->worstLeg()));
+}
 
-    delete clientList;
-    clientList = nullptr;
+ClientWindow::~ClientWindow() {
+    // Clean up message windows with proper Qt parent-child cleanup
+    for (auto window : messageWindows) {
+        window->deleteLater();
+    }
+    messageWindows.clear();
 
-    delete conferencePanel;
-    conferencePanel = nullptr;
+    // Both hold the frame queue, which goes away with the network client,
+    // so they must not outlive it.
+    delete fileTransfers;
+    fileTransfers = nullptr;
+    delete chatOutbox;
+    chatOutbox = nullptr;
+
+    // WebSocket cleanup; joins the network thread
+    if (network) {
+        delete network;
+        network = nullptr;
+        frameQueue = nullptr;
+    }
 
-    delete selectAllCheckbox;
-    selectAllCheckbox = nullptr;
+    // Recording cleanup
+    if (callRecorder) {
+        callRecorder->stop();
+    }
 
-    delete startConferenceBtn;
-    startConferenceBtn = nullptr;
+    // The device is shared with the other accounts; only this window's
+    // hold on it ends here.
+    if (audioManager) {
+        if (callRecorder) audioManager->removeSink(callRecorder->sink());
+        audioManager->releaseCapture(this);
+        audioManager = nullptr;
+    }
 }
 
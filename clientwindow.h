@@ -7,10 +7,10 @@
 #include <QMainWindow>
 #include <QLayout>
 #include <QPushButton>
-#include <QListWidget>
-#include <QListWidgetItem>
+#include <QListView>
 #include <QLabel>
 #include <QComboBox>
+#include <QLineEdit>
 #include <QDebug>
 #include <QInputDialog>
 #include <QFile>
@@ -18,6 +18,7 @@
 #include <QRegularExpression>
 #include <QRegularExpressionMatch>
 #include <QProcess>
+#include <QJsonObject>
 #include "mainwindow.h"
 #include "clientdata.h"
 #include <QSlider>
@@ -25,11 +26,25 @@
 #include <messagewindow.h>
 #include <QStackedLayout>
 #include <QStackedWidget>
-#include <QAudioDevice>
-#include <QMediaDevices>
-#include <QAudioSource>
+#include "audiodevicemanager.h"
+#include "callrecorder.h"
+#include "callqualitymonitor.h"
+#include "socketframequeue.h"
+#include "chatoutbox.h"
+#include "filetransfermanager.h"
+#include "attachmentstore.h"
+#include "themeengine.h"
+#include "rostermodel.h"
+#include "rosterfiltermodel.h"
+#include "rostergroupmodel.h"
+#include "contacthotset.h"
+#include "presencesubscriptions.h"
+#include "clientservices.h"
+#include "rosterdelegate.h"
+#include "rosterupdatescheduler.h"
 
 class ConferanceCallWindow;
+class NetworkClient;
 class MainWindow;
 
 class ClientWindow : public QMainWindow {
@@ -37,7 +52,10 @@ class ClientWindow : public QMainWindow {
 
 public:
     explicit ClientWindow(QWidget *parent = nullptr);
-    explicit ClientWindow(MainWindow *mainWindow, QWidget *parent = nullptr);
+    // One per signed-in account, each with its own connection, roster and
+    // calls; devices and stores come from services.
+    ClientWindow(MainWindow *mainWindow, const AccountData &account, ClientServices *services,
+                 QWidget *parent = nullptr);
     ClientWindow();
     ~ClientWindow();
 
@@ -51,6 +69,7 @@ public:
     void onLogoutBtnClicked();
     void onExitBtnClicked();
     QList<QString> getSelectedClients();
+    const AccountData &accountData() const;
 
 public slots:
     void handleIncomingCall(const QString &caller);
@@ -60,6 +79,7 @@ public slots:
     void showHomeScreen();
     void showMessageScreen(const QString &username);
     void handleServerUpdate(const QByteArray &data);
+    void handleRoster(const QList<RosterEntry> &entries);
 
 private:
     void setupCallLayouts();
@@ -68,29 +88,53 @@ private:
     void saveThemePreference();
     void setupUI();
     void setupConnections();
-    QString getDarkThemeStyleSheet();
-    QString getLightThemeStyleSheet();
     void toggleTheme();
+    void toggleTracing();
     void applyTheme(bool isDark);
     void setupConferenceUI();
     void handleSelectAll(Qt::CheckState state);
     void startConference();
     void initiateConferenceCall(const QList<QString>& participants);
+    bool beginConference(const QStringList &participants);
+    void updateConference(const QStringList &requested, const QStringList &removed);
+    void updateConferenceLabel();
+    int conferenceLimit() const;
+    void showConferenceWindow();
+    ConferanceCallWindow *conferenceWindow = nullptr;
+    QPushButton *participantsBtn;
+    QString conferenceId;
+    QStringList conferenceParticipants;
     void toggleConferenceMode();
-    QPixmap getStatusIcon(const QString &status);
 
-    QWebSocket *webSocket;
+    NetworkClient *network = nullptr;
+    SocketFrameQueue *frameQueue = nullptr;
+    ChatOutbox *chatOutbox = nullptr;
+    FileTransferManager *fileTransfers = nullptr;
+    AttachmentStore *attachmentStore = nullptr;
+    ThumbnailPipeline *thumbnails = nullptr;
+    ChatHistoryStore *chatHistory = nullptr;
     void initializeWebSocket();
+    void showHotSet();
     void onWebSocketConnected();
     void onWebSocketDisconnected();
     void handleWebSocketDisconnection();
     bool initializeAudioDevice();
     void handleHardwareErrors();
-    void handleWebSocketError(QAbstractSocket::SocketError error);
+    void setupCallRecording();
+    void setCallRecording(bool enabled);
+    void setupCallQuality();
+    void startQualitySession(const QStringList &legs);
+    void updateCallStats();
+    void handleWebSocketError(const QString &error);
+    void handleControlMessage(const QJsonObject &message);
 
     // Message window related
     QMap<QString, MessageWindow*> messageWindows;
     void openMessageWindow(const QString &username);
+    MessageWindow *ensureMessageWindow(const QString &username);
+    void evictIdleMessageWindows(const QString &keep);
+    QStringList messageWindowOrder;
+    static const int MESSAGE_WINDOW_CACHE_BYTES = 32 * 1024 * 1024;
     QStackedWidget *mainStack;
     QWidget *homeScreen;
     QWidget *rightPanel;
@@ -98,6 +142,8 @@ private:
     bool isDarkTheme = false;
     QWidget *mainWidget;
     MainWindow *mainWindow;
+    AccountData account;
+    ClientServices *services;
 
     // Layouts
     QHBoxLayout *topBox;
@@ -115,6 +161,7 @@ private:
     // Conference related
     QWidget *conferencePanel;
     QCheckBox *selectAllCheckbox;
+    QCheckBox *recordConferenceCheckbox;
     QPushButton *startConferenceBtn;
 
     // Labels and widgets
@@ -124,6 +171,7 @@ private:
     QLabel *incomingCallLabel;
     QLabel *incomingClientLabel;
     QLabel *ongoingClientLabel;
+    QLabel *callStatsLabel;
     QLabel *outgoingCallLabel;
     QLabel *outgoingClientLabel;
     QWidget *noCallWidget;
@@ -135,19 +183,30 @@ private:
     QPushButton *themeBtn;
     QPushButton *exitBtn;
     QPushButton *logout;
+    QPushButton *addAccountBtn;
     QPushButton *acceptCall_btn;
     QPushButton *rejectCall_btn;
     QPushButton *leaveCall_btn;
+    QPushButton *recordCall_btn;
     QPushButton *endCall_btn;
 
     // Other members
-    QListWidget *clientList;
+    QListView *clientList;
+    RosterModel *rosterModel;
+    RosterFilterModel *rosterFilter;
+    RosterGroupModel *rosterGroups;
+    ContactHotSet *hotSet;
+    PresenceSubscriptions *presence;
+    QLineEdit *rosterSearch;
+    QComboBox *rosterStatusFilter;
+    QComboBox *rosterGrouping;
+    RosterUpdateScheduler *rosterUpdates;
     QList<ClientData> clients;
     QString currentClient;
 
-    QAudioSource *audioDevice;
-    QAudioFormat audioFormat;
-    QMediaDevices *mediaDevices;
+    AudioDeviceManager *audioManager = nullptr;
+    CallRecorder *callRecorder = nullptr;
+    CallQualityMonitor *qualityMonitor = nullptr;
     QSlider *volumeSlider;
     void handleVolumeChange(int value);
 };
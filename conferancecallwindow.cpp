@@ -1,68 +1,204 @@
-
 //conferancecallwindow.cpp
 #include "conferancecallwindow.h"
-#include <QObject>
-#include <QWidget>
-#include <QMainWindow>
-#include <QLayout>
-#include <QPushButton>
-#include <QListWidget>
-#include <QListWidgetItem>
-#include <QLabel>
-#include <QComboBox>
-#include <QDebug>
-#include <QInputDialog>
-#include <QFile>
-#include <QRegularExpression>
-#include <QRegularExpressionMatch>
-#include <QProcess>
-#include "mainwindow.h"
-#include "clientwindow.h"
-#include <QSlider>
-#include <QCloseEvent>
-#include <QApplication>
-#include <QMessageBox>
-
-ConferanceCallWindow::ConferanceCallWindow(QWidget *parent)
+#include "rostermodel.h"
+#include "rosterfiltermodel.h"
+#include <QIdentityProxyModel>
+#include <QSet>
+#include <QStatusBar>
+#include <algorithm>
+#include <functional>
+
+// Check boxes for the picker, kept apart from the roster's own conference
+// selection. People already in the call are shown checked and disabled.
+class ConferanceCallWindow::Selection : public QIdentityProxyModel
+{
+public:
+    explicit Selection(QObject *parent) : QIdentityProxyModel(parent) {}
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (role != Qt::CheckStateRole) return QIdentityProxyModel::data(index, role);
+        const QString name = index.data(Qt::DisplayRole).toString();
+        return locked.contains(name) || pickedSet.contains(name) ? Qt::Checked : Qt::Unchecked;
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override
+    {
+        Qt::ItemFlags result = QIdentityProxyModel::flags(index) | Qt::ItemIsUserCheckable;
+        if (locked.contains(index.data(Qt::DisplayRole).toString())) result &= ~Qt::ItemIsEnabled;
+        return result;
+    }
+
+    bool setData(const QModelIndex &index, const QVariant &value, int role) override
+    {
+        if (role != Qt::CheckStateRole) return QIdentityProxyModel::setData(index, value, role);
+        const QString name = index.data(Qt::DisplayRole).toString();
+        if (locked.contains(name)) return false;
+
+        if (value.toInt() == Qt::Checked) {
+            if (pickedSet.contains(name)) return false;
+            if (int(pickedSet.size() + locked.size()) >= limit) {
+                if (onLimit) onLimit();
+                return false;
+            }
+            picked.append(name);
+            pickedSet.insert(name);
+        } else {
+            if (!pickedSet.remove(name)) return false;
+            picked.removeOne(name);
+        }
+        emit dataChanged(index, index, {Qt::CheckStateRole});
+        if (onChanged) onChanged();
+        return true;
+    }
+
+    void reset(const QStringList &lockedNames)
+    {
+        picked.clear();
+        pickedSet.clear();
+        locked = QSet<QString>(lockedNames.cbegin(), lockedNames.cend());
+        if (rowCount() > 0) emit dataChanged(index(0, 0), index(rowCount() - 1, 0));
+        if (onChanged) onChanged();
+    }
+
+    QStringList picked;  // in the order they were checked
+    QSet<QString> pickedSet;
+    QSet<QString> locked;
+    int limit = 0;
+    std::function<void()> onLimit;
+    std::function<void()> onChanged;
+};
+
+ConferanceCallWindow::ConferanceCallWindow(RosterModel *roster, QWidget *parent)
     : QMainWindow (parent)
 {
-    QStringList clients = {"Client 1", "Client 2", "Client 3"};
+    setWindowTitle("Conference");
 
-    //layouts
-    ConfClientListLayout = new QVBoxLayout(this);
-    MakeCallLayout = new QHBoxLayout(this);
-    ConfWinMainLayout = new QVBoxLayout(this);
+    filter = new RosterFilterModel(roster, this);
+    selection = new Selection(this);
+    selection->setSourceModel(filter);
+    selection->limit = DEFAULT_PARTICIPANT_LIMIT;
+    selection->onLimit = [this]() {
+        statusBar()->showMessage(QString("A conference can have at most %1 participants").arg(selection->limit), 3000);
+    };
+    selection->onChanged = [this]() { updateControls(); };
 
-    createClientCheckboxes(clients);//creates checkboxes for every client in clients
+    search = new QLineEdit(this);
+    search->setPlaceholderText("Search contacts");
+    search->setClearButtonEnabled(true);
+    connect(search, &QLineEdit::textChanged, filter, &RosterFilterModel::setQuery);
 
-    //button layout
-    StartCall_btn = new QPushButton("Start call",this);
-    MakeCallLayout -> addWidget(StartCall_btn);
+    clientView = new QListView(this);
+    clientView->setModel(selection);
+    clientView->setUniformItemSizes(true);
 
+    participantList = new QListWidget(this);
+    participantList->hide();
 
-    ConfWinMainLayout -> addLayout(ConfClientListLayout);
-    ConfWinMainLayout -> addLayout(MakeCallLayout);
+    countLabel = new QLabel(this);
 
+    //button layout
+    MakeCallLayout = new QHBoxLayout();
+    removeBtn = new QPushButton("Remove", this);
+    removeBtn->hide();
+    StartCall_btn = new QPushButton("Start call", this);
+    MakeCallLayout->addWidget(countLabel, 1);
+    MakeCallLayout->addWidget(removeBtn);
+    MakeCallLayout->addWidget(StartCall_btn);
+    connect(StartCall_btn, &QPushButton::clicked, this, &ConferanceCallWindow::onStartCallBtnClicked);
+    connect(removeBtn, &QPushButton::clicked, this, &ConferanceCallWindow::onRemoveClicked);
+    connect(participantList, &QListWidget::itemSelectionChanged, this, &ConferanceCallWindow::updateControls);
+
+    ConfWinMainLayout = new QVBoxLayout();
+    ConfWinMainLayout->addWidget(participantList);
+    ConfWinMainLayout->addWidget(search);
+    ConfWinMainLayout->addWidget(clientView, 1);
+    ConfWinMainLayout->addLayout(MakeCallLayout);
 
     QWidget *centralWidget = new QWidget(this);
     centralWidget->setLayout(ConfWinMainLayout);
     setCentralWidget(centralWidget);
 
+    updateControls();
 }
 
-void ConferanceCallWindow::createClientCheckboxes(const QStringList &clients)
+void ConferanceCallWindow::setParticipantLimit(int limit)
 {
-    for (const QString &client : clients) {
-        QCheckBox *checkbox = new QCheckBox(client, this); // Create a checkbox for each client
-        checkboxes.append(checkbox);
-        ConfClientListLayout->addWidget(checkbox); // Add checkbox to layout
-    }
+    selection->limit = std::max(2, limit);
+    updateControls();
 }
 
+int ConferanceCallWindow::participantLimit() const
+{
+    return selection->limit;
+}
 
+void ConferanceCallWindow::setInCall(const QStringList &participants)
+{
+    inCall = true;
+    current = participants;
+    participantList->clear();
+    participantList->addItems(participants);
+    participantList->show();
+    removeBtn->show();
+    selection->reset(current);
+}
+
+void ConferanceCallWindow::setIdle()
+{
+    inCall = false;
+    current.clear();
+    participantList->clear();
+    participantList->hide();
+    removeBtn->hide();
+    selection->reset({});
+}
 
+bool ConferanceCallWindow::isInCall() const
+{
+    return inCall;
+}
 
-void ConferanceCallWindow::onStartCallBtnClicked() {
-    // Emit signal to notify Linphone that the button was clicked
-    emit startCallClicked();
+void ConferanceCallWindow::onStartCallBtnClicked()
+{
+    const QStringList picked = selection->picked;
+    if (picked.isEmpty()) return;
+
+    if (!inCall) {
+        emit startCallClicked(picked);
+        return;
+    }
+
+    // Only the newcomers are announced; everyone else stays connected.
+    current += picked;
+    participantList->addItems(picked);
+    selection->reset(current);
+    emit participantsAdded(picked);
+}
+
+void ConferanceCallWindow::onRemoveClicked()
+{
+    const QList<QListWidgetItem *> items = participantList->selectedItems();
+    for (QListWidgetItem *item : items) {
+        const QString name = item->text();
+        current.removeOne(name);
+        delete item;
+        emit participantRemoved(name);
+    }
+    selection->reset(current);
+}
+
+void ConferanceCallWindow::updateControls()
+{
+    const int picked = int(selection->picked.size());
+    if (inCall) {
+        StartCall_btn->setText(picked > 0 ? QString("Add %1").arg(picked) : QString("Add"));
+        StartCall_btn->setEnabled(picked > 0);
+        removeBtn->setEnabled(!participantList->selectedItems().isEmpty());
+        countLabel->setText(QString("%1 of %2 participants").arg(current.size() + picked).arg(selection->limit));
+    } else {
+        StartCall_btn->setText("Start call");
+        StartCall_btn->setEnabled(picked >= 2);
+        countLabel->setText(QString("%1 of %2 selected").arg(picked).arg(selection->limit));
+    }
 }
@@ -1,46 +1,69 @@
-    //conferancecallwindow.h
-    #ifndef CONFERANCECALLWINDOW_H
-    #define CONFERANCECALLWINDOW_H
-
-    #include <QObject>
-    #include <QWidget>
-    #include <QMainWindow>
-    #include <QLayout>
-    #include <QPushButton>
-    #include <QListWidget>
-    #include <QListWidgetItem>
-    #include <QLabel>
-    #include <QComboBox>
-    #include <QDebug>
-    #include <QCheckBox>
-    #include <QInputDialog>
-    #include <QFile>
-    #include <QRegularExpression>
-    #include <QRegularExpressionMatch>
-    #include <QProcess>
-    #include "mainwindow.h"
-    #include <QSlider>
-
-    class ConferanceCallWindow : public QMainWindow
-    {
-        Q_OBJECT
-    public:
-        explicit ConferanceCallWindow(QWidget *parent = nullptr);
-        //  ConferanceCallWindow();
-        void createClientCheckboxes(const QStringList &clients);
-        void onStartCall();
-        void onStartCallBtnClicked();
-
-        QList<QCheckBox*> checkboxes;
-        QPushButton *StartCall_btn;
-
-    private:
-        QVBoxLayout *ConfClientListLayout;
-        QHBoxLayout *MakeCallLayout;
-        QVBoxLayout *ConfWinMainLayout;
-
-    signals:
-        void startCallClicked();
-    };
-
-    #endif // CONFERANCECALLWINDOW_H
+//conferancecallwindow.h
+#ifndef CONFERANCECALLWINDOW_H
+#define CONFERANCECALLWINDOW_H
+
+#include <QObject>
+#include <QWidget>
+#include <QMainWindow>
+#include <QLayout>
+#include <QPushButton>
+#include <QListView>
+#include <QListWidget>
+#include <QLabel>
+#include <QLineEdit>
+#include <QStringList>
+
+class RosterModel;
+class RosterFilterModel;
+
+// Picks conference participants from the live roster. The roster is shown
+// through a search filter in a list view, so only the rows on screen are
+// painted. At most participantLimit() people can be picked. During a
+// call the window lists who is in it and adds or removes people one by
+// one, so the other legs are left alone.
+class ConferanceCallWindow : public QMainWindow
+{
+    Q_OBJECT
+public:
+    explicit ConferanceCallWindow(RosterModel *roster, QWidget *parent = nullptr);
+
+    void setParticipantLimit(int limit);
+    int participantLimit() const;
+
+    // Switches to managing a running conference with these participants.
+    void setInCall(const QStringList &participants);
+    // Back to picking people for a new conference.
+    void setIdle();
+    bool isInCall() const;
+
+signals:
+    void startCallClicked(const QStringList &participants);
+    void participantsAdded(const QStringList &names);
+    void participantRemoved(const QString &name);
+
+private:
+    class Selection;
+
+    void onStartCallBtnClicked();
+    void onRemoveClicked();
+    void updateControls();
+
+    RosterFilterModel *filter;
+    Selection *selection;
+    QLineEdit *search;
+    QListView *clientView;
+    QListWidget *participantList;
+    QLabel *countLabel;
+    QPushButton *StartCall_btn;
+    QPushButton *removeBtn;
+
+    QVBoxLayout *ConfWinMainLayout;
+    QHBoxLayout *MakeCallLayout;
+
+    bool inCall = false;
+    QStringList current;  // in the running conference
+
+    static const int DEFAULT_PARTICIPANT_LIMIT = 32;
+};
+
+#endif // CONFERANCECALLWINDOW_H
@@ -0,0 +1,82 @@
+//contacthotset.cpp
+#include "contacthotset.h"
+#include <QSettings>
+
+ContactHotSet::ContactHotSet(const QString &account, QObject *parent)
+    : QObject(parent), keyPrefix("accounts/" + account + "/")
+{
+    // Until an account saves its own lists it starts from the ones kept
+    // before lists were per account.
+    QSettings settings("YourCompany", "VoIPClient");
+    favoriteNames = settings.value(keyPrefix + "favoriteContacts",
+                                   settings.value("favoriteContacts")).toStringList();
+    recentNames = settings.value(keyPrefix + "recentContacts",
+                                 settings.value("recentContacts")).toStringList().mid(0, MAX_RECENTS);
+}
+
+QStringList ContactHotSet::favorites() const
+{
+    return favoriteNames;
+}
+
+QStringList ContactHotSet::recents() const
+{
+    return recentNames;
+}
+
+QStringList ContactHotSet::names() const
+{
+    QStringList result = favoriteNames;
+    for (const QString &name : recentNames) {
+        if (!favoriteNames.contains(name)) result.append(name);
+    }
+    return result;
+}
+
+QSet<QString> ContactHotSet::nameSet() const
+{
+    const QStringList all = names();
+    return QSet<QString>(all.cbegin(), all.cend());
+}
+
+bool ContactHotSet::isFavorite(const QString &name) const
+{
+    return favoriteNames.contains(name);
+}
+
+void ContactHotSet::setFavorite(const QString &name, bool favorite)
+{
+    if (name.isEmpty() || isFavorite(name) == favorite) return;
+    const bool wasRecent = recentNames.contains(name);
+    if (favorite) {
+        favoriteNames.append(name);
+    } else {
+        favoriteNames.removeOne(name);
+    }
+    save();
+    // A recent contact stays in the hot set either way.
+    if (!wasRecent) emit changed();
+}
+
+void ContactHotSet::touch(const QString &name)
+{
+    if (name.isEmpty()) return;
+    if (!recentNames.isEmpty() && recentNames.first() == name) return;
+
+    const bool known = favoriteNames.contains(name) || recentNames.contains(name);
+    recentNames.removeOne(name);
+    recentNames.prepend(name);
+    QString dropped;
+    if (recentNames.size() > MAX_RECENTS) {
+        dropped = recentNames.takeLast();
+    }
+    save();
+    if (!known || (!dropped.isEmpty() && !favoriteNames.contains(dropped))) emit changed();
+}
+
+void ContactHotSet::save() const
+{
+    QSettings settings("YourCompany", "VoIPClient");
+    settings.setValue(keyPrefix + "favoriteContacts", favoriteNames);
+    settings.setValue(keyPrefix + "recentContacts", recentNames);
+}
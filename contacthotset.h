@@ -0,0 +1,47 @@
+//contacthotset.h
+#ifndef CONTACTHOTSET_H
+#define CONTACTHOTSET_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// The few contacts a user actually reaches: favorites they pinned plus the
+// most recently called or messaged. Persisted in QSettings so the roster
+// can show them, and subscribe to their presence first, before the full
+// directory has arrived.
+class ContactHotSet : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Lists are kept per account; account is AccountData::id().
+    explicit ContactHotSet(const QString &account, QObject *parent = nullptr);
+
+    QStringList favorites() const;
+    QStringList recents() const;
+    // Favorites first, then recents not already among them.
+    QStringList names() const;
+    QSet<QString> nameSet() const;
+
+    bool isFavorite(const QString &name) const;
+    void setFavorite(const QString &name, bool favorite);
+    // Records a call or message to name.
+    void touch(const QString &name);
+
+signals:
+    // Emitted only when membership changes, not when recents reorder.
+    void changed();
+
+private:
+    void save() const;
+
+    QStringList favoriteNames;
+    QStringList recentNames;  // most recent first
+    QString keyPrefix;
+
+    static const int MAX_RECENTS = 20;
+};
+
+#endif // CONTACTHOTSET_H
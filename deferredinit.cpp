@@ -0,0 +1,62 @@
+//deferredinit.cpp
+#include "deferredinit.h"
+#include "startuptracer.h"
+#include <QEvent>
+#include <QTimer>
+
+DeferredInit::DeferredInit(QWidget *window)
+    : QObject(window), window(window)
+{
+    window->installEventFilter(this);
+    if (window->isVisible()) {
+        // Already on screen; ask for a frame so there is a paint to wait for.
+        window->update();
+    }
+}
+
+void DeferredInit::add(const char *name, std::function<void()> task)
+{
+    tasks.append({name, std::move(task)});
+    if (painted) {
+        schedule();
+    }
+}
+
+bool DeferredInit::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == window && event->type() == QEvent::Paint && !painted) {
+        painted = true;
+        StartupTracer::mark("first paint");
+        window->removeEventFilter(this);
+        // Queued behind the paint being delivered now, so the first task
+        // cannot hold up the frame.
+        schedule();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void DeferredInit::schedule()
+{
+    if (scheduled || tasks.isEmpty()) return;
+    scheduled = true;
+
+    QTimer::singleShot(0, this, &DeferredInit::runNext);
+}
+
+void DeferredInit::runNext()
+{
+    scheduled = false;
+    if (tasks.isEmpty()) return;
+
+    const Task task = tasks.takeFirst();
+    {
+        StartupTracer::Phase phase(task.name);
+        task.run();
+    }
+
+    if (tasks.isEmpty()) {
+        emit finished();
+    } else {
+        schedule();
+    }
+}
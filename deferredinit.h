@@ -0,0 +1,46 @@
+//deferredinit.h
+#ifndef DEFERREDINIT_H
+#define DEFERREDINIT_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QWidget>
+#include <functional>
+
+// Runs non-critical setup for a window after it has painted once, keyed off
+// the window's own first paint event and marked as "first paint" in the
+// startup trace. Tasks run in the order added, one per event loop turn, so
+// input that arrives in the meantime is handled between them. Each task is
+// a StartupTracer phase.
+class DeferredInit : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeferredInit(QWidget *window);
+
+    void add(const char *name, std::function<void()> task);
+
+signals:
+    void finished();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Task {
+        const char *name;
+        std::function<void()> run;
+    };
+
+    void schedule();
+    void runNext();
+
+    QPointer<QWidget> window;
+    QList<Task> tasks;
+    bool painted = false;
+    bool scheduled = false;
+};
+
+#endif // DEFERREDINIT_H
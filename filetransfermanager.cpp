@@ -0,0 +1,405 @@
+//filetransfermanager.cpp
+#include "filetransfermanager.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+const int kMaxNameAttempts = 1000;
+}
+
+FileTransferManager::FileTransferManager(SocketFrameQueue *queue, AttachmentStore *store, const AccountData &account,
+                                         QObject *parent)
+    : QObject(parent), queue(queue), store(store), server(account.server), accountId(account.id()),
+      worker(new FileTransferWorker(store))
+{
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+
+    connect(worker, &FileTransferWorker::fileHashed, this, &FileTransferManager::onFileHashed);
+    connect(worker, &FileTransferWorker::chunkRead, this, &FileTransferManager::onChunkRead);
+    connect(worker, &FileTransferWorker::outgoingHashReady, this, &FileTransferManager::onOutgoingHashReady);
+    connect(worker, &FileTransferWorker::outgoingFailed, this, &FileTransferManager::onOutgoingFailed);
+    connect(worker, &FileTransferWorker::chunkWritten, this, &FileTransferManager::onChunkWritten);
+    connect(worker, &FileTransferWorker::incomingFinished, this, &FileTransferManager::onIncomingFinished);
+
+    workerThread.setObjectName("FileTransferWorker");
+    workerThread.start(QThread::LowPriority);
+}
+
+FileTransferManager::~FileTransferManager()
+{
+    workerThread.quit();
+    workerThread.wait();
+}
+
+QString FileTransferManager::sendFile(const QString &recipient, const QString &filePath)
+{
+    QFileInfo info(filePath);
+    if (!info.isFile() || !info.isReadable()) {
+        qWarning() << "Cannot send attachment, file is not readable:" << filePath;
+        return QString();
+    }
+
+    const QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    Outgoing transfer;
+    transfer.peer = recipient;
+    transfer.path = info.absoluteFilePath();
+    transfer.name = info.fileName();
+    transfer.size = info.size();
+    transfer.sha256 = store->knownHashForFile(transfer.path);
+
+    if (!transfer.sha256.isEmpty() && store->isUploaded(transfer.sha256, server) && online) {
+        sendRef(id, transfer);
+        return id;
+    }
+
+    // Only pay for a hash pass when the server holds something of this
+    // exact size; otherwise the hash falls out of streaming anyway.
+    if (transfer.sha256.isEmpty() && store->hasUploadedOfSize(transfer.size, server)) {
+        transfer.hashing = true;
+        const QString path = transfer.path;
+        QMetaObject::invokeMethod(worker, [w = worker, id, path]() {
+            w->hashFile(id, path);
+        }, Qt::QueuedConnection);
+    }
+    outgoing.insert(id, transfer);
+
+    emit progress(recipient, id, transfer.name, 0, transfer.size, false);
+    if (online && !transfer.hashing) {
+        sendOffer(id, transfer);
+    }
+    return id;
+}
+
+void FileTransferManager::onFileHashed(const QString &id, const QByteArray &sha256)
+{
+    auto it = outgoing.find(id);
+    if (it == outgoing.end()) return;
+
+    it->hashing = false;
+    it->sha256 = sha256;
+    store->rememberFileHash(it->path, sha256);
+
+    if (!online) return;
+    if (store->isUploaded(sha256, server)) {
+        const Outgoing transfer = it.value();
+        outgoing.erase(it);
+        sendRef(id, transfer);
+    } else {
+        sendOffer(id, it.value());
+    }
+}
+
+void FileTransferManager::sendRef(const QString &id, const Outgoing &transfer)
+{
+    sendText(QJsonObject{{"type", "file_ref"},
+                         {"id", id},
+                         {"to", transfer.peer},
+                         {"name", transfer.name},
+                         {"size", transfer.size},
+                         {"sha256", QString::fromLatin1(transfer.sha256)}});
+    emit finished(transfer.peer, id, transfer.name, true, transfer.path, false, transfer.sha256);
+}
+
+void FileTransferManager::setOnline(bool isOnline)
+{
+    online = isOnline;
+
+    if (!online) {
+        // Nothing in flight survives a disconnect; wait for a fresh ack.
+        for (Outgoing &transfer : outgoing) {
+            transfer.accepted = false;
+        }
+        return;
+    }
+
+    for (auto it = outgoing.begin(); it != outgoing.end();) {
+        if (it->hashing) {
+            ++it;
+        } else if (!it->sha256.isEmpty() && store->isUploaded(it->sha256, server)) {
+            const QString id = it.key();
+            const Outgoing transfer = it.value();
+            it = outgoing.erase(it);
+            sendRef(id, transfer);
+        } else {
+            sendOffer(it.key(), it.value());
+            ++it;
+        }
+    }
+    for (auto it = incoming.cbegin(); it != incoming.cend(); ++it) {
+        if (it->fetching) {
+            sendText(QJsonObject{{"type", "file_fetch"}, {"id", it.key()}});
+        } else {
+            sendText(QJsonObject{{"type", "file_resume"}, {"id", it.key()}, {"offset", it->received}});
+        }
+    }
+}
+
+void FileTransferManager::sendText(const QJsonObject &frame)
+{
+    queue->enqueue(SocketFrameQueue::Chat,
+                   QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+}
+
+void FileTransferManager::sendOffer(const QString &id, const Outgoing &transfer)
+{
+    sendText(QJsonObject{{"type", "file_offer"},
+                         {"id", id},
+                         {"to", transfer.peer},
+                         {"name", transfer.name},
+                         {"size", transfer.size}});
+}
+
+void FileTransferManager::pump(const QString &id)
+{
+    auto it = outgoing.find(id);
+    if (it == outgoing.end() || !online || !it->accepted) return;
+
+    const qint64 window = qint64(CHUNK_BYTES) * WINDOW_CHUNKS;
+    while (it->requested < it->size && it->requested - it->acked < window) {
+        const qint64 offset = it->requested;
+        const qint64 length = std::min<qint64>(CHUNK_BYTES, it->size - offset);
+        const QString path = it->path;
+        QMetaObject::invokeMethod(worker, [w = worker, id, path, offset, length]() {
+            w->readChunk(id, path, offset, length);
+        }, Qt::QueuedConnection);
+        it->requested += length;
+    }
+
+    // Empty files still need a hash.
+    if (it->size == 0 && it->sha256.isEmpty()) {
+        const QString path = it->path;
+        QMetaObject::invokeMethod(worker, [w = worker, id, path]() {
+            w->readChunk(id, path, 0, 0);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void FileTransferManager::onChunkRead(const QString &id, qint64 offset, const QByteArray &data)
+{
+    auto it = outgoing.constFind(id);
+    if (it == outgoing.cend() || !online || !it->accepted || offset < it->acked) return;
+
+    QByteArray frame;
+    frame.reserve(HEADER_BYTES + data.size());
+    frame.append(QUuid::fromString(id).toRfc4122());
+    char offsetBytes[8];
+    qToBigEndian<quint64>(quint64(offset), offsetBytes);
+    frame.append(offsetBytes, 8);
+    frame.append(data);
+    queue->enqueueBinary(frame);
+}
+
+void FileTransferManager::onOutgoingHashReady(const QString &id, const QByteArray &sha256)
+{
+    auto it = outgoing.find(id);
+    if (it == outgoing.end()) return;
+    it->sha256 = sha256;
+    maybeComplete(id);
+}
+
+void FileTransferManager::onOutgoingFailed(const QString &id, const QString &error)
+{
+    Outgoing transfer = outgoing.take(id);
+    if (transfer.peer.isEmpty()) return;
+
+    qWarning() << "Attachment transfer failed:" << transfer.path << error;
+    sendText(QJsonObject{{"type", "file_cancel"}, {"id", id}});
+    QMetaObject::invokeMethod(worker, [w = worker, id]() { w->closeOutgoing(id); }, Qt::QueuedConnection);
+    emit finished(transfer.peer, id, transfer.name, false, transfer.path, false, QByteArray());
+}
+
+void FileTransferManager::maybeComplete(const QString &id)
+{
+    auto it = outgoing.find(id);
+    if (it == outgoing.end() || it->acked < it->size || it->sha256.isEmpty() || !online) return;
+
+    sendText(QJsonObject{{"type", "file_complete"}, {"id", id}, {"sha256", QString::fromLatin1(it->sha256)}});
+    const Outgoing transfer = it.value();
+    outgoing.erase(it);
+
+    store->markUploaded(transfer.sha256, transfer.size, server);
+    store->rememberFileHash(transfer.path, transfer.sha256);
+
+    QMetaObject::invokeMethod(worker, [w = worker, id]() { w->closeOutgoing(id); }, Qt::QueuedConnection);
+    emit finished(transfer.peer, id, transfer.name, true, transfer.path, false, transfer.sha256);
+}
+
+bool FileTransferManager::handleControl(const QJsonObject &message)
+{
+    const QString type = message["type"].toString();
+    const QString id = message["id"].toString();
+
+    if (type == "file_ack") {
+        auto it = outgoing.find(id);
+        if (it == outgoing.end()) return true;
+
+        const qint64 offset = qint64(message["offset"].toDouble());
+        if (!it->accepted) {
+            // First ack after an offer: this is where the server wants us
+            // to (re)start.
+            it->accepted = true;
+            it->acked = it->requested = std::clamp<qint64>(offset, 0, it->size);
+        } else {
+            it->acked = std::max(it->acked, std::min(offset, it->size));
+        }
+        emit progress(it->peer, id, it->name, it->acked, it->size, false);
+        pump(id);
+        maybeComplete(id);
+        return true;
+    }
+
+    if (type == "file_ref") {
+        const QString from = message["from"].toString();
+        const QString name = QFileInfo(message["name"].toString()).fileName();
+        const QByteArray sha256 = message["sha256"].toString().toLatin1().toLower();
+        if (from.isEmpty() || name.isEmpty() || sha256.isEmpty() || incoming.contains(id)) return true;
+
+        Incoming transfer;
+        transfer.peer = from;
+        transfer.name = name;
+        transfer.size = qint64(message["size"].toDouble());
+        transfer.finalPath = reserveDownloadPath(name);
+
+        if (store->contains(sha256)) {
+            incoming.insert(id, transfer);
+            const QString finalPath = transfer.finalPath;
+            const QString conversation = AttachmentStore::conversationKey(accountId, from);
+            QMetaObject::invokeMethod(worker, [w = worker, id, sha256, finalPath, conversation]() {
+                w->materialize(id, sha256, finalPath, conversation);
+            }, Qt::QueuedConnection);
+            return true;
+        }
+
+        // Not cached here; ask the server to stream it as a normal offer.
+        transfer.fetching = true;
+        incoming.insert(id, transfer);
+        sendText(QJsonObject{{"type", "file_fetch"}, {"id", id}});
+        emit progress(from, id, name, 0, transfer.size, true);
+        return true;
+    }
+
+    if (type == "file_offer") {
+        const QString from = message["from"].toString();
+        const QString name = QFileInfo(message["name"].toString()).fileName();
+        if (from.isEmpty() || name.isEmpty()) return true;
+
+        auto existing = incoming.find(id);
+        if (existing != incoming.end() && !existing->fetching) return true;
+
+        Incoming transfer;
+        if (existing != incoming.end()) {
+            transfer = existing.value();
+            transfer.fetching = false;
+        } else {
+            transfer.peer = from;
+            transfer.name = name;
+            transfer.finalPath = reserveDownloadPath(name);
+        }
+        transfer.size = qint64(message["size"].toDouble());
+        incoming.insert(id, transfer);
+
+        const QString partPath = transfer.finalPath + ".part";
+        QMetaObject::invokeMethod(worker, [w = worker, id, partPath]() {
+            w->openIncoming(id, partPath);
+        }, Qt::QueuedConnection);
+        sendText(QJsonObject{{"type", "file_ack"}, {"id", id}, {"offset", 0}});
+        emit progress(from, id, name, 0, transfer.size, true);
+        return true;
+    }
+
+    if (type == "file_complete") {
+        auto it = incoming.constFind(id);
+        if (it == incoming.cend()) return true;
+
+        const QString finalPath = it->finalPath;
+        const QByteArray sha256 = message["sha256"].toString().toLatin1();
+        const QString conversation = AttachmentStore::conversationKey(accountId, it->peer);
+        QMetaObject::invokeMethod(worker, [w = worker, id, finalPath, sha256, conversation]() {
+            w->finishIncoming(id, finalPath, sha256, conversation);
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
+    if (type == "file_cancel") {
+        Incoming transfer = incoming.take(id);
+        if (transfer.fetching) {
+            // Nothing was opened yet; just give the reserved name back.
+            QFile::remove(transfer.finalPath + ".part");
+        }
+        if (!transfer.peer.isEmpty()) {
+            QMetaObject::invokeMethod(worker, [w = worker, id]() { w->abortIncoming(id); }, Qt::QueuedConnection);
+            emit finished(transfer.peer, id, transfer.name, false, QString(), true, QByteArray());
+        }
+        return true;
+    }
+
+    return type == "file_resume";
+}
+
+void FileTransferManager::handleBinaryFrame(const QByteArray &frame)
+{
+    if (frame.size() < HEADER_BYTES) return;
+
+    const QString id = QUuid::fromRfc4122(QByteArrayView(frame.constData(), 16)).toString(QUuid::WithoutBraces);
+    if (!incoming.contains(id)) return;
+
+    const qint64 offset = qint64(qFromBigEndian<quint64>(frame.constData() + 16));
+    const QByteArray data = frame.mid(HEADER_BYTES);
+    QMetaObject::invokeMethod(worker, [w = worker, id, offset, data]() {
+        w->writeChunk(id, offset, data);
+    }, Qt::QueuedConnection);
+}
+
+void FileTransferManager::onChunkWritten(const QString &id, qint64 receivedBytes)
+{
+    auto it = incoming.find(id);
+    if (it == incoming.end()) return;
+
+    it->received = receivedBytes;
+    sendText(QJsonObject{{"type", "file_ack"}, {"id", id}, {"offset", receivedBytes}});
+    emit progress(it->peer, id, it->name, receivedBytes, it->size, true);
+}
+
+void FileTransferManager::onIncomingFinished(const QString &id, bool verified, const QString &path,
+                                             const QByteArray &sha256)
+{
+    Incoming transfer = incoming.take(id);
+    if (transfer.peer.isEmpty()) return;
+
+    if (verified) {
+        // The server evidently has it, so forwarding it later is free.
+        store->markUploaded(sha256, transfer.size, server);
+    }
+    emit finished(transfer.peer, id, transfer.name, verified, path, true, sha256);
+}
+
+QString FileTransferManager::reserveDownloadPath(const QString &fileName)
+{
+    QString downloads = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+    if (downloads.isEmpty()) {
+        downloads = QDir::homePath();
+    }
+
+    QDir dir(downloads);
+    QFileInfo info(fileName);
+    const QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    QString candidate = dir.filePath(fileName);
+    for (int n = 1; n < kMaxNameAttempts; ++n) {
+        // Creating the .part exclusively claims the name, so two offers
+        // for the same file name never end up sharing a path.
+        QFile reservation(candidate + ".part");
+        if (!QFile::exists(candidate) && reservation.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+            return candidate;
+        }
+        candidate = dir.filePath(QString("%1 (%2)%3").arg(info.completeBaseName()).arg(n).arg(suffix));
+    }
+    qWarning() << "No free download name for" << fileName;
+    return candidate;
+}
@@ -0,0 +1,98 @@
+//filetransfermanager.h
+#ifndef FILETRANSFERMANAGER_H
+#define FILETRANSFERMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QThread>
+#include "socketframequeue.h"
+#include "filetransferworker.h"
+#include "attachmentstore.h"
+#include "clientdata.h"
+
+// Sends and receives chat attachments over the shared socket. A file is
+// offered with a text frame and then streamed as binary chunks of
+// CHUNK_BYTES with at most WINDOW_CHUNKS unacknowledged, so memory stays
+// bounded for any file size. The server acknowledges the offset it holds;
+// after a reconnect the offer is repeated and sending resumes from that
+// offset. A SHA-256 of the whole file closes the transfer and is verified
+// by the receiver. Files whose hash the server already holds are sent as a
+// bare file_ref and never streamed again. The store may be shared with
+// other accounts; server says which PBX this manager talks to.
+class FileTransferManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileTransferManager(SocketFrameQueue *queue, AttachmentStore *store, const AccountData &account,
+                        QObject *parent = nullptr);
+    ~FileTransferManager();
+
+    QString sendFile(const QString &recipient, const QString &filePath);
+    void setOnline(bool online);
+
+    // Returns true if the message was a file transfer frame.
+    bool handleControl(const QJsonObject &message);
+    void handleBinaryFrame(const QByteArray &frame);
+
+signals:
+    void progress(const QString &peer, const QString &id, const QString &fileName,
+                  qint64 done, qint64 total, bool incoming);
+    void finished(const QString &peer, const QString &id, const QString &fileName,
+                  bool ok, const QString &localPath, bool incoming, const QByteArray &sha256);
+
+private slots:
+    void onChunkRead(const QString &id, qint64 offset, const QByteArray &data);
+    void onFileHashed(const QString &id, const QByteArray &sha256);
+    void onOutgoingHashReady(const QString &id, const QByteArray &sha256);
+    void onOutgoingFailed(const QString &id, const QString &error);
+    void onChunkWritten(const QString &id, qint64 receivedBytes);
+    void onIncomingFinished(const QString &id, bool verified, const QString &path, const QByteArray &sha256);
+
+private:
+    struct Outgoing {
+        QString peer;
+        QString path;
+        QString name;
+        qint64 size = 0;
+        qint64 acked = 0;
+        qint64 requested = 0;
+        QByteArray sha256;
+        bool accepted = false;
+        bool hashing = false;
+    };
+
+    struct Incoming {
+        QString peer;
+        QString name;
+        QString finalPath;
+        qint64 size = 0;
+        qint64 received = 0;
+        bool fetching = false;
+    };
+
+    void sendOffer(const QString &id, const Outgoing &transfer);
+    void sendRef(const QString &id, const Outgoing &transfer);
+    void pump(const QString &id);
+    void maybeComplete(const QString &id);
+    void sendText(const QJsonObject &frame);
+    static QString reserveDownloadPath(const QString &fileName);
+
+    SocketFrameQueue *queue;
+    AttachmentStore *store;
+    QString server;
+    QString accountId;
+    QThread workerThread;
+    FileTransferWorker *worker;
+    QHash<QString, Outgoing> outgoing;
+    QHash<QString, Incoming> incoming;
+    bool online = false;
+
+    static const int CHUNK_BYTES = 64 * 1024;
+    static const int WINDOW_CHUNKS = 8;
+    static const int HEADER_BYTES = 16 + 8;
+};
+
+#endif // FILETRANSFERMANAGER_H
@@ -0,0 +1,180 @@
+//filetransferworker.cpp
+#include "filetransferworker.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+namespace {
+
+// finalPath was free when the download started; if something has taken it
+// since, fall back to "name (n).ext" rather than overwrite or give up.
+QString freePath(const QString &finalPath)
+{
+    const QFileInfo info(finalPath);
+    const QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    QString candidate = finalPath;
+    for (int n = 1; QFile::exists(candidate) || (n > 1 && QFile::exists(candidate + ".part")); ++n) {
+        candidate = info.dir().filePath(QString("%1 (%2)%3").arg(info.completeBaseName()).arg(n).arg(suffix));
+    }
+    return candidate;
+}
+
+} // namespace
+
+FileTransferWorker::FileTransferWorker(AttachmentStore *store, QObject *parent)
+    : QObject(parent), store(store)
+{
+}
+
+void FileTransferWorker::hashFile(const QString &id, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit outgoingFailed(id, file.errorString());
+        return;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        emit outgoingFailed(id, file.errorString());
+        return;
+    }
+    emit fileHashed(id, hash.result().toHex());
+}
+
+void FileTransferWorker::readChunk(const QString &id, const QString &path, qint64 offset, qint64 length)
+{
+    QSharedPointer<Outgoing> state = outgoing.value(id);
+    if (!state) {
+        state.reset(new Outgoing);
+        state->file.setFileName(path);
+        if (!state->file.open(QIODevice::ReadOnly)) {
+            emit outgoingFailed(id, state->file.errorString());
+            return;
+        }
+        outgoing.insert(id, state);
+    }
+
+    QByteArray data;
+    if (length > 0) {
+        if (!state->file.seek(offset)) {
+            emit outgoingFailed(id, state->file.errorString());
+            return;
+        }
+        data = state->file.read(length);
+        if (data.size() != length) {
+            emit outgoingFailed(id, QString("Short read at offset %1").arg(offset));
+            return;
+        }
+    }
+
+    // Hash only bytes not seen before; resumed chunks were already hashed.
+    const qint64 end = offset + data.size();
+    if (offset <= state->hashedUpTo && end > state->hashedUpTo) {
+        const qint64 skip = state->hashedUpTo - offset;
+        state->hash.addData(QByteArrayView(data.constData() + skip, data.size() - skip));
+        state->hashedUpTo = end;
+    }
+
+    if (!data.isEmpty()) {
+        emit chunkRead(id, offset, data);
+    }
+
+    if (!state->hashReported && state->hashedUpTo >= state->file.size()) {
+        state->hashReported = true;
+        emit outgoingHashReady(id, state->hash.result().toHex());
+    }
+}
+
+void FileTransferWorker::closeOutgoing(const QString &id)
+{
+    outgoing.remove(id);
+}
+
+void FileTransferWorker::openIncoming(const QString &id, const QString &partPath)
+{
+    QSharedPointer<Incoming> state(new Incoming);
+    state->file.setFileName(partPath);
+    if (!state->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open incoming attachment:" << partPath;
+        emit incomingFinished(id, false, QString(), QByteArray());
+        return;
+    }
+    incoming.insert(id, state);
+}
+
+void FileTransferWorker::writeChunk(const QString &id, qint64 offset, const QByteArray &data)
+{
+    QSharedPointer<Incoming> state = incoming.value(id);
+    if (!state) return;
+
+    // Chunks arrive in order; duplicates after a resume and anything past a
+    // gap are dropped and the current offset is acknowledged again.
+    if (offset == state->received) {
+        if (state->file.write(data) != data.size()) {
+            qWarning() << "Failed to write incoming attachment:" << state->file.errorString();
+            abortIncoming(id);
+            emit incomingFinished(id, false, QString(), QByteArray());
+            return;
+        }
+        state->hash.addData(data);
+        state->received += data.size();
+    }
+    emit chunkWritten(id, state->received);
+}
+
+void FileTransferWorker::finishIncoming(const QString &id, const QString &finalPath, const QByteArray &expectedSha256,
+                                        const QString &conversation)
+{
+    QSharedPointer<Incoming> state = incoming.take(id);
+    if (!state) return;
+
+    state->file.close();
+    const QByteArray sha256 = state->hash.result().toHex();
+    if (sha256 != expectedSha256.toLower()) {
+        qWarning() << "Attachment hash mismatch, discarding" << state->file.fileName();
+        state->file.remove();
+        emit incomingFinished(id, false, QString(), QByteArray());
+        return;
+    }
+
+    // Keep one copy in the store and link it out instead of copying. Once
+    // adopted the .part file is gone, so the outcome is whatever linkOut()
+    // manages; it already falls back to a plain copy. adopt() references
+    // the blob for this conversation, so the quota pass can't evict it.
+    const QString target = freePath(finalPath);
+    if (store && store->adopt(state->file.fileName(), sha256, conversation)) {
+        const bool delivered = store->linkOut(sha256, target);
+        store->enforceQuota();
+        if (!delivered) qWarning() << "Failed to deliver attachment to" << target;
+        emit incomingFinished(id, delivered, delivered ? target : QString(), delivered ? sha256 : QByteArray());
+        return;
+    }
+
+    if (!state->file.rename(target)) {
+        qWarning() << "Failed to deliver attachment to" << target;
+        state->file.remove();
+        emit incomingFinished(id, false, QString(), QByteArray());
+        return;
+    }
+    emit incomingFinished(id, true, target, sha256);
+}
+
+void FileTransferWorker::materialize(const QString &id, const QByteArray &sha256, const QString &finalPath,
+                                     const QString &conversation)
+{
+    if (store) store->addRef(sha256, conversation);
+    const QString target = freePath(finalPath);
+    const bool ok = store && store->linkOut(sha256, target);
+    QFile::remove(finalPath + ".part");
+    emit incomingFinished(id, ok, ok ? target : QString(), ok ? sha256 : QByteArray());
+}
+
+void FileTransferWorker::abortIncoming(const QString &id)
+{
+    QSharedPointer<Incoming> state = incoming.take(id);
+    if (state) {
+        state->file.close();
+        state->file.remove();
+    }
+}
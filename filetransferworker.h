@@ -0,0 +1,68 @@
+//filetransferworker.h
+#ifndef FILETRANSFERWORKER_H
+#define FILETRANSFERWORKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include "attachmentstore.h"
+
+// All attachment disk I/O and hashing, run on FileTransferManager's worker
+// thread. Outgoing files are read in bounded chunks and hashed in order
+// exactly once, even when a resume re-reads earlier offsets. Incoming
+// files are written sequentially to a .part file and hashed as they grow;
+// once verified they move into the AttachmentStore and are linked out to
+// their final path.
+class FileTransferWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileTransferWorker(AttachmentStore *store, QObject *parent = nullptr);
+
+public slots:
+    void hashFile(const QString &id, const QString &path);
+    void readChunk(const QString &id, const QString &path, qint64 offset, qint64 length);
+    void closeOutgoing(const QString &id);
+
+    void openIncoming(const QString &id, const QString &partPath);
+    void writeChunk(const QString &id, qint64 offset, const QByteArray &data);
+    void finishIncoming(const QString &id, const QString &finalPath, const QByteArray &expectedSha256,
+                        const QString &conversation);
+    void abortIncoming(const QString &id);
+    void materialize(const QString &id, const QByteArray &sha256, const QString &finalPath,
+                     const QString &conversation);
+
+signals:
+    void fileHashed(const QString &id, const QByteArray &sha256);
+    void chunkRead(const QString &id, qint64 offset, const QByteArray &data);
+    void outgoingHashReady(const QString &id, const QByteArray &sha256);
+    void outgoingFailed(const QString &id, const QString &error);
+
+    void chunkWritten(const QString &id, qint64 receivedBytes);
+    void incomingFinished(const QString &id, bool verified, const QString &path, const QByteArray &sha256);
+
+private:
+    struct Outgoing {
+        QFile file;
+        QCryptographicHash hash{QCryptographicHash::Sha256};
+        qint64 hashedUpTo = 0;
+        bool hashReported = false;
+    };
+
+    struct Incoming {
+        QFile file;
+        QCryptographicHash hash{QCryptographicHash::Sha256};
+        qint64 received = 0;
+    };
+
+    AttachmentStore *store;
+    QHash<QString, QSharedPointer<Outgoing>> outgoing;
+    QHash<QString, QSharedPointer<Incoming>> incoming;
+};
+
+#endif // FILETRANSFERWORKER_H
@@ -2,14 +2,64 @@
 #include "mainwindow.h"
 #include "conferancecallwindow.h"
 #include "clientwindow.h"
+#include "themeengine.h"
+#include "startuptracer.h"
+#include "tracer.h"
+#include "metricsserver.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
+    // Checked before QApplication exists so its construction is traced too.
+    bool traceStartup = false;
+    QString traceOutput = "startup-trace.json";
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg(argv[i]);
+        if (arg == "--trace-startup") {
+            traceStartup = true;
+        } else if (arg == "--trace-output" && i + 1 < argc) {
+            traceOutput = QString::fromLocal8Bit(argv[++i]);
+        } else if (arg.startsWith("--trace-output=")) {
+            traceOutput = QString::fromLocal8Bit(arg.mid(15));
+        }
+    }
+    if (traceStartup) {
+        StartupTracer::enable(traceOutput);
+    }
+
+    StartupTracer::Phase appPhase("QApplication");
     QApplication a(argc, argv);
+    appPhase.end();
+
+    // Only for --help and rejecting typos; the values were read above.
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("trace-startup", "Record a Chrome trace of startup."));
+    parser.addOption(QCommandLineOption("trace-output", "Where to write the startup trace.",
+                                        "file", "startup-trace.json"));
+    parser.addOption(QCommandLineOption("trace", "Record trace events from launch; Ctrl+Shift+T saves them."));
+    parser.addOption(QCommandLineOption("metrics-socket", "Local socket serving Prometheus metrics.",
+                                        "path", MetricsServer::defaultPath()));
+    parser.addOption(QCommandLineOption("no-metrics", "Do not serve metrics."));
+    parser.process(a);
+    if (parser.isSet("trace")) {
+        Tracer::setEnabled(true);
+    }
+
+    MetricsServer metrics;
+    if (!parser.isSet("no-metrics")) {
+        metrics.listen(parser.value("metrics-socket"));
+    }
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, &StartupTracer::flush);
+
+    ThemeEngine::install();
+
+    StartupTracer::Phase windowPhase("MainWindow");
     MainWindow w;
     w.show();
+    windowPhase.end();
 
     return a.exec();
 }
@@ -3,15 +3,19 @@
 #include "ui_mainwindow.h"
 #include "clientwindow.h"
 #include "clientwidget.h"
+#include "deferredinit.h"
+#include "startuptracer.h"
+#include "tracer.h"
+#include "networkclient.h"
+#include "clientservices.h"
+#include "themeengine.h"
+#include "chathistorystore.h"
+#include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
 #include <QDir>
 #include <QSettings>
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonValue>
-#include <QJsonObject>
 
 
 
@@ -19,7 +23,10 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
+    StartupTracer::Phase uiPhase("MainWindow::setupUi");
     ui->setupUi(this);
+    uiPhase.end();
+
     QLabel *usernameLabel = new QLabel("Username:", this);
     username = new QLineEdit(this);
 
@@ -34,21 +41,37 @@ MainWindow::MainWindow(QWidget *parent)
     rememberMe = new QCheckBox(this);
 
     errorLabel = new QLabel(this);
-    errorLabel->setStyleSheet("color: red;");
+    ThemeEngine::applyErrorText(errorLabel);
     errorLabel->setVisible(false);
 
-    if (loadCredentials(savedUsername, savedPassword, savedIPaddr)) {
-        username->setText(savedUsername);
-        password->setText(savedPassword);
-        IPaddr->setText(savedIPaddr);
-        rememberMe->setChecked(true);
+    {
+        StartupTracer::Phase phase("loadCredentials");
+        if (loadCredentials(savedUsername, savedPassword, savedIPaddr)) {
+            username->setText(savedUsername);
+            password->setText(savedPassword);
+            IPaddr->setText(savedIPaddr);
+            rememberMe->setChecked(true);
+        }
     }
 
-    // Initialize WebSocket
-    webSocket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
-    connect(webSocket, &QWebSocket::connected, this, &MainWindow::onWebSocketConnected);
-    connect(webSocket, &QWebSocket::textMessageReceived, this, &MainWindow::onWebSocketMessageReceived);
-    webSocket->open(QUrl("ws://localhost:12345")); // Replace with your server URL
+    services = new ClientServices(this);
+
+    // Initialize WebSocket; it is opened once the login form is on screen
+    network = new NetworkClient(QUrl("ws://localhost:12345"), QString(), this); // Replace with your server URL
+    connect(network, &NetworkClient::connected, this, &MainWindow::onWebSocketConnected);
+    connect(network, &NetworkClient::rosterReceived, this, &MainWindow::onRosterReceived);
+    connect(network, &NetworkClient::errorOccurred, this, [](const QString &error) {
+        qWarning() << "WebSocket error occurred:" << error;
+    });
+
+    DeferredInit *deferred = new DeferredInit(this);
+    deferred->add("MainWindow::openWebSocket", [this]() {
+        network->open();
+    });
+    connect(deferred, &DeferredInit::finished, this, []() {
+        StartupTracer::mark("login ready");
+        StartupTracer::flush();
+    });
     clientList = new QListWidget(this);
     setCentralWidget(clientList);
 
@@ -155,11 +178,54 @@ void MainWindow::on_SignIn_btn_clicked()
         clearCredentials();
     }
 
-    ClientWindow *window = new ClientWindow(this);
+    // Signing in again to an open account brings its window back; any
+    // other account gets a window of its own next to the ones already open.
+    const AccountData account{username->text(), password->text(), IPaddr->text()};
+    ClientWindow *window = findSession(account.id());
+    if (!window) {
+        migrateLegacyData(account);
+        window = new ClientWindow(this, account, services);
+        window->setAttribute(Qt::WA_DeleteOnClose);
+        sessions.removeIf([](const QPointer<ClientWindow> &session) { return session.isNull(); });
+        sessions.append(window);
+    }
     window->show();
+    window->raise();
+    window->activateWindow();
     this->hide();
 }
 
+void MainWindow::migrateLegacyData(const AccountData &account)
+{
+    const ClientServices::MigrationResult result = services->migrateLegacyData(account);
+    const QString location = QDir::toNativeSeparators(services->history()->directory());
+    if (result == ClientServices::Failed) {
+        QMessageBox::warning(this, "Chat History",
+                             QString("Some chat history from an older version could not be moved to %1. "
+                                     "It is still in %2 and will be tried again at the next sign-in.")
+                                 .arg(account.id(), location));
+    } else if (result == ClientServices::Ambiguous) {
+        // Once is enough; the files stay put either way.
+        QSettings settings("YourCompany", "VoIPClient");
+        if (!settings.value("legacyDataNoticeShown", false).toBool()) {
+            settings.setValue("legacyDataNoticeShown", true);
+            QMessageBox::information(this, "Chat History",
+                                     QString("Chat history and unsent messages from an older version are in %1. "
+                                             "More than one account has been used on this computer, so they "
+                                             "were not assigned to %2.")
+                                         .arg(location, account.id()));
+        }
+    }
+}
+
+ClientWindow *MainWindow::findSession(const QString &accountId) const
+{
+    for (const QPointer<ClientWindow> &session : sessions) {
+        if (session && session->accountData().id() == accountId) return session;
+    }
+    return nullptr;
+}
+
 void MainWindow::saveCredentials(const QString &username, const QString &password, const QString &IPaddr)
 {
     QSettings settings("YourCompany", "VoIPClient");
@@ -183,8 +249,12 @@ bool MainWindow::loadCredentials(QString &username, QString &password, QString &
 
 void MainWindow::clearCredentials()
 {
+    // Only the login; other accounts' favorites and the theme stay.
     QSettings settings("YourCompany", "VoIPClient");
-    settings.clear();
+    settings.remove("username");
+    settings.remove("password");
+    settings.remove("ipaddress");
+    settings.remove("rememberMe");
     if (!rememberMe->isChecked()) {
         username->clear();
         password->clear();
@@ -210,38 +280,23 @@ QString MainWindow::getIPaddr() const
 void MainWindow::onWebSocketConnected()
 {
     qDebug() << "Connected to WebSocket server";
-
-    // Add a WebSocket error handler
-    connect(webSocket, &QWebSocket::errorOccurred, this, [](QAbstractSocket::SocketError error) {
-        qWarning() << "WebSocket error occurred:" << error;
-    });
-
 }
 
-void MainWindow::onWebSocketMessageReceived(const QString &message)
+void MainWindow::onRosterReceived(const QList<RosterEntry> &entries)
 {
-    qDebug() << "Message received:" << message;
-
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (!doc.isArray()) {
-        qWarning() << "Invalid JSON data received";
-        return;
-    }
+    TRACE_SCOPE("roster", "MainWindow::onRosterReceived");
 
-    QJsonArray clientArray = doc.array();
     QList<ClientData> clients;
-    for (const QJsonValue &value : clientArray) {
-        QJsonObject clientObj = value.toObject();
-        QString clientName = clientObj.value("name").toString();
-        QString clientStatus = clientObj.value("status").toString();
-
-        clients.append(ClientData{clientName, "", "", clientStatus});
+    clients.reserve(entries.size());
+    for (const RosterEntry &entry : entries) {
+        clients.append(ClientData{entry.name, "", "", entry.status});
     }
 
     populateClientList(clients);
 }
 
 void MainWindow::populateClientList(const QList<ClientData> &clients) {
+    TRACE_SCOPE("roster", "MainWindow::populateClientList");
     clientList->clear();
     for (const ClientData &client : clients) {
         ClientWidget *widget = new ClientWidget(
@@ -260,6 +315,12 @@ void MainWindow::populateClientList(const QList<ClientData> &clients) {
 
 MainWindow::~MainWindow()
 {
+    // Sessions borrow the shared services, so they go first.
+    for (const QPointer<ClientWindow> &session : std::as_const(sessions)) {
+        delete session.data();
+    }
+    // Volume is process-wide, so it is only reset once every account is gone.
+    system("amixer -c 0 sset Master 50%");
     delete ui;
     delete username;
     delete password;
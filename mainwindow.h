@@ -15,6 +15,12 @@
 #include <QCheckBox>
 #include <clientwindow.h>
 #include "clientdata.h"
+#include "rostermodel.h"
+#include <QPointer>
+
+class NetworkClient;
+class ClientServices;
+class ClientWindow;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -54,13 +60,19 @@ private:
 
     bool isValidIPAddress(const QString &ip);
 
-    QWebSocket *webSocket;
+    NetworkClient *network;
+
+    // Signed-in accounts, one window each, sharing services.
+    ClientServices *services;
+    QList<QPointer<ClientWindow>> sessions;
+    ClientWindow *findSession(const QString &accountId) const;
+    void migrateLegacyData(const AccountData &account);
     QListWidget *clientList;
     void populateClientList(const QList<ClientData> &clients);
 
 private slots:
     void onWebSocketConnected();
-    void onWebSocketMessageReceived(const QString &message);
+    void onRosterReceived(const QList<RosterEntry> &entries);
 
 };
 #endif // MAINWINDOW_H
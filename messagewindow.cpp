@@ -6,17 +6,36 @@
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QMenu>
+#include <QShowEvent>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextImageFormat>
+#include <QPainter>
+#include <QStyle>
+#include <QUuid>
+
+namespace {
+const int kFailedPreviewEdge = 48;
+}
+
 const char* MessageWindow::DATE_FORMAT = "yyyy-MM-dd hh:mm:ss";
 
-MessageWindow::MessageWindow(const QString &username, bool isDarkTheme, QWidget *parent)
-    : QWidget(parent), username(username), isDarkTheme(isDarkTheme)
+MessageWindow::MessageWindow(const QString &username, const QString &account, bool isDarkTheme,
+                             ChatHistoryStore *history, QWidget *parent)
+    : QWidget(parent), username(username), account(account), isDarkTheme(isDarkTheme), history(history)
 {
+    // Only the shell is built here. History is loaded after the first
+    // frame, and the emoji picker and context menu on first use.
     setupUI();
     connectSignals();
-    loadChatHistory();
     applyTheme(isDarkTheme);
-    createEmojiPanel();
-    setupContextMenu();
+
+    chatDisplay->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(chatDisplay, &QWidget::customContextMenuRequested,
+            this, [this](const QPoint &pos) {
+                if (!contextMenu) setupContextMenu();
+                contextMenu->exec(chatDisplay->mapToGlobal(pos));
+            });
 
     // Enable drag and drop
     setAcceptDrops(true);
@@ -27,8 +46,6 @@ MessageWindow::MessageWindow(const QString &username, bool isDarkTheme, QWidget
 void MessageWindow::setupUI()
 {
     setWindowFlags(Qt::FramelessWindowHint);
-    setAttribute(Qt::WA_OpaquePaintEvent);
-    setAttribute(Qt::WA_NoSystemBackground);
     mainLayout = new QVBoxLayout(this);
     mainLayout->setSpacing(10);
     mainLayout->setContentsMargins(10, 10, 10, 10);
@@ -40,8 +57,12 @@ void MessageWindow::setupUI()
     usernameLabel = new QLabel(username, this);
     usernameLabel->setAlignment(Qt::AlignCenter);
 
+    typingLabel = new QLabel(this);
+    typingLabel->hide();
+
     headerLayout->addWidget(backButton);
     headerLayout->addWidget(usernameLabel, 1);
+    headerLayout->addWidget(typingLabel);
     headerLayout->addStretch();
 
     // Chat display setup
@@ -49,6 +70,10 @@ void MessageWindow::setupUI()
     chatDisplay->setReadOnly(true);
     chatDisplay->setMinimumHeight(300);
 
+    receiptLabel = new QLabel(this);
+    receiptLabel->setAlignment(Qt::AlignRight);
+    receiptLabel->hide();
+
     // Input area setup
     inputLayout = new QHBoxLayout();
     messageInput = new QLineEdit(this);
@@ -77,6 +102,7 @@ void MessageWindow::setupUI()
     // Add all layouts to main layout
     mainLayout->addLayout(headerLayout);
     mainLayout->addWidget(chatDisplay, 1);
+    mainLayout->addWidget(receiptLabel);
     mainLayout->addLayout(inputLayout);
     mainLayout->addLayout(actionLayout);
 
@@ -89,8 +115,22 @@ void MessageWindow::connectSignals()
     connect(backButton, &QPushButton::clicked, this, &MessageWindow::backButtonClicked);
     connect(sendButton, &QPushButton::clicked, this, &MessageWindow::sendMessage);
     connect(messageInput, &QLineEdit::returnPressed, this, &MessageWindow::handleReturnPressed);
+    connect(messageInput, &QLineEdit::textEdited, this, &MessageWindow::handleInputEdited);
+
+    typingIdleTimer.setSingleShot(true);
+    typingIdleTimer.setInterval(TYPING_IDLE_MS);
+    connect(&typingIdleTimer, &QTimer::timeout, this, &MessageWindow::stopTyping);
+
+    peerTypingTimer.setSingleShot(true);
+    peerTypingTimer.setInterval(TYPING_IDLE_MS + TYPING_REFRESH_MS);
+    connect(&peerTypingTimer, &QTimer::timeout, this, [this]() { setPeerTyping(false); });
+
+    readReceiptTimer.setSingleShot(true);
+    readReceiptTimer.setInterval(READ_RECEIPT_DELAY_MS);
+    connect(&readReceiptTimer, &QTimer::timeout, this, &MessageWindow::flushReadReceipt);
     connect(clearButton, &QPushButton::clicked, this, &MessageWindow::clearChat);
     connect(exportButton, &QPushButton::clicked, this, &MessageWindow::exportChat);
+    connect(emojiButton, &QPushButton::clicked, this, &MessageWindow::positionEmojiPanel);
     connect(attachButton, &QPushButton::clicked, this, [this]() {
         QString filePath = QFileDialog::getOpenFileName(this, "Attach File");
         if (!filePath.isEmpty()) {
@@ -110,9 +150,111 @@ void MessageWindow::sendMessage()
         return;
     }
 
+    const QString messageId = QUuid::createUuid().toString(QUuid::WithoutBraces);
     addMessage("Me", message);
-    emit messageSent(username, message);
+    outgoingMarkers.insert(messageId, {chatDisplay->document()->blockCount() - 1, QString()});
+    setMessageState(messageId, ChatOutbox::Pending);
+
+    emit messageSent(username, message, messageId);
     messageInput->clear();
+    receiptLabel->hide();
+    stopTyping();
+}
+
+void MessageWindow::handleInputEdited(const QString &text)
+{
+    if (text.trimmed().isEmpty()) {
+        stopTyping();
+        return;
+    }
+
+    // One "typing" frame per refresh interval, however fast the keys come.
+    const QDateTime now = QDateTime::currentDateTime();
+    if (!typingActive || lastTypingSent.msecsTo(now) >= TYPING_REFRESH_MS) {
+        typingActive = true;
+        lastTypingSent = now;
+        emit typingChanged(username, true);
+    }
+    typingIdleTimer.start();
+}
+
+void MessageWindow::stopTyping()
+{
+    typingIdleTimer.stop();
+    if (typingActive) {
+        typingActive = false;
+        emit typingChanged(username, false);
+    }
+}
+
+void MessageWindow::receiveMessage(const QString &sender, const QString &message)
+{
+    setPeerTyping(false);
+    addMessage(sender, message);
+    lastReceivedAt = QDateTime::currentMSecsSinceEpoch();
+    emit messageReceived(sender, message);
+
+    if (isVisible()) {
+        readReceiptTimer.start();
+    }
+}
+
+void MessageWindow::flushReadReceipt()
+{
+    if (lastReceivedAt > lastReadSent && isVisible()) {
+        lastReadSent = lastReceivedAt;
+        emit messagesRead(username, lastReceivedAt);
+    }
+}
+
+void MessageWindow::setMessageState(const QString &messageId, ChatOutbox::State state)
+{
+    auto it = outgoingMarkers.find(messageId);
+    if (it == outgoingMarkers.end()) return;
+
+    QTextBlock block = chatDisplay->document()->findBlockByNumber(it->blockNumber);
+    if (!block.isValid()) {
+        outgoingMarkers.erase(it);
+        return;
+    }
+
+    QString marker;
+    switch (state) {
+    case ChatOutbox::Pending:   marker = " …"; break;
+    case ChatOutbox::Sent:      marker = " ✓"; break;
+    case ChatOutbox::Delivered: marker = " ✓✓"; break;
+    }
+
+    // Replace the previous marker at the end of the message's block.
+    const int end = block.position() + block.length() - 1;
+    QTextCursor cursor(chatDisplay->document());
+    cursor.setPosition(end - int(it->text.length()));
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    cursor.insertText(marker);
+    it->text = marker;
+
+    if (state == ChatOutbox::Delivered) {
+        outgoingMarkers.erase(it);
+    }
+}
+
+void MessageWindow::setPeerTyping(bool typing)
+{
+    typingLabel->setText(typing ? username + " is typing..." : QString());
+    typingLabel->setVisible(typing);
+    if (typing) {
+        peerTypingTimer.start();
+    } else {
+        peerTypingTimer.stop();
+    }
+}
+
+void MessageWindow::setPeerReadUpTo(qint64 timestampMs)
+{
+    if (timestampMs <= peerReadUpTo) return;
+    peerReadUpTo = timestampMs;
+    receiptLabel->setText("Seen " + QDateTime::currentDateTime().toString("hh:mm"));
+    receiptLabel->show();
 }
 
 void MessageWindow::addMessage(const QString &sender, const QString &message)
@@ -125,20 +267,24 @@ void MessageWindow::addMessage(const QString &sender, const QString &message)
     }
 
     // Format and display the message
-    QString formattedMessage = formatMessage(sender, message);
+    const QDateTime now = QDateTime::currentDateTime();
+    QString formattedMessage = formatMessage(sender, message, now);
     chatDisplay->append(formattedMessage);
 
-    // Store and save valid messages
+    // Store and append valid messages to the history file
     if (!sender.isEmpty() && !message.isEmpty()) {
-        messageHistory.append(qMakePair(sender, message));
-        saveChatHistory();
+        ChatRecord record{now.toMSecsSinceEpoch(), sender, message};
+        messageHistory.append(record);
+        history->append(account, username, record);
+        if (!historyLoaded) {
+            ++liveMessagesBeforeLoad;
+        }
     }
 }
 
-QString MessageWindow::formatMessage(const QString &sender, const QString &message)
+QString MessageWindow::formatMessage(const QString &sender, const QString &message, const QDateTime &time)
 {
-    QDateTime currentTime = QDateTime::currentDateTime();
-    QString timeStr = currentTime.toString(DATE_FORMAT);
+    QString timeStr = time.isValid() ? time.toString(DATE_FORMAT) : QString("—");
 
     // Create formatted HTML message with timestamp
     return QString("<p><b>[%1] %2:</b> %3</p>")
@@ -161,90 +307,177 @@ void MessageWindow::handleReturnPressed()
 void MessageWindow::updateTheme(bool isDark)
 {
     isDarkTheme = isDark;
-    applyTheme(isDark);
+    if (isVisible()) {
+        applyTheme(isDark);
+    }
 }
 
 void MessageWindow::applyTheme(bool isDark)
 {
-    setStyleSheet(isDark ? getDarkThemeStyleSheet() : getLightThemeStyleSheet());
+    ThemeEngine::apply(this, isDark);
 }
 
-QString MessageWindow::getDarkThemeStyleSheet()
+void MessageWindow::handleFileDrop(const QString &filePath)
 {
-    return R"(
-        QWidget {
-            background-color: #1E2922;
-            color: #E0E3DE;
-        }
-        QTextEdit {
-            background-color: #2A362F;
-            border: 1px solid #3F4A3C;
-            border-radius: 4px;
-        }
-        QLineEdit {
-            background-color: #2A362F;
-            border: 1px solid #3F4A3C;
-            border-radius: 4px;
-            padding: 5px;
-            color: #E0E3DE;
-        }
-        QPushButton {
-            background-color: #3F4A3C;
-            border: 1px solid #2F3E2C;
-            border-radius: 4px;
-            padding: 5px 10px;
-            color: #FFFFFF;
-        }
-        QPushButton:hover {
-            background-color: #4A5D45;
-        }
-        QLabel {
-            color: #E0E3DE;
-        }
-    )";
+    QFileInfo fileInfo(filePath);
+    QString fileName = fileInfo.fileName();
+    QString message = QString("📎 Attached file: %1").arg(fileName);
+    addMessage("Me", message);
+    showImagePreview(fileInfo.absoluteFilePath());
+    emit fileAttached(username, fileInfo.absoluteFilePath());
 }
 
-QString MessageWindow::getLightThemeStyleSheet()
+void MessageWindow::setThumbnailPipeline(ThumbnailPipeline *pipeline)
 {
-    return R"(
-        QWidget {
-            background-color: #E0E3DE;
-            color: #2F3E2C;
-        }
-        QTextEdit {
-            background-color: #FFFFFF;
-            border: 1px solid #A3A69F;
-            border-radius: 4px;
-        }
-        QLineEdit {
-            background-color: #FFFFFF;
-            border: 1px solid #A3A69F;
-            border-radius: 4px;
-            padding: 5px;
-            color: #2F3E2C;
-        }
-        QPushButton {
-            background-color: #4A5D45;
-            border: 1px solid #2F3E2C;
-            border-radius: 4px;
-            padding: 5px 10px;
-            color: #FFFFFF;
-        }
-        QPushButton:hover {
-            background-color: #5B705A;
-        }
-        QLabel {
-            color: #2F3E2C;
+    if (thumbnails) {
+        disconnect(thumbnails, nullptr, this, nullptr);
+    }
+    thumbnails = pipeline;
+    if (thumbnails) {
+        connect(thumbnails, &ThumbnailPipeline::thumbnailReady, this, &MessageWindow::onThumbnailReady);
+        connect(thumbnails, &ThumbnailPipeline::thumbnailFailed, this, &MessageWindow::onThumbnailFailed);
+    }
+}
+
+QImage MessageWindow::previewPlaceholder()
+{
+    static const QImage placeholder = []() {
+        QImage image(ThumbnailPipeline::THUMBNAIL_EDGE, ThumbnailPipeline::THUMBNAIL_EDGE * 3 / 4,
+                     QImage::Format_ARGB32_Premultiplied);
+        image.fill(QColor(128, 128, 128, 60));
+        QPainter painter(&image);
+        painter.setPen(QColor(128, 128, 128));
+        painter.drawText(image.rect(), Qt::AlignCenter, "🖼");
+        return image;
+    }();
+    return placeholder;
+}
+
+void MessageWindow::showImagePreview(const QString &filePath)
+{
+    if (!thumbnails || !ThumbnailPipeline::isImageFile(filePath)) return;
+
+    // A placeholder of the final box keeps layout stable; the thumbnail
+    // replaces the resource when the pool is done with it.
+    const QUrl url(QString("thumbnail:%1").arg(QString::fromLatin1(QUrl::toPercentEncoding(filePath))));
+    QImage image;
+    const bool ready = thumbnails->request(filePath, &image);
+    if (!ready) {
+        image = previewPlaceholder();
+    }
+    chatDisplay->document()->addResource(QTextDocument::ImageResource, url, image);
+
+    chatDisplay->append(QString());
+    QTextCursor cursor(chatDisplay->document());
+    cursor.movePosition(QTextCursor::End);
+    QTextImageFormat format;
+    format.setName(url.toString());
+    format.setWidth(image.width());
+    format.setHeight(image.height());
+    cursor.insertImage(format);
+    ++previewCount;
+
+    if (!ready) {
+        previewBlocks[filePath].append(cursor.blockNumber());
+    }
+}
+
+void MessageWindow::onThumbnailReady(const QString &filePath, const QImage &image)
+{
+    if (!previewBlocks.contains(filePath)) return;
+
+    const QUrl url(QString("thumbnail:%1").arg(QString::fromLatin1(QUrl::toPercentEncoding(filePath))));
+    chatDisplay->document()->addResource(QTextDocument::ImageResource, url, image);
+    resizePreviewImages(filePath, image.size());
+}
+
+void MessageWindow::onThumbnailFailed(const QString &filePath)
+{
+    if (!previewBlocks.contains(filePath)) return;
+
+    // Unreadable or not really an image: show a plain file icon instead of
+    // leaving the placeholder up forever.
+    const QImage icon = style()->standardIcon(QStyle::SP_FileIcon).pixmap(kFailedPreviewEdge).toImage();
+    const QUrl url(QString("thumbnail:%1").arg(QString::fromLatin1(QUrl::toPercentEncoding(filePath))));
+    chatDisplay->document()->addResource(QTextDocument::ImageResource, url, icon);
+    resizePreviewImages(filePath, icon.size());
+}
+
+void MessageWindow::resizePreviewImages(const QString &filePath, const QSize &size)
+{
+    const QList<int> blocks = previewBlocks.take(filePath);
+    QTextDocument *document = chatDisplay->document();
+
+    for (int blockNumber : blocks) {
+        const QTextBlock block = document->findBlockByNumber(blockNumber);
+        for (auto it = block.begin(); block.isValid() && !it.atEnd(); ++it) {
+            const QTextFragment fragment = it.fragment();
+            if (!fragment.charFormat().isImageFormat()) continue;
+
+            QTextImageFormat format = fragment.charFormat().toImageFormat();
+            format.setWidth(size.width());
+            format.setHeight(size.height());
+            QTextCursor cursor(document);
+            cursor.setPosition(fragment.position());
+            cursor.setPosition(fragment.position() + fragment.length(), QTextCursor::KeepAnchor);
+            cursor.setCharFormat(format);
         }
-    )";
+    }
 }
 
-void MessageWindow::handleFileDrop(const QString &filePath)
+void MessageWindow::setBlockText(int blockNumber, const QString &text)
 {
-    QFileInfo fileInfo(filePath);
-    QString fileName = fileInfo.fileName();
-    QString message = QString("📎 Attached file: %1").arg(fileName);
-    addMessage("Me", message);
+    QTextBlock block = chatDisplay->document()->findBlockByNumber(blockNumber);
+    if (!block.isValid()) return;
+
+    QTextCursor cursor(chatDisplay->document());
+    cursor.setPosition(block.position());
+    cursor.setPosition(block.position() + block.length() - 1, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+}
+
+void MessageWindow::showTransferProgress(const QString &transferId, const QString &fileName,
+                                         qint64 done, qint64 total, bool incoming)
+{
+    const int percent = total > 0 ? int(done * 100 / total) : 100;
+
+    auto it = transferLines.find(transferId);
+    if (it == transferLines.end()) {
+        chatDisplay->append(QString());
+        it = transferLines.insert(transferId, {chatDisplay->document()->blockCount() - 1, -1});
+    }
+
+    // Acks arrive per chunk; only repaint when the percentage moves.
+    if (it->percent == percent) return;
+    it->percent = percent;
+
+    setBlockText(it->blockNumber, QString("📎 %1 %2: %3% (%4 of %5)")
+                                      .arg(incoming ? "Receiving" : "Sending", fileName)
+                                      .arg(percent)
+                                      .arg(locale().formattedDataSize(done), locale().formattedDataSize(total)));
+}
+
+void MessageWindow::finishTransfer(const QString &transferId, const QString &fileName,
+                                   bool ok, const QString &localPath, bool incoming)
+{
+    const TransferLine line = transferLines.take(transferId);
+
+    QString text;
+    if (!ok) {
+        text = QString("📎 Transfer of %1 failed").arg(fileName);
+    } else if (incoming) {
+        text = QString("📎 %1 saved to %2").arg(fileName, QDir::toNativeSeparators(localPath));
+    } else {
+        text = QString("📎 %1 sent").arg(fileName);
+    }
+
+    if (line.blockNumber >= 0) {
+        setBlockText(line.blockNumber, text);
+    }
+    if (ok && incoming) {
+        addMessage(username, QString("📎 Received file: %1").arg(fileName));
+        showImagePreview(localPath);
+    }
 }
 
 bool MessageWindow::eventFilter(QObject *obj, QEvent *event)
@@ -261,8 +494,11 @@ bool MessageWindow::eventFilter(QObject *obj, QEvent *event)
             QDropEvent *dropEvent = static_cast<QDropEvent*>(event);
             const QMimeData* mimeData = dropEvent->mimeData();
             if (mimeData->hasUrls()) {
-                QString filePath = mimeData->urls().first().toLocalFile();
-                handleFileDrop(filePath);
+                for (const QUrl &url : mimeData->urls()) {
+                    if (url.isLocalFile()) {
+                        handleFileDrop(url.toLocalFile());
+                    }
+                }
                 return true;
             }
         }
@@ -271,63 +507,72 @@ bool MessageWindow::eventFilter(QObject *obj, QEvent *event)
 }
 void MessageWindow::loadChatHistory()
 {
-    QString filePath = getChatFilePath();
-    QFile file(filePath);
-
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&file);
-        chatDisplay->clear();
-
-        while (!in.atEnd()) {
-            QString line = in.readLine();
-            QStringList parts = line.split("|||");
-            if (parts.size() == 2) {
-                messageHistory.append(qMakePair(parts[0], parts[1]));
-                chatDisplay->append(formatMessage(parts[0], parts[1]));
-            }
+    if (historyLoaded) return;
+    historyLoaded = true;
+
+    // Messages that arrived before the load are already on screen and at
+    // the end of the file.
+    QList<ChatRecord> records = history->tail(account, username, MAX_HISTORY_SIZE);
+    records.resize(std::max<qsizetype>(0, records.size() - liveMessagesBeforeLoad));
+    if (records.isEmpty()) return;
+
+    QTextDocument *document = chatDisplay->document();
+    const bool wasEmpty = document->isEmpty();
+    const int blocksBefore = document->blockCount();
+
+    // Insert above whatever is already shown; each record becomes a block.
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    for (qsizetype i = 0; i < records.size(); ++i) {
+        const ChatRecord &record = records[i];
+        const QDateTime time = record.timestampMs > 0 ? QDateTime::fromMSecsSinceEpoch(record.timestampMs)
+                                                      : QDateTime();
+        cursor.insertHtml(formatMessage(record.sender, record.text, time));
+        if (i + 1 < records.size() || !wasEmpty) {
+            cursor.insertBlock();
         }
-        file.close();
-        scrollToBottom();
     }
-}
-
-void MessageWindow::saveChatHistory()
-{
-    QString filePath = getChatFilePath();
-    QFile file(filePath);
+    cursor.endEditBlock();
 
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Failed to open chat history file for writing:" << filePath;
-        return;
+    if (!wasEmpty) {
+        shiftBlockNumbers(document->blockCount() - blocksBefore);
     }
 
-    QTextStream out(&file);
-    for (const auto &message : messageHistory) {
-        if (!message.first.isEmpty() && !message.second.isEmpty()) {
-            out << message.first << "|||" << message.second << "\n";
-        }
-    }
-    file.close();
+    records.append(messageHistory);
+    messageHistory = records.mid(std::max<qsizetype>(0, records.size() - MAX_HISTORY_SIZE));
+    scrollToBottom();
 }
 
-
-QString MessageWindow::getChatFilePath()
+void MessageWindow::shiftBlockNumbers(int delta)
 {
-    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    if (dataPath.isEmpty()) {
-        qWarning() << "Failed to get writable location";
-        return QString();
+    if (delta == 0) return;
+    for (OutgoingMarker &marker : outgoingMarkers) {
+        marker.blockNumber += delta;
     }
-
-    QDir dir(dataPath);
-    if (!dir.exists() && !dir.mkpath(".")) {
-        qWarning() << "Failed to create directory:" << dataPath;
-        return QString();
+    for (TransferLine &line : transferLines) {
+        if (line.blockNumber >= 0) line.blockNumber += delta;
+    }
+    for (QList<int> &blocks : previewBlocks) {
+        for (int &block : blocks) {
+            block += delta;
+        }
     }
+}
 
-    return dir.filePath(username + "_chat.txt");
+qint64 MessageWindow::memoryEstimate() const
+{
+    // Rough: layout and formats cost a few times the text itself.
+    const qint64 text = qint64(chatDisplay->document()->characterCount()) * qint64(sizeof(QChar)) * 4;
+    const qint64 previews = qint64(previewCount) * ThumbnailPipeline::THUMBNAIL_EDGE
+                            * ThumbnailPipeline::THUMBNAIL_EDGE * 4;
+    return WINDOW_BASE_BYTES + text + previews;
 }
 
+bool MessageWindow::isIdle() const
+{
+    return !isVisible() && transferLines.isEmpty() && previewBlocks.isEmpty()
+           && !exporter && !typingActive;
+}
 
 void MessageWindow::clearChat()
 {
@@ -339,47 +584,87 @@ void MessageWindow::clearChat()
 
     if (reply == QMessageBox::Yes) {
         chatDisplay->clear();
+        outgoingMarkers.clear();
+        transferLines.clear();
+        previewBlocks.clear();
+        previewCount = 0;
+        historyLoaded = true;
+        liveMessagesBeforeLoad = 0;
         messageHistory.clear();
-        saveChatHistory();
+        history->clear(account, username);
+        emit historyCleared(username);
     }
 }
 
 void MessageWindow::exportChat()
 {
+    startExport({username}, username + "_chat_export");
+}
+
+void MessageWindow::exportAllChats()
+{
+    startExport(history->conversations(account), "chat_export");
+}
+
+void MessageWindow::startExport(const QStringList &conversations, const QString &suggestedName)
+{
+    if (exporter) {
+        QMessageBox::information(this, "Export Chat History", "An export is already running.");
+        return;
+    }
+
+    const ChatExportFormat *defaultFormat = ChatExportFormat::formats().first();
+    QString selectedFilter = defaultFormat->fileFilter();
     QString fileName = QFileDialog::getSaveFileName(
         this,
         "Export Chat History",
-        QDir::homePath() + "/" + username + "_chat_export.txt",
-        "Text Files (*.txt)"
+        QDir::homePath() + "/" + suggestedName + "." + defaultFormat->suffix(),
+        ChatExportFormat::fileFilters(),
+        &selectedFilter
         );
+    if (fileName.isEmpty()) return;
+
+    // An explicit extension wins over the filter that happened to be selected.
+    const ChatExportFormat *format = ChatExportFormat::forFileName(fileName);
+    if (!format) {
+        format = ChatExportFormat::forFileFilter(selectedFilter);
+        if (!format) format = defaultFormat;
+        fileName += "." + format->suffix();
+    }
 
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QTextStream out(&file);
-            out << chatDisplay->toPlainText();
-            file.close();
-
-            QMessageBox::information(
-                this,
-                "Export Successful",
-                "Chat history has been exported successfully."
-                );
+    exporter = new ChatExporter(history, account, conversations, fileName, format, this);
+    exportProgress = new QProgressDialog("Exporting chat history...", "Cancel", 0, 100, this);
+    exportProgress->setAttribute(Qt::WA_DeleteOnClose);
+    exportProgress->setMinimumDuration(500);
+
+    connect(exportProgress, &QProgressDialog::canceled, exporter, &ChatExporter::cancel);
+    connect(exporter, &ChatExporter::progress, exportProgress, &QProgressDialog::setValue);
+    connect(exporter, &ChatExporter::exportFinished, this, [this](bool ok, const QString &error) {
+        const bool cancelled = exportProgress && exportProgress->wasCanceled();
+        if (exportProgress) exportProgress->close();
+        if (ok) {
+            QMessageBox::information(this, "Export Successful",
+                                     "Chat history has been exported successfully.");
+        } else if (!cancelled) {
+            QMessageBox::warning(this, "Export Failed", "Chat export failed: " + error);
         }
-    }
+    });
+    connect(exporter, &QThread::finished, exporter, &QObject::deleteLater);
+    exporter->start(QThread::LowPriority);
 }
 
 void MessageWindow::closeEvent(QCloseEvent *event)
 {
-    saveChatHistory();
     emit closed();
     event->accept();
 }
 
 MessageWindow::~MessageWindow()
 {
-    // Save chat history before cleanup
-    saveChatHistory();
+    if (exporter) {
+        exporter->cancel();
+        exporter->wait();
+    }
 
     // Explicitly delete dynamic allocations
     if (emojiPanel) {
@@ -409,8 +694,7 @@ void MessageWindow::createEmojiPanel()
     for (const QString &emoji : emojis) {
         QPushButton *emojiButton = new QPushButton(emoji);
         emojiButton->setFixedSize(30, 30);
-        emojiButton->setStyleSheet("QPushButton { font-size: 16px; border: 1px solid #ccc; border-radius: 4px; } "
-                                   "QPushButton:hover { background-color: #e0e0e0; }");
+        ThemeEngine::applyEmojiButton(emojiButton);
 
         connect(emojiButton, &QPushButton::clicked, this, [this, emoji]() {
             handleEmojiInsert(emoji);
@@ -438,6 +722,7 @@ void MessageWindow::setupContextMenu()
     // Add menu actions
     contextMenu->addAction("Clear Chat", this, &MessageWindow::clearChat);
     contextMenu->addAction("Export Chat", this, &MessageWindow::exportChat);
+    contextMenu->addAction("Export All Chats", this, &MessageWindow::exportAllChats);
     contextMenu->addSeparator();
 
     // Theme submenu
@@ -448,16 +733,13 @@ void MessageWindow::setupContextMenu()
     connect(lightThemeAction, &QAction::triggered, this, [this]() { updateTheme(false); });
     connect(darkThemeAction, &QAction::triggered, this, [this]() { updateTheme(true); });
 
-    // Set up context menu policy
-    chatDisplay->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(chatDisplay, &QWidget::customContextMenuRequested,
-            this, [this](const QPoint &pos) {
-                contextMenu->exec(chatDisplay->mapToGlobal(pos));
-            });
 }
 
 void MessageWindow::positionEmojiPanel()
 {
+    if (!emojiPanel) {
+        createEmojiPanel();
+    }
     if (emojiPanel->isVisible()) {
         emojiPanel->hide();
     } else {
@@ -471,17 +753,32 @@ void MessageWindow::handleEmojiInsert(const QString &emoji)
     try {
         QMutexLocker locker(&chatMutex);
         messageInput->insert(emoji);
-        emojiPanel->hide();
+        if (emojiPanel) emojiPanel->hide();
     } catch (const std::exception &e) {
         qWarning() << "Error inserting emoji:" << e.what();
     }
 }
 
 
+void MessageWindow::showEvent(QShowEvent *event)
+{
+    applyTheme(isDarkTheme);
+    QWidget::showEvent(event);
+
+    // Posted paint events run before zero timers, so this lands after the
+    // first frame of the empty shell.
+    if (!historyLoaded) {
+        QTimer::singleShot(0, this, &MessageWindow::loadChatHistory);
+    }
+    if (lastReceivedAt > lastReadSent) {
+        readReceiptTimer.start();
+    }
+}
+
 void MessageWindow::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
-    if (emojiPanel->isVisible()) {
+    if (emojiPanel && emojiPanel->isVisible()) {
         QPoint pos = emojiButton->mapToGlobal(QPoint(0, -emojiPanel->height()));
         emojiPanel->move(pos);
     }
@@ -20,28 +20,57 @@
 #include <QCloseEvent>
 #include <QScopedPointer>
 #include <QMutex>
+#include <QTimer>
+#include <QHash>
+#include <QPointer>
+#include <QProgressDialog>
+#include "chatoutbox.h"
+#include "thumbnailpipeline.h"
+#include "chathistorystore.h"
+#include "chatexporter.h"
+#include "themeengine.h"
 
 class MessageWindow : public QWidget {
     Q_OBJECT
 
 public:
-    explicit MessageWindow(const QString &username, bool isDarkTheme, QWidget *parent = nullptr);
+    // account is the signed-in AccountData::id() this chat belongs to.
+    MessageWindow(const QString &username, const QString &account, bool isDarkTheme, ChatHistoryStore *history,
+                  QWidget *parent = nullptr);
     ~MessageWindow();
 
     void updateTheme(bool isDarkTheme);
     void addMessage(const QString &sender, const QString &message);
     void loadChatHistory();
-    void saveChatHistory();
+    void receiveMessage(const QString &sender, const QString &message);
+    void setPeerTyping(bool typing);
+    void setPeerReadUpTo(qint64 timestampMs);
+    void setMessageState(const QString &messageId, ChatOutbox::State state);
+    void showTransferProgress(const QString &transferId, const QString &fileName,
+                              qint64 done, qint64 total, bool incoming);
+    void finishTransfer(const QString &transferId, const QString &fileName,
+                        bool ok, const QString &localPath, bool incoming);
+    void setThumbnailPipeline(ThumbnailPipeline *pipeline);
+
+    // Rough bytes held by this view, and whether it can be dropped and
+    // rebuilt from history without losing anything in progress.
+    qint64 memoryEstimate() const;
+    bool isIdle() const;
 
 signals:
     void backButtonClicked();
     void closed();
-    void messageSent(const QString &recipient, const QString &message);
+    void messageSent(const QString &recipient, const QString &message, const QString &messageId);
     void messageReceived(const QString &sender, const QString &message);
+    void typingChanged(const QString &recipient, bool typing);
+    void messagesRead(const QString &sender, qint64 upToTimestampMs);
+    void fileAttached(const QString &recipient, const QString &filePath);
+    void historyCleared(const QString &username);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
     bool eventFilter(QObject *obj, QEvent *event) override;
 
 private slots:
@@ -49,26 +78,36 @@ private slots:
     void handleReturnPressed();
     void clearChat();
     void exportChat();
+    void exportAllChats();
     void scrollToBottom();
     void handleEmojiInsert(const QString &emoji);
+    void handleInputEdited(const QString &text);
+    void stopTyping();
+    void flushReadReceipt();
+    void onThumbnailReady(const QString &filePath, const QImage &image);
+    void onThumbnailFailed(const QString &filePath);
 
 private:
     void setupUI();
     void connectSignals();
     void applyTheme(bool isDark);
-    QString formatMessage(const QString &sender, const QString &message);
-    QString getLightThemeStyleSheet();
-    QString getDarkThemeStyleSheet();
+    QString formatMessage(const QString &sender, const QString &message, const QDateTime &time);
     void createEmojiPanel();
     void setupContextMenu();
-    QString getChatFilePath();
     void handleFileDrop(const QString &filePath);
     void positionEmojiPanel();
+    void setBlockText(int blockNumber, const QString &text);
+    void showImagePreview(const QString &filePath);
+    void resizePreviewImages(const QString &filePath, const QSize &size);
+    static QImage previewPlaceholder();
+    void startExport(const QStringList &conversations, const QString &suggestedName);
+    void shiftBlockNumbers(int delta);
 
     // Core properties
     QString username;
+    QString account;
     bool isDarkTheme;
-    QString chatFilePath;
+    ChatHistoryStore *history;
 
     // UI Elements
     QVBoxLayout *mainLayout;
@@ -84,19 +123,58 @@ private:
     QPushButton *attachButton;
     QPushButton *clearButton;
     QPushButton *exportButton;
+    QLabel *typingLabel;
+    QLabel *receiptLabel;
     QMutex chatMutex;
 
+    // Typing indicators and read receipts
+    QTimer typingIdleTimer;
+    QTimer peerTypingTimer;
+    QTimer readReceiptTimer;
+    QDateTime lastTypingSent;
+    bool typingActive = false;
+    qint64 lastReceivedAt = 0;
+    qint64 lastReadSent = 0;
+    qint64 peerReadUpTo = 0;
+
+    // Delivery markers of outgoing messages, by message id
+    struct OutgoingMarker {
+        int blockNumber;
+        QString text;
+    };
+    QHash<QString, OutgoingMarker> outgoingMarkers;
+
+    // Attachment progress lines, by transfer id
+    struct TransferLine {
+        int blockNumber = -1;
+        int percent = -1;
+    };
+    QHash<QString, TransferLine> transferLines;
+
+    // Inline image previews, by file path
+    ThumbnailPipeline *thumbnails = nullptr;
+    QHash<QString, QList<int>> previewBlocks;
+    int previewCount = 0;
+
     QScopedPointer<QWidget> emojiPanel;
     QScopedPointer<QMenu> contextMenu;
 
     // Message History
-    QList<QPair<QString, QString>> messageHistory;
+    QList<ChatRecord> messageHistory;
+    bool historyLoaded = false;
+    int liveMessagesBeforeLoad = 0;
+    QPointer<ChatExporter> exporter;
+    QPointer<QProgressDialog> exportProgress;
     QMap<QString, QString> emojiMap;
 
     // Constants
     static const int MAX_MESSAGE_LENGTH = 1000;
     static const int MAX_HISTORY_SIZE = 1000;
     static const int MAX_EMOJI_COUNT = 12;
+    static const int TYPING_REFRESH_MS = 3000;
+    static const int TYPING_IDLE_MS = 5000;
+    static const int READ_RECEIPT_DELAY_MS = 500;
+    static const int WINDOW_BASE_BYTES = 256 * 1024;
     static const char* DATE_FORMAT;
 };
 
@@ -0,0 +1,197 @@
+//metrics.cpp
+#include "metrics.h"
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+struct Entry {
+    MetricCounter *counter = nullptr;
+    MetricGauge *gauge = nullptr;
+    MetricSummary *summary = nullptr;
+};
+
+struct Family {
+    QString help;
+    QString type;
+    QMap<QString, Entry> entries;  // by label set
+};
+
+struct Collector {
+    QPointer<QObject> context;
+    QString name;
+    QString help;
+    QString type;
+    std::function<QList<MetricSample>()> collect;
+};
+
+// Metrics are never freed: audio and worker threads may still count while
+// the process shuts down.
+struct Registry {
+    QMutex mutex;
+    QMap<QString, Family> families;
+    QList<Collector> collectors;
+};
+
+Registry &registry()
+{
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+void splitName(const QString &name, QString *family, QString *labels)
+{
+    const int brace = name.indexOf('{');
+    if (brace < 0) {
+        *family = name;
+        labels->clear();
+        return;
+    }
+    *family = name.left(brace);
+    *labels = name.mid(brace + 1, name.size() - brace - 2);
+}
+
+Entry &lookup(const QString &name, const QString &help, const QString &type)
+{
+    QString familyName;
+    QString labels;
+    splitName(name, &familyName, &labels);
+
+    Family &family = registry().families[familyName];
+    if (family.type.isEmpty()) {
+        family.help = help;
+        family.type = type;
+    } else if (family.type != type) {
+        qWarning() << "Metric" << familyName << "registered as both" << family.type << "and" << type;
+    }
+    return family.entries[labels];
+}
+
+QString sampleName(const QString &family, const QString &suffix, const QString &labels)
+{
+    return labels.isEmpty() ? family + suffix : QString("%1%2{%3}").arg(family, suffix, labels);
+}
+
+void writeHeader(QByteArray &out, const QString &name, const QString &help, const QString &type)
+{
+    out += "# HELP " + name.toUtf8() + ' ' + help.toUtf8() + '\n';
+    out += "# TYPE " + name.toUtf8() + ' ' + type.toUtf8() + '\n';
+}
+
+void writeSample(QByteArray &out, const QString &name, double value)
+{
+    out += name.toUtf8() + ' ' + QByteArray::number(value, 'g', 12) + '\n';
+}
+
+} // namespace
+
+int MetricCounter::shardIndex()
+{
+    static std::atomic<int> nextThread{0};
+    thread_local const int index = nextThread.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+qint64 MetricCounter::value() const
+{
+    qint64 total = 0;
+    for (const Shard &shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricCounter &Metrics::counter(const QString &name, const QString &help)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Entry &entry = lookup(name, help, "counter");
+    if (!entry.counter) entry.counter = new MetricCounter;
+    return *entry.counter;
+}
+
+MetricGauge &Metrics::gauge(const QString &name, const QString &help)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Entry &entry = lookup(name, help, "gauge");
+    if (!entry.gauge) entry.gauge = new MetricGauge;
+    return *entry.gauge;
+}
+
+MetricSummary &Metrics::summary(const QString &name, const QString &help)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Entry &entry = lookup(name, help, "summary");
+    if (!entry.summary) entry.summary = new MetricSummary;
+    return *entry.summary;
+}
+
+void Metrics::addCollector(QObject *context, const QString &name, const QString &help,
+                           const QString &type, std::function<QList<MetricSample>()> collect)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.collectors.append({context, name, help, type, std::move(collect)});
+}
+
+QString Metrics::labelValue(const QString &value)
+{
+    QString escaped = value;
+    return escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+}
+
+QByteArray Metrics::render()
+{
+    Registry &r = registry();
+    QByteArray out;
+    QList<Collector> collectors;
+    {
+        QMutexLocker locker(&r.mutex);
+        for (auto family = r.families.cbegin(); family != r.families.cend(); ++family) {
+            writeHeader(out, family.key(), family->help, family->type);
+            for (auto entry = family->entries.cbegin(); entry != family->entries.cend(); ++entry) {
+                if (entry->counter) {
+                    writeSample(out, sampleName(family.key(), QString(), entry.key()), double(entry->counter->value()));
+                } else if (entry->gauge) {
+                    writeSample(out, sampleName(family.key(), QString(), entry.key()), double(entry->gauge->value()));
+                } else if (entry->summary) {
+                    writeSample(out, sampleName(family.key(), "_sum", entry.key()),
+                                double(entry->summary->totalUs()) / 1e6);
+                    writeSample(out, sampleName(family.key(), "_count", entry.key()),
+                                double(entry->summary->observations()));
+                }
+            }
+        }
+
+        r.collectors.erase(std::remove_if(r.collectors.begin(), r.collectors.end(),
+                                          [](const Collector &c) { return c.context.isNull(); }),
+                           r.collectors.end());
+        collectors = r.collectors;
+    }
+
+    // Collectors read objects they do not own, so they run unlocked. Several
+    // objects may report one family (a call per signed-in account); their
+    // samples share a single HELP/TYPE block.
+    std::stable_sort(collectors.begin(), collectors.end(),
+                     [](const Collector &a, const Collector &b) { return a.name < b.name; });
+    QString lastName;
+    for (const Collector &collector : std::as_const(collectors)) {
+        if (!collector.context) continue;
+        const QList<MetricSample> samples = collector.collect();
+        if (samples.isEmpty()) continue;
+        if (collector.name != lastName) {
+            writeHeader(out, collector.name, collector.help, collector.type);
+            lastName = collector.name;
+        }
+        for (const MetricSample &sample : samples) {
+            writeSample(out, sampleName(collector.name, QString(), sample.labels), sample.value);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,91 @@
+//metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+// Counter split across cache-line sized shards. Each thread adds to its own
+// shard with a relaxed atomic add, so counting from the socket, chat and
+// audio paths never contends; readers sum the shards.
+class MetricCounter
+{
+public:
+    void add(qint64 amount = 1)
+    {
+        shards[shardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    qint64 value() const;
+
+private:
+    static constexpr int SHARDS = 16;
+    struct alignas(64) Shard {
+        std::atomic<qint64> value{0};
+    };
+
+    static int shardIndex();
+
+    Shard shards[SHARDS];
+};
+
+class MetricGauge
+{
+public:
+    void set(qint64 value) { current.store(value, std::memory_order_relaxed); }
+    qint64 value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> current{0};
+};
+
+// Count and total of observed durations, exposed as a Prometheus summary
+// in seconds.
+class MetricSummary
+{
+public:
+    void observeUs(qint64 us)
+    {
+        count.add();
+        sumUs.add(us);
+    }
+    qint64 observations() const { return count.value(); }
+    qint64 totalUs() const { return sumUs.value(); }
+
+private:
+    MetricCounter count;
+    MetricCounter sumUs;
+};
+
+struct MetricSample {
+    QString labels;  // e.g. leg="alice"; empty for none
+    double value;
+};
+
+// Process-wide registry rendered in Prometheus text format. Names may carry
+// labels (voip_ws_frames_total{channel="chat"}); samples with the same name
+// before '{' share one HELP/TYPE block. Lookups take a lock, so hot paths
+// look a metric up once and keep the reference.
+class Metrics
+{
+public:
+    static MetricCounter &counter(const QString &name, const QString &help);
+    static MetricGauge &gauge(const QString &name, const QString &help);
+    static MetricSummary &summary(const QString &name, const QString &help);
+
+    // For values owned by another object, e.g. per-leg call quality. The
+    // collector runs on the thread that renders the metrics (the GUI thread)
+    // and is dropped once context is destroyed.
+    static void addCollector(QObject *context, const QString &name, const QString &help,
+                             const QString &type, std::function<QList<MetricSample>()> collect);
+
+    // Escapes a label value for use inside name{label="..."}.
+    static QString labelValue(const QString &value);
+
+    static QByteArray render();
+};
+
+#endif // METRICS_H
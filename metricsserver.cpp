@@ -0,0 +1,78 @@
+//metricsserver.cpp
+#include "metricsserver.h"
+#include "metrics.h"
+#include <QDir>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kProbeTimeoutMs = 200;
+}
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server, &QLocalServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+QString MetricsServer::defaultPath()
+{
+    QString runtimePath = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (runtimePath.isEmpty()) {
+        runtimePath = QDir::tempPath();
+    }
+    return QDir(runtimePath).filePath("voipclient-metrics.sock");
+}
+
+bool MetricsServer::listen(const QString &path)
+{
+    // A socket file left by a crashed instance would make listen() fail, but
+    // only remove it when nothing answers; otherwise it belongs to another
+    // running client.
+    QLocalSocket probe;
+    probe.connectToServer(path);
+    if (probe.waitForConnected(kProbeTimeoutMs)) {
+        qWarning() << "Metrics socket" << path << "is in use by another instance";
+        return false;
+    }
+    QLocalServer::removeServer(path);
+    if (!server.listen(path)) {
+        qWarning() << "Failed to listen for metrics on" << path << ":" << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString MetricsServer::serverPath() const
+{
+    return server.fullServerName();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+
+        QPointer<QLocalSocket> guard(socket);
+        auto respond = [guard]() {
+            if (!guard || guard->property("answered").toBool()) return;
+            guard->setProperty("answered", true);
+
+            const QByteArray body = Metrics::render();
+            if (guard->peek(4) == "GET ") {
+                guard->write("HTTP/1.0 200 OK\r\n"
+                             "Content-Type: text/plain; version=0.0.4\r\n"
+                             "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+            }
+            guard->write(body);
+            guard->disconnectFromServer();
+        };
+
+        connect(socket, &QLocalSocket::readyRead, socket, respond);
+        QTimer::singleShot(SILENT_CLIENT_MS, socket, respond);
+    }
+}
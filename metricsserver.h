@@ -0,0 +1,34 @@
+//metricsserver.h
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QString>
+
+// Serves Metrics::render() on a local socket, only to the current user.
+// A client that sends an HTTP request (curl --unix-socket) gets an HTTP
+// response; one that sends nothing (socat, nc -U) gets the bare text once
+// SILENT_CLIENT_MS has passed.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    bool listen(const QString &path = defaultPath());
+    QString serverPath() const;
+
+    static QString defaultPath();
+
+private slots:
+    void onNewConnection();
+
+private:
+    QLocalServer server;
+
+    static const int SILENT_CLIENT_MS = 200;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,200 @@
+//networkclient.cpp
+#include "networkclient.h"
+#include "socketframequeue.h"
+#include "metrics.h"
+#include "tracer.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QWebSocket>
+#include <QDebug>
+
+namespace {
+
+struct ReceivedMetrics {
+    MetricCounter &frames;
+    MetricCounter &bytes;
+};
+
+ReceivedMetrics receivedMetrics(const QString &account, const char *channel)
+{
+    const QString labels = QString("{account=\"%1\",channel=\"%2\",direction=\"in\"}")
+                               .arg(Metrics::labelValue(account), QString::fromLatin1(channel));
+    return {Metrics::counter("voip_ws_frames_total" + labels, "WebSocket frames by channel and direction."),
+            Metrics::counter("voip_ws_bytes_total" + labels, "WebSocket payload bytes by channel and direction.")};
+}
+
+} // namespace
+
+// Lives on the network thread together with its socket and frame queue.
+class NetworkClient::Worker : public QObject
+{
+public:
+    Worker(NetworkClient *client, const QUrl &url, const QString &account)
+        : client(client), url(url),
+          socket(new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this)),
+          queue(new SocketFrameQueue(socket, account, this)),
+          roster(receivedMetrics(account, "roster")),
+          control(receivedMetrics(account, "control")),
+          bulk(receivedMetrics(account, "bulk"))
+    {
+        connect(socket, &QWebSocket::connected, client, &NetworkClient::connected);
+        connect(socket, &QWebSocket::disconnected, client, &NetworkClient::disconnected);
+        connect(socket, &QWebSocket::errorOccurred, this, [this]() {
+            emit this->client->errorOccurred(socket->errorString());
+        });
+        connect(socket, &QWebSocket::textMessageReceived, this, &Worker::onText);
+        connect(socket, &QWebSocket::binaryMessageReceived, this, [this](const QByteArray &frame) {
+            bulk.frames.add();
+            bulk.bytes.add(frame.size());
+            emit this->client->binaryReceived(frame);
+        });
+    }
+
+    void open() { socket->open(url); }
+    void setScope(const QSet<QString> &names)
+    {
+        scope = names;
+        scoped = true;
+    }
+    void close() { socket->abort(); }
+
+    SocketFrameQueue *frameQueue() const { return queue; }
+
+private:
+    void onText(const QString &message)
+    {
+        // Roster snapshots are bare arrays; everything else is a typed object.
+        // Only the first non-space character decides, so a chat frame that
+        // merely contains '[' is not scanned for one.
+        qsizetype start = 0;
+        while (start < message.size() && message[start].isSpace()) ++start;
+        const bool isRoster = start < message.size() && message[start] == u'[';
+        const QByteArray data = message.toUtf8();
+        if (isRoster) {
+            roster.frames.add();
+            roster.bytes.add(data.size());
+            QList<RosterEntry> entries;
+            if (decodeRoster(data, &entries)) {
+                // Only the newest snapshot in a batch matters.
+                pendingRoster = entries;
+                hasRoster = true;
+            } else {
+                qWarning() << "Invalid server data format.";
+            }
+        } else {
+            control.frames.add();
+            control.bytes.add(data.size());
+            QJsonDocument doc;
+            {
+                TRACE_SCOPE("json", "decode control message");
+                doc = QJsonDocument::fromJson(data);
+            }
+            if (doc.isObject()) {
+                const QJsonObject message = doc.object();
+                if (scoped && message["type"].toString() == QLatin1String("presence")
+                    && !scope.contains(message["name"].toString())) {
+                    // Off screen and not pinned; the server resends it
+                    // once the contact is back in scope.
+                    droppedPresence.add();
+                } else {
+                    pendingControl.append(message);
+                }
+            } else {
+                qWarning() << "Invalid server data format.";
+            }
+        }
+
+        if (!flushScheduled) {
+            flushScheduled = true;
+            QTimer::singleShot(0, this, [this]() { flush(); });
+        }
+    }
+
+    void flush()
+    {
+        flushScheduled = false;
+        if (hasRoster) {
+            emit client->rosterReceived(pendingRoster);
+            pendingRoster.clear();
+            hasRoster = false;
+        }
+        if (!pendingControl.isEmpty()) {
+            emit client->controlReceived(pendingControl);
+            pendingControl.clear();
+        }
+    }
+
+    NetworkClient *client;
+    QUrl url;
+    QWebSocket *socket;
+    SocketFrameQueue *queue;
+
+    QList<RosterEntry> pendingRoster;
+    bool hasRoster = false;
+    QList<QJsonObject> pendingControl;
+    bool flushScheduled = false;
+
+    QSet<QString> scope;
+    bool scoped = false;
+    MetricCounter &droppedPresence = Metrics::counter("voip_presence_dropped_total",
+                                                      "Presence updates dropped as outside the subscribed scope.");
+
+    ReceivedMetrics roster;
+    ReceivedMetrics control;
+    ReceivedMetrics bulk;
+};
+
+NetworkClient::NetworkClient(const QUrl &url, const QString &account, QObject *parent)
+    : QObject(parent), worker(new Worker(this, url, account))
+{
+    thread.setObjectName("Network");
+    worker->moveToThread(&thread);
+    thread.start();
+}
+
+NetworkClient::~NetworkClient()
+{
+    QMetaObject::invokeMethod(worker, [w = worker]() {
+        w->close();
+        delete w;
+    }, Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+}
+
+SocketFrameQueue *NetworkClient::frameQueue() const
+{
+    return worker->frameQueue();
+}
+
+void NetworkClient::setPresenceScope(const QSet<QString> &names)
+{
+    QMetaObject::invokeMethod(worker, [w = worker, names]() { w->setScope(names); });
+}
+
+void NetworkClient::open()
+{
+    QMetaObject::invokeMethod(worker, [w = worker]() { w->open(); });
+}
+
+bool NetworkClient::decodeRoster(const QByteArray &data, QList<RosterEntry> *entries)
+{
+    QJsonDocument doc;
+    {
+        TRACE_SCOPE("json", "decode roster");
+        doc = QJsonDocument::fromJson(data);
+    }
+    if (!doc.isArray()) return false;
+
+    const QJsonArray clientArray = doc.array();
+    entries->clear();
+    entries->reserve(clientArray.size());
+    for (const QJsonValue &value : clientArray) {
+        const QJsonObject clientObj = value.toObject();
+        // status is "Online", "Offline" or "Busy"
+        entries->append({clientObj["name"].toString(), clientObj["status"].toString(),
+                         clientObj["dialplan"].toString(), clientObj["department"].toString()});
+    }
+    return true;
+}
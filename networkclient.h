@@ -0,0 +1,59 @@
+//networkclient.h
+#ifndef NETWORKCLIENT_H
+#define NETWORKCLIENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QThread>
+#include <QUrl>
+#include "rostermodel.h"
+
+class SocketFrameQueue;
+
+// Owns the server connection on a dedicated network thread. Frames are
+// read and JSON-decoded there, and whatever arrives in one pass of that
+// thread's event loop is posted to the GUI thread as one batch: the newest
+// roster snapshot and the control messages in arrival order. Outgoing
+// frames go through frameQueue(), whose enqueue calls may be made from any
+// thread.
+class NetworkClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    // account is AccountData::id() and labels the frame metrics; empty for
+    // the login connection.
+    NetworkClient(const QUrl &url, const QString &account, QObject *parent = nullptr);
+    ~NetworkClient();
+
+    SocketFrameQueue *frameQueue() const;
+
+    // Parses a bare JSON array roster; false if data is not one.
+    static bool decodeRoster(const QByteArray &data, QList<RosterEntry> *entries);
+
+    // Presence updates for anyone outside names are dropped on the network
+    // thread instead of reaching the UI. Unset, every update is delivered.
+    void setPresenceScope(const QSet<QString> &names);
+
+public slots:
+    void open();
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred(const QString &message);
+    void rosterReceived(const QList<RosterEntry> &entries);
+    void controlReceived(const QList<QJsonObject> &messages);
+    void binaryReceived(const QByteArray &frame);
+
+private:
+    class Worker;
+
+    QThread thread;
+    Worker *worker;
+};
+
+#endif // NETWORKCLIENT_H
@@ -0,0 +1,97 @@
+//presencesubscriptions.cpp
+#include "presencesubscriptions.h"
+#include "rosterupdatescheduler.h"
+#include "socketframequeue.h"
+#include "metrics.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScrollBar>
+
+PresenceSubscriptions::PresenceSubscriptions(RosterModel *model, QAbstractItemView *view, QObject *parent)
+    : QObject(parent), model(model), view(view)
+{
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(SETTLE_MS);
+    connect(&settleTimer, &QTimer::timeout, this, &PresenceSubscriptions::update);
+
+    if (view) {
+        connect(view->verticalScrollBar(), &QScrollBar::valueChanged, this, &PresenceSubscriptions::scheduleUpdate);
+        connect(view->verticalScrollBar(), &QScrollBar::rangeChanged, this, &PresenceSubscriptions::scheduleUpdate);
+        if (QAbstractItemModel *shown = view->model()) {
+            connect(shown, &QAbstractItemModel::modelReset, this, &PresenceSubscriptions::scheduleUpdate);
+            connect(shown, &QAbstractItemModel::layoutChanged, this, &PresenceSubscriptions::scheduleUpdate);
+            connect(shown, &QAbstractItemModel::rowsInserted, this, &PresenceSubscriptions::scheduleUpdate);
+            connect(shown, &QAbstractItemModel::rowsRemoved, this, &PresenceSubscriptions::scheduleUpdate);
+            connect(shown, &QAbstractItemModel::rowsMoved, this, &PresenceSubscriptions::scheduleUpdate);
+        }
+    }
+}
+
+void PresenceSubscriptions::setFrameQueue(SocketFrameQueue *frameQueue)
+{
+    queue = frameQueue;
+}
+
+void PresenceSubscriptions::setPinned(const QStringList &names)
+{
+    if (names == pinned) return;
+    pinned = names;
+    scheduleUpdate();
+}
+
+QSet<QString> PresenceSubscriptions::scope() const
+{
+    return current;
+}
+
+void PresenceSubscriptions::scheduleUpdate()
+{
+    if (!settleTimer.isActive()) settleTimer.start();
+}
+
+QString PresenceSubscriptions::frame() const
+{
+    QJsonObject frame{{"type", "presence_scope"},
+                      {"pinned", QJsonArray::fromStringList(pinned)},
+                      {"visible", QJsonArray::fromStringList(visible)}};
+    return QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact));
+}
+
+void PresenceSubscriptions::update()
+{
+    if (recompute() && queue) queue->enqueueCoalesced("presence_scope", frame());
+}
+
+bool PresenceSubscriptions::recompute()
+{
+    static MetricGauge &scopeSize = Metrics::gauge("voip_presence_scope_size", "Contacts in the presence subscription.");
+
+    QStringList rows;
+    QSet<QString> names(pinned.cbegin(), pinned.cend());
+    if (model) {
+        for (int row : RosterUpdateScheduler::visibleRows(model, view, MARGIN_ROWS)) {
+            const QString name = model->nameAt(row);
+            if (!names.contains(name)) {
+                names.insert(name);
+                rows.append(name);
+            }
+        }
+    }
+    if (names == current) return false;
+
+    current = names;
+    visible = rows;
+    scopeSize.set(current.size());
+    emit scopeChanged(current);
+    return true;
+}
+
+void PresenceSubscriptions::sendNow()
+{
+    // A fresh connection has no background frames queued (they are
+    // dropped on disconnect), so nothing older can overtake this one.
+    settleTimer.stop();
+    recompute();
+    if (queue) queue->enqueue(SocketFrameQueue::Signaling, frame());
+}
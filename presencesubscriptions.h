@@ -0,0 +1,60 @@
+//presencesubscriptions.h
+#ifndef PRESENCESUBSCRIPTIONS_H
+#define PRESENCESUBSCRIPTIONS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QAbstractItemView>
+#include "rostermodel.h"
+
+class SocketFrameQueue;
+
+// Keeps the server's presence subscription to what this client can see:
+// pinned contacts plus the rows on screen and MARGIN_ROWS either side.
+// The scope is recomputed a moment after scrolling, resizing, filtering or
+// a new roster settles, and sent as one presence_scope frame replacing
+// the previous one. Until the view has rows the scope is the pinned
+// contacts alone.
+class PresenceSubscriptions : public QObject
+{
+    Q_OBJECT
+
+public:
+    PresenceSubscriptions(RosterModel *model, QAbstractItemView *view, QObject *parent = nullptr);
+
+    void setFrameQueue(SocketFrameQueue *queue);
+    void setPinned(const QStringList &names);
+    QSet<QString> scope() const;
+
+    // Sends the current scope ahead of other traffic, e.g. right after
+    // connecting; later changes go out as coalesced background frames.
+    void sendNow();
+
+signals:
+    void scopeChanged(const QSet<QString> &names);
+
+private slots:
+    void update();
+
+private:
+    void scheduleUpdate();
+    bool recompute();
+    QString frame() const;
+
+    QPointer<RosterModel> model;
+    QPointer<QAbstractItemView> view;
+    QPointer<SocketFrameQueue> queue;
+
+    QStringList pinned;
+    QStringList visible;
+    QSet<QString> current;
+    QTimer settleTimer;
+
+    static const int MARGIN_ROWS = 50;
+    static const int SETTLE_MS = 150;
+};
+
+#endif // PRESENCESUBSCRIPTIONS_H
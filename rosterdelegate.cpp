@@ -0,0 +1,122 @@
+//rosterdelegate.cpp
+#include "rosterdelegate.h"
+#include "rostermodel.h"
+#include <QAbstractItemView>
+#include <QApplication>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionButton>
+#include <algorithm>
+
+namespace {
+
+enum Button {
+    NoButton = 0,
+    MessageButton = 1,
+    CallButton = 2
+};
+
+} // namespace
+
+RosterDelegate::RosterDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+QRect RosterDelegate::callButtonRect(const QRect &row)
+{
+    return QRect(row.right() - SPACING - BUTTON_WIDTH, row.top() + 4, BUTTON_WIDTH, row.height() - 8);
+}
+
+QRect RosterDelegate::messageButtonRect(const QRect &row)
+{
+    return callButtonRect(row).translated(-(BUTTON_WIDTH + SPACING), 0);
+}
+
+void RosterDelegate::paintButton(QPainter *painter, const QStyleOptionViewItem &option, const QRect &rect,
+                                 const QString &text, bool pressed)
+{
+    QStyleOptionButton button;
+    button.rect = rect;
+    button.text = text;
+    button.palette = option.palette;
+    button.state = QStyle::State_Enabled | (pressed ? QStyle::State_Sunken : QStyle::State_Raised);
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_PushButton, &button, painter, widget);
+}
+
+void RosterDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    if (index.data(RosterModel::GroupHeaderRole).toBool()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    // Leave room for the buttons on the right of the name.
+    QStyleOptionViewItem item(option);
+    item.rect.setRight(messageButtonRect(option.rect).left() - SPACING);
+    QStyledItemDelegate::paint(painter, item, index);
+
+    const bool pressed = pressedIndex == index;
+    paintButton(painter, option, messageButtonRect(option.rect), "Msg", pressed && pressedButton == MessageButton);
+    paintButton(painter, option, callButtonRect(option.rect), "Call", pressed && pressedButton == CallButton);
+}
+
+QSize RosterDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    size.setHeight(std::max(size.height(), int(ROW_HEIGHT)));
+    size.rwidth() += 2 * (BUTTON_WIDTH + SPACING) + SPACING;
+    return size;
+}
+
+bool RosterDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                 const QModelIndex &index)
+{
+    if (event->type() != QEvent::MouseButtonPress && event->type() != QEvent::MouseButtonRelease) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+
+    if (index.data(RosterModel::GroupHeaderRole).toBool()) {
+        if (event->type() == QEvent::MouseButtonRelease) emit headerClicked(index);
+        return true;
+    }
+
+    const QPoint pos = static_cast<QMouseEvent *>(event)->position().toPoint();
+    int button = NoButton;
+    if (messageButtonRect(option.rect).contains(pos)) {
+        button = MessageButton;
+    } else if (callButtonRect(option.rect).contains(pos)) {
+        button = CallButton;
+    }
+
+    auto *view = qobject_cast<QAbstractItemView *>(const_cast<QWidget *>(option.widget));
+    if (event->type() == QEvent::MouseButtonPress) {
+        pressedIndex = button != NoButton ? QPersistentModelIndex(index) : QPersistentModelIndex();
+        pressedButton = button;
+        if (button == NoButton) {
+            return QStyledItemDelegate::editorEvent(event, model, option, index);
+        }
+        if (view) view->update(index);
+        return true;
+    }
+
+    // Release: a click only counts on the button it started on.
+    const bool clicked = button != NoButton && pressedIndex == index && pressedButton == button;
+    if (view && pressedIndex.isValid()) view->update(pressedIndex);
+    pressedIndex = QPersistentModelIndex();
+    pressedButton = NoButton;
+    if (!clicked) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+
+    const QString name = index.data(Qt::DisplayRole).toString();
+    if (button == MessageButton) {
+        emit messageClicked(name);
+    } else {
+        emit callClicked(name);
+    }
+    return true;
+}
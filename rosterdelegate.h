@@ -0,0 +1,44 @@
+//rosterdelegate.h
+#ifndef ROSTERDELEGATE_H
+#define ROSTERDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Paints a roster row (status, name, conference check box) and its "Msg"
+// and "Call" buttons. The buttons are drawn rather than being widgets, so
+// a row costs nothing until it is on screen. Section headers are painted
+// as plain bold rows and toggle their section when clicked.
+class RosterDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit RosterDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+signals:
+    void messageClicked(const QString &name);
+    void callClicked(const QString &name);
+    void headerClicked(const QModelIndex &header);
+
+protected:
+    bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override;
+
+private:
+    static QRect messageButtonRect(const QRect &row);
+    static QRect callButtonRect(const QRect &row);
+    static void paintButton(QPainter *painter, const QStyleOptionViewItem &option, const QRect &rect,
+                            const QString &text, bool pressed);
+
+    QPersistentModelIndex pressedIndex;
+    int pressedButton = 0;  // 0 none, 1 message, 2 call
+
+    static const int BUTTON_WIDTH = 60;
+    static const int ROW_HEIGHT = 36;
+    static const int SPACING = 10;
+};
+
+#endif // ROSTERDELEGATE_H
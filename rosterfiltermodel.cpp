@@ -0,0 +1,192 @@
+//rosterfiltermodel.cpp
+#include "rosterfiltermodel.h"
+#include "metrics.h"
+#include "tracer.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <algorithm>
+
+RosterFilterModel::RosterFilterModel(RosterModel *source, QObject *parent)
+    : QAbstractProxyModel(parent), roster(source)
+{
+    setSourceModel(source);
+    connect(source, &QAbstractItemModel::modelAboutToBeReset, this, &RosterFilterModel::onSourceAboutToBeReset);
+    connect(source, &QAbstractItemModel::modelReset, this, &RosterFilterModel::onSourceReset);
+    connect(source, &QAbstractItemModel::dataChanged, this, &RosterFilterModel::onSourceDataChanged);
+}
+
+QModelIndex RosterFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex RosterFilterModel::parent(const QModelIndex &) const
+{
+    return QModelIndex();
+}
+
+int RosterFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !roster) return 0;
+    return isFiltering() ? int(sourceRows.size()) : roster->rowCount();
+}
+
+int RosterFilterModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex RosterFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !roster) return QModelIndex();
+    if (!isFiltering()) return roster->index(proxyIndex.row());
+    if (proxyIndex.row() >= sourceRows.size()) return QModelIndex();
+    return roster->index(sourceRows[proxyIndex.row()]);
+}
+
+QModelIndex RosterFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) return QModelIndex();
+    if (!isFiltering()) return createIndex(sourceIndex.row(), 0);
+    const int row = sourceIndex.row() < proxyRows.size() ? proxyRows[sourceIndex.row()] : -1;
+    return row >= 0 ? createIndex(row, 0) : QModelIndex();
+}
+
+void RosterFilterModel::setQuery(const QString &query)
+{
+    if (query == currentQuery) return;
+    currentQuery = query;
+    refilter();
+}
+
+QString RosterFilterModel::query() const
+{
+    return currentQuery;
+}
+
+void RosterFilterModel::setStatusFilter(const QString &status)
+{
+    if (status == currentStatus) return;
+    currentStatus = status;
+    refilter();
+}
+
+QString RosterFilterModel::statusFilter() const
+{
+    return currentStatus;
+}
+
+bool RosterFilterModel::isFiltering() const
+{
+    return !currentQuery.trimmed().isEmpty() || !currentStatus.isEmpty();
+}
+
+bool RosterFilterModel::accepts(int sourceRow) const
+{
+    return currentStatus.isEmpty() || roster->statusAt(sourceRow) == currentStatus;
+}
+
+void RosterFilterModel::rebuildMapping()
+{
+    sourceRows.clear();
+    proxyRows.clear();
+    if (!roster || !isFiltering()) return;
+
+    const int count = roster->rowCount();
+    if (currentQuery.trimmed().isEmpty()) {
+        sourceRows.reserve(count);
+        for (int row = 0; row < count; ++row) {
+            if (accepts(row)) sourceRows.append(row);
+        }
+    } else {
+        if (indexStale) {
+            searchIndex.build(roster->entries());
+            indexStale = false;
+        }
+        sourceRows = searchIndex.search(currentQuery);
+        if (!currentStatus.isEmpty()) {
+            sourceRows.erase(std::remove_if(sourceRows.begin(), sourceRows.end(),
+                                            [this](int row) { return !accepts(row); }),
+                             sourceRows.end());
+        }
+    }
+
+    proxyRows.fill(-1, count);
+    for (int i = 0; i < sourceRows.size(); ++i) {
+        proxyRows[sourceRows[i]] = i;
+    }
+}
+
+void RosterFilterModel::refilter()
+{
+    TRACE_SCOPE("roster", "RosterFilterModel::refilter");
+    static MetricSummary &searchTime = Metrics::summary("voip_roster_search_seconds", "Time to filter the roster for a search.");
+    QElapsedTimer timer;
+    timer.start();
+
+    refilterQueued = false;
+    beginResetModel();
+    rebuildMapping();
+    endResetModel();
+
+    searchTime.observeUs(timer.nsecsElapsed() / 1000);
+}
+
+void RosterFilterModel::scheduleRefilter()
+{
+    // Status changes arrive in per-frame batches; regroup once per batch.
+    if (refilterQueued) return;
+    refilterQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        if (refilterQueued) refilter();
+    });
+}
+
+void RosterFilterModel::onSourceAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void RosterFilterModel::onSourceReset()
+{
+    indexStale = true;
+    if (isFiltering()) {
+        rebuildMapping();
+    } else {
+        searchIndex.clear();
+    }
+    refilterQueued = false;
+    endResetModel();
+}
+
+void RosterFilterModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                            const QList<int> &roles)
+{
+    if (!isFiltering()) {
+        emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight), roles);
+        return;
+    }
+    if (refilterQueued) return;
+
+    // Shown rows may be anywhere in the ranking, so forward per contiguous
+    // run of proxy rows; a status that enters or leaves the filter regroups.
+    const bool statusChanged = roles.isEmpty() || roles.contains(RosterModel::StatusRole);
+    int runStart = -1;
+    int runEnd = -1;
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const int shown = proxyRows.value(row, -1);
+        if (statusChanged && !currentStatus.isEmpty() && (shown >= 0) != accepts(row)) {
+            scheduleRefilter();
+            return;
+        }
+        if (shown < 0) continue;
+        if (shown == runEnd + 1 && runStart >= 0) {
+            runEnd = shown;
+            continue;
+        }
+        if (runStart >= 0) emit dataChanged(index(runStart, 0), index(runEnd, 0), roles);
+        runStart = runEnd = shown;
+    }
+    if (runStart >= 0) emit dataChanged(index(runStart, 0), index(runEnd, 0), roles);
+}
@@ -0,0 +1,60 @@
+//rosterfiltermodel.h
+#ifndef ROSTERFILTERMODEL_H
+#define ROSTERFILTERMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include "rostermodel.h"
+#include "rostersearchindex.h"
+
+// Search and status filter in front of the roster model. Without either
+// it passes rows straight through; with a query it shows the ranked
+// matches from a RosterSearchIndex, which is built on the first search
+// after a membership change. Filtering only swaps the row mapping, so a
+// keystroke never touches the source model or the delegate.
+class RosterFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit RosterFilterModel(RosterModel *source, QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+    void setQuery(const QString &query);
+    QString query() const;
+    // Only entries with this status; empty for all.
+    void setStatusFilter(const QString &status);
+    QString statusFilter() const;
+    bool isFiltering() const;
+
+private slots:
+    void onSourceAboutToBeReset();
+    void onSourceReset();
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+
+private:
+    void refilter();
+    void scheduleRefilter();
+    void rebuildMapping();
+    bool accepts(int sourceRow) const;
+
+    QPointer<RosterModel> roster;
+    RosterSearchIndex searchIndex;
+    bool indexStale = true;
+
+    QString currentQuery;
+    QString currentStatus;
+    QVector<int> sourceRows;   // proxy row -> source row
+    QVector<int> proxyRows;    // source row -> proxy row, -1 when hidden
+    bool refilterQueued = false;
+};
+
+#endif // ROSTERFILTERMODEL_H
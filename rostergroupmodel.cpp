@@ -0,0 +1,428 @@
+//rostergroupmodel.cpp
+#include "rostergroupmodel.h"
+#include "rostermodel.h"
+#include "tracer.h"
+#include <QFont>
+#include <QMap>
+#include <algorithm>
+
+namespace {
+
+// Digits of the extension that name its section, e.g. 10xxx.
+const int kDialplanPrefixLength = 2;
+// Not a department or prefix a server can send.
+const QString kPinnedKey = QStringLiteral("\u0001pinned");
+
+int rankOf(const QString &status)
+{
+    if (status == QLatin1String("Online")) return 0;
+    if (status == QLatin1String("Busy")) return 1;
+    if (status == QLatin1String("Offline")) return 2;
+    return 3;
+}
+
+} // namespace
+
+RosterGroupModel::RosterGroupModel(QObject *parent)
+    : QAbstractProxyModel(parent)
+{
+}
+
+void RosterGroupModel::setSourceModel(QAbstractItemModel *source)
+{
+    beginResetModel();
+    if (sourceModel()) {
+        disconnect(sourceModel(), nullptr, this, nullptr);
+    }
+    QAbstractProxyModel::setSourceModel(source);
+    if (source) {
+        connect(source, &QAbstractItemModel::modelAboutToBeReset, this, &RosterGroupModel::onSourceAboutToBeReset);
+        connect(source, &QAbstractItemModel::modelReset, this, &RosterGroupModel::onSourceReset);
+        connect(source, &QAbstractItemModel::dataChanged, this, &RosterGroupModel::onSourceDataChanged);
+    }
+    rebuild();
+    endResetModel();
+}
+
+QModelIndex RosterGroupModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex RosterGroupModel::parent(const QModelIndex &) const
+{
+    return QModelIndex();
+}
+
+int RosterGroupModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !sourceModel()) return 0;
+    return passThrough() ? sourceModel()->rowCount() : totalRows;
+}
+
+int RosterGroupModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+bool RosterGroupModel::passThrough() const
+{
+    return !sorting;
+}
+
+QModelIndex RosterGroupModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !sourceModel()) return QModelIndex();
+    if (passThrough()) return sourceModel()->index(proxyIndex.row(), 0);
+
+    const int row = proxyIndex.row();
+    auto group = std::upper_bound(groups.cbegin(), groups.cend(), row,
+                                  [](int value, const Group &g) { return value < g.firstRow; });
+    if (group == groups.cbegin()) return QModelIndex();
+    --group;
+    const int offset = row - group->firstRow - (group->header ? 1 : 0);
+    if (offset < 0 || offset >= group->members.size() || collapsed.contains(group->key)) return QModelIndex();
+    return sourceModel()->index(group->members[offset], 0);
+}
+
+QModelIndex RosterGroupModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) return QModelIndex();
+    if (passThrough()) return createIndex(sourceIndex.row(), 0);
+
+    const int sourceRow = sourceIndex.row();
+    if (sourceRow >= groupOf.size()) return QModelIndex();
+    const Group &group = groups[groupOf[sourceRow]];
+    if (collapsed.contains(group.key)) return QModelIndex();
+    return createIndex(group.firstRow + (group.header ? 1 : 0) + positionOf(group, sourceRow), 0);
+}
+
+QVariant RosterGroupModel::data(const QModelIndex &index, int role) const
+{
+    if (!isGroupHeader(index)) {
+        return QAbstractProxyModel::data(index, role);
+    }
+
+    auto group = std::upper_bound(groups.cbegin(), groups.cend(), index.row(),
+                                  [](int value, const Group &g) { return value < g.firstRow; }) - 1;
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1 %2 (%3)")
+            .arg(collapsed.contains(group->key) ? QChar(0x25B8) : QChar(0x25BE))
+            .arg(group->title)
+            .arg(group->members.size());
+    case Qt::FontRole: {
+        QFont font;
+        font.setBold(true);
+        return font;
+    }
+    case RosterModel::GroupHeaderRole:
+        return true;
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags RosterGroupModel::flags(const QModelIndex &index) const
+{
+    if (isGroupHeader(index)) return Qt::ItemIsEnabled;
+    return QAbstractProxyModel::flags(index);
+}
+
+void RosterGroupModel::setGroupBy(GroupBy groupBy)
+{
+    if (grouping == groupBy) return;
+    beginResetModel();
+    grouping = groupBy;
+    collapsed.clear();
+    rebuild();
+    endResetModel();
+}
+
+RosterGroupModel::GroupBy RosterGroupModel::groupBy() const
+{
+    return grouping;
+}
+
+void RosterGroupModel::setSortingEnabled(bool enabled)
+{
+    if (sorting == enabled) return;
+    beginResetModel();
+    sorting = enabled;
+    rebuild();
+    endResetModel();
+}
+
+bool RosterGroupModel::isSortingEnabled() const
+{
+    return sorting;
+}
+
+void RosterGroupModel::setPinned(const QSet<QString> &names)
+{
+    if (names == pinned) return;
+    beginResetModel();
+    pinned = names;
+    rebuild();
+    endResetModel();
+}
+
+bool RosterGroupModel::isGroupHeader(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.model() != this || passThrough()) return false;
+    auto group = std::upper_bound(groups.cbegin(), groups.cend(), index.row(),
+                                  [](int value, const Group &g) { return value < g.firstRow; });
+    return group != groups.cbegin() && (group - 1)->header && (group - 1)->firstRow == index.row();
+}
+
+void RosterGroupModel::toggleGroup(const QModelIndex &header)
+{
+    if (!isGroupHeader(header)) return;
+    auto group = std::upper_bound(groups.cbegin(), groups.cend(), header.row(),
+                                  [](int value, const Group &g) { return value < g.firstRow; }) - 1;
+    const QString key = group->key;
+    const int first = group->firstRow + 1;
+    const int last = group->firstRow + int(group->members.size());
+
+    if (collapsed.contains(key)) {
+        beginInsertRows(QModelIndex(), first, last);
+        collapsed.remove(key);
+        layoutRows();
+        endInsertRows();
+    } else {
+        beginRemoveRows(QModelIndex(), first, last);
+        collapsed.insert(key);
+        layoutRows();
+        endRemoveRows();
+    }
+    emit dataChanged(header, header, {Qt::DisplayRole});
+}
+
+bool RosterGroupModel::lessThan(int a, const SortKey &keyA, int b, const SortKey &keyB) const
+{
+    if (keyA.rank != keyB.rank) return keyA.rank < keyB.rank;
+    const int byName = keyA.name.compare(keyB.name);
+    if (byName != 0) return byName < 0;
+    return a < b;
+}
+
+int RosterGroupModel::statusRank(int sourceRow) const
+{
+    return rankOf(sourceModel()->index(sourceRow, 0).data(RosterModel::StatusRole).toString());
+}
+
+QString RosterGroupModel::groupKey(int sourceRow) const
+{
+    const QModelIndex index = sourceModel()->index(sourceRow, 0);
+    if (grouping == ByDepartment) {
+        return index.data(RosterModel::DepartmentRole).toString().trimmed();
+    }
+    if (grouping == ByDialplanPrefix) {
+        const QString dialplan = index.data(RosterModel::DialplanRole).toString().trimmed();
+        if (dialplan.size() <= kDialplanPrefixLength) return dialplan;
+        return dialplan.left(kDialplanPrefixLength) + QString(dialplan.size() - kDialplanPrefixLength, 'x');
+    }
+    return QString();
+}
+
+int RosterGroupModel::positionOf(const Group &group, int sourceRow) const
+{
+    const SortKey &key = keys[sourceRow];
+    auto it = std::lower_bound(group.members.cbegin(), group.members.cend(), sourceRow,
+                               [this, &key](int member, int row) { return lessThan(member, keys[member], row, key); });
+    return int(it - group.members.cbegin());
+}
+
+void RosterGroupModel::rebuild()
+{
+    groups.clear();
+    groupOf.clear();
+    keys.clear();
+    totalRows = 0;
+    if (!sourceModel() || passThrough()) return;
+    TRACE_SCOPE("roster", "RosterGroupModel::rebuild");
+
+    const int count = sourceModel()->rowCount();
+    keys.reserve(count);
+    QVector<int> pinnedRows;
+    QMap<QString, QVector<int>> byKey;
+    for (int row = 0; row < count; ++row) {
+        const QString name = sourceModel()->index(row, 0).data(Qt::DisplayRole).toString();
+        keys.append({statusRank(row), name.toCaseFolded()});
+        if (pinned.contains(name)) {
+            pinnedRows.append(row);
+        } else {
+            byKey[groupKey(row)].append(row);
+        }
+    }
+
+    // Pinned contacts first, then named sections in order, the unnamed
+    // one last.
+    groupOf.resize(count);
+    auto addGroup = [this](const QString &key, const QString &title, bool header, QVector<int> &members) {
+        std::sort(members.begin(), members.end(),
+                  [this](int a, int b) { return lessThan(a, keys[a], b, keys[b]); });
+        for (int row : std::as_const(members)) {
+            groupOf[row] = int(groups.size());
+        }
+        groups.append({key, title, members, 0, header});
+    };
+    if (!pinnedRows.isEmpty()) addGroup(kPinnedKey, "Favorites and recent", true, pinnedRows);
+    for (auto it = byKey.begin(); it != byKey.end(); ++it) {
+        if (!it.key().isEmpty()) addGroup(it.key(), it.key(), grouping != NoGrouping, it.value());
+    }
+    if (byKey.contains(QString())) {
+        const QString title = grouping == ByDepartment ? "No department" : "No extension";
+        addGroup(QString(), title, grouping != NoGrouping, byKey[QString()]);
+    }
+
+    layoutRows();
+}
+
+void RosterGroupModel::layoutRows()
+{
+    int row = 0;
+    for (Group &group : groups) {
+        group.firstRow = row;
+        row += group.header ? 1 : 0;
+        if (!collapsed.contains(group.key)) row += int(group.members.size());
+    }
+    totalRows = row;
+}
+
+void RosterGroupModel::reposition(int sourceRow, int rank)
+{
+    Group &group = groups[groupOf[sourceRow]];
+    const int oldPos = positionOf(group, sourceRow);
+    const SortKey moved{rank, keys[sourceRow].name};
+
+    // The members are sorted by their current keys, so the insertion point
+    // for the new key is a binary search too.
+    auto it = std::lower_bound(group.members.begin(), group.members.end(), sourceRow,
+                               [this, &moved](int member, int row) { return lessThan(member, keys[member], row, moved); });
+    const int newPos = int(it - group.members.begin());
+    if (newPos == oldPos || newPos == oldPos + 1) {
+        keys[sourceRow].rank = rank;
+        return;
+    }
+
+    const bool shown = !collapsed.contains(group.key);
+    const int base = group.firstRow + (group.header ? 1 : 0);
+    if (shown) beginMoveRows(QModelIndex(), base + oldPos, base + oldPos, QModelIndex(), base + newPos);
+    keys[sourceRow].rank = rank;
+    if (newPos > oldPos) {
+        std::rotate(group.members.begin() + oldPos, group.members.begin() + oldPos + 1, group.members.begin() + newPos);
+    } else {
+        std::rotate(group.members.begin() + newPos, group.members.begin() + oldPos, group.members.begin() + oldPos + 1);
+    }
+    if (shown) endMoveRows();
+}
+
+void RosterGroupModel::resortAll(const QVector<int> &rows)
+{
+    TRACE_SCOPE("roster", "RosterGroupModel::resort");
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    // Remember what every persistent index points at: a source row, or
+    // for a header the section it heads.
+    const QModelIndexList persistent = persistentIndexList();
+    QVector<int> sourceRows;
+    QVector<int> headerGroups;
+    sourceRows.reserve(persistent.size());
+    headerGroups.reserve(persistent.size());
+    for (const QModelIndex &index : persistent) {
+        int header = -1;
+        if (isGroupHeader(index)) {
+            header = int(std::upper_bound(groups.cbegin(), groups.cend(), index.row(),
+                                          [](int value, const Group &g) { return value < g.firstRow; })
+                         - groups.cbegin()) - 1;
+        }
+        sourceRows.append(header < 0 ? mapToSource(index).row() : -1);
+        headerGroups.append(header);
+    }
+
+    QSet<int> touched;
+    for (int row : rows) {
+        touched.insert(groupOf[row]);
+    }
+    for (int g : std::as_const(touched)) {
+        QVector<int> &members = groups[g].members;
+        std::sort(members.begin(), members.end(),
+                  [this](int a, int b) { return lessThan(a, keys[a], b, keys[b]); });
+    }
+
+    QModelIndexList updated;
+    updated.reserve(persistent.size());
+    for (int i = 0; i < persistent.size(); ++i) {
+        if (headerGroups[i] >= 0) {
+            updated.append(createIndex(groups[headerGroups[i]].firstRow, 0));
+        } else {
+            updated.append(sourceRows[i] >= 0 ? mapFromSource(sourceModel()->index(sourceRows[i], 0)) : QModelIndex());
+        }
+    }
+    changePersistentIndexList(persistent, updated);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void RosterGroupModel::onSourceAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void RosterGroupModel::onSourceReset()
+{
+    rebuild();
+    endResetModel();
+}
+
+void RosterGroupModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                           const QList<int> &roles)
+{
+    if (passThrough()) {
+        emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight), roles);
+        return;
+    }
+
+    const bool statusChanged = roles.isEmpty() || roles.contains(RosterModel::StatusRole);
+    QVector<int> moved;
+    QVector<int> ranks;
+    for (int row = topLeft.row(); statusChanged && row <= bottomRight.row(); ++row) {
+        const int rank = statusRank(row);
+        if (rank != keys[row].rank) {
+            moved.append(row);
+            ranks.append(rank);
+        }
+    }
+
+    if (moved.size() > INCREMENTAL_LIMIT) {
+        for (int i = 0; i < moved.size(); ++i) {
+            keys[moved[i]].rank = ranks[i];
+        }
+        resortAll(moved);
+    } else {
+        for (int i = 0; i < moved.size(); ++i) {
+            reposition(moved[i], ranks[i]);
+        }
+    }
+
+    // Changed rows are scattered over the sorted order; past a handful,
+    // one repaint of everything is cheaper than mapping each of them.
+    const int changed = bottomRight.row() - topLeft.row() + 1;
+    if (changed > INCREMENTAL_LIMIT) {
+        if (totalRows > 0) emit dataChanged(index(0, 0), index(totalRows - 1, 0), roles);
+        return;
+    }
+    QVector<int> rows;
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex shown = mapFromSource(sourceModel()->index(row, 0));
+        if (shown.isValid()) rows.append(shown.row());
+    }
+    std::sort(rows.begin(), rows.end());
+    for (qsizetype i = 0; i < rows.size();) {
+        qsizetype end = i;
+        while (end + 1 < rows.size() && rows[end + 1] == rows[end] + 1) ++end;
+        emit dataChanged(index(rows[i], 0), index(rows[end], 0), roles);
+        i = end + 1;
+    }
+}
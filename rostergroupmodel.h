@@ -0,0 +1,96 @@
+//rostergroupmodel.h
+#ifndef ROSTERGROUPMODEL_H
+#define ROSTERGROUPMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// Orders the roster by status (Online, Busy, Offline), then by name, and
+// optionally splits it into collapsible sections by department or by
+// dialplan prefix, each under a header row. Pinned contacts (favorites,
+// recents) get a section of their own above the rest. Rows are sorted
+// once per membership change; after that a status change repositions
+// just that row with a binary search and announces it as a single row
+// move. Large batches of status changes re-sort the affected sections
+// instead. With sorting disabled, e.g. for ranked search results, rows
+// pass through in source order.
+class RosterGroupModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    enum GroupBy {
+        NoGrouping = 0,
+        ByDepartment = 1,
+        ByDialplanPrefix = 2
+    };
+
+    explicit RosterGroupModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *source) override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    void setGroupBy(GroupBy groupBy);
+    GroupBy groupBy() const;
+    void setSortingEnabled(bool enabled);
+    bool isSortingEnabled() const;
+    // Contacts shown in their own section above all others.
+    void setPinned(const QSet<QString> &names);
+
+    bool isGroupHeader(const QModelIndex &index) const;
+    void toggleGroup(const QModelIndex &header);
+
+private slots:
+    void onSourceAboutToBeReset();
+    void onSourceReset();
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+
+private:
+    struct SortKey {
+        int rank;
+        QString name;
+    };
+
+    struct Group {
+        QString key;
+        QString title;
+        QVector<int> members;  // source rows, sorted
+        int firstRow = 0;      // proxy row of the header, or of the first member
+        bool header = false;
+    };
+
+    bool passThrough() const;
+    bool lessThan(int a, const SortKey &keyA, int b, const SortKey &keyB) const;
+    int statusRank(int sourceRow) const;
+    QString groupKey(int sourceRow) const;
+    int positionOf(const Group &group, int sourceRow) const;
+    void rebuild();
+    void layoutRows();
+    void reposition(int sourceRow, int rank);
+    void resortAll(const QVector<int> &rows);
+
+    GroupBy grouping = NoGrouping;
+    bool sorting = true;
+    QVector<Group> groups;
+    QVector<int> groupOf;     // source row -> group
+    QVector<SortKey> keys;    // source row -> sort key
+    QSet<QString> collapsed;  // group keys
+    QSet<QString> pinned;     // names
+    int totalRows = 0;
+
+    // Above this many repositions in one batch a re-sort is cheaper than
+    // one row move each.
+    static const int INCREMENTAL_LIMIT = 64;
+};
+
+#endif // ROSTERGROUPMODEL_H
@@ -0,0 +1,217 @@
+//rostermodel.cpp
+#include "rostermodel.h"
+#include <QPainter>
+#include <QPixmap>
+
+namespace {
+
+const int kStatusIconSize = 16;
+
+QPixmap paintStatusIcon(const QColor &color)
+{
+    QPixmap pixmap(kStatusIconSize, kStatusIconSize);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setBrush(color);
+    painter.setPen(Qt::NoPen);
+    painter.drawEllipse(0, 0, kStatusIconSize, kStatusIconSize);
+    return pixmap;
+}
+
+} // namespace
+
+RosterModel::RosterModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int RosterModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+QVariant RosterModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) return QVariant();
+    const RosterEntry &entry = rows[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.name;
+    case Qt::DecorationRole:
+        return statusIcon(entry.status);
+    case Qt::ToolTipRole:
+        return entry.status;
+    case StatusRole:
+        return entry.status;
+    case DialplanRole:
+        return entry.dialplan;
+    case DepartmentRole:
+        return entry.department;
+    case Qt::CheckStateRole:
+        if (!checkable) return QVariant();
+        return isChecked(entry.name) ? Qt::Checked : Qt::Unchecked;
+    default:
+        return QVariant();
+    }
+}
+
+bool RosterModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::CheckStateRole || !checkable) return false;
+
+    const QString &name = rows[index.row()].name;
+    if ((value.toInt() == Qt::Checked) != allChecked) {
+        toggled.insert(name);
+    } else {
+        toggled.remove(name);
+    }
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    emit selectionChanged();
+    return true;
+}
+
+Qt::ItemFlags RosterModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags result = QAbstractListModel::flags(index);
+    if (checkable && index.isValid()) {
+        result |= Qt::ItemIsUserCheckable;
+    }
+    return result;
+}
+
+int RosterModel::rowOf(const QString &name) const
+{
+    return rowByName.value(name, -1);
+}
+
+QString RosterModel::nameAt(int row) const
+{
+    return row >= 0 && row < rows.size() ? rows[row].name : QString();
+}
+
+QString RosterModel::statusAt(int row) const
+{
+    return row >= 0 && row < rows.size() ? rows[row].status : QString();
+}
+
+const QVector<RosterEntry> &RosterModel::entries() const
+{
+    return rows;
+}
+
+bool RosterModel::sameMembers(const QList<RosterEntry> &entries) const
+{
+    if (entries.size() != rows.size()) return false;
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        if (entries[i].name != rows[i].name) return false;
+    }
+    return true;
+}
+
+void RosterModel::reset(const QList<RosterEntry> &entries)
+{
+    beginResetModel();
+    rows = QVector<RosterEntry>(entries.cbegin(), entries.cend());
+    rowByName.clear();
+    rowByName.reserve(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        rowByName.insert(rows[i].name, i);
+    }
+    // Keeps checkedCount() exact: toggles only for names still present.
+    const qsizetype before = toggled.size();
+    toggled.removeIf([this](const QString &name) { return !rowByName.contains(name); });
+    endResetModel();
+    if (toggled.size() != before) emit selectionChanged();
+}
+
+void RosterModel::clear()
+{
+    if (rows.isEmpty()) return;
+    beginResetModel();
+    rows.clear();
+    rowByName.clear();
+    toggled.clear();
+    endResetModel();
+    emit selectionChanged();
+}
+
+int RosterModel::setStatus(const QString &name, const QString &status)
+{
+    const int row = rowByName.value(name, -1);
+    if (row < 0 || rows[row].status == status) return -1;
+    rows[row].status = status;
+    return row;
+}
+
+void RosterModel::notifyRowsChanged(int first, int last)
+{
+    if (first < 0 || last < first) return;
+    emit dataChanged(index(first), index(last), {Qt::DisplayRole, Qt::DecorationRole, Qt::ToolTipRole, StatusRole});
+}
+
+void RosterModel::setCheckable(bool enabled)
+{
+    if (checkable == enabled) return;
+    checkable = enabled;
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0), index(int(rows.size()) - 1), {Qt::CheckStateRole});
+    }
+}
+
+bool RosterModel::isCheckable() const
+{
+    return checkable;
+}
+
+void RosterModel::setAllChecked(bool all)
+{
+    // Flipping the default is all it takes; only the rows toggled since
+    // the last select/clear-all are forgotten.
+    allChecked = all;
+    toggled = QSet<QString>();
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0), index(int(rows.size()) - 1), {Qt::CheckStateRole});
+    }
+    emit selectionChanged();
+}
+
+bool RosterModel::isChecked(const QString &name) const
+{
+    return allChecked != toggled.contains(name);
+}
+
+int RosterModel::checkedCount() const
+{
+    return allChecked ? int(rows.size() - toggled.size()) : int(toggled.size());
+}
+
+QStringList RosterModel::checkedNames() const
+{
+    // In roster order, not hash order.
+    QStringList names;
+    if (!allChecked) {
+        if (toggled.isEmpty()) return names;
+        names.reserve(toggled.size());
+    }
+    for (const RosterEntry &entry : rows) {
+        if (isChecked(entry.name)) {
+            names.append(entry.name);
+        }
+    }
+    return names;
+}
+
+const QPixmap &RosterModel::statusIcon(const QString &status)
+{
+    static const QPixmap online = paintStatusIcon(Qt::green);
+    static const QPixmap offline = paintStatusIcon(Qt::red);
+    static const QPixmap busy = paintStatusIcon(Qt::yellow);
+    static const QPixmap unknown = paintStatusIcon(Qt::gray);
+
+    if (status == QLatin1String("Online")) return online;
+    if (status == QLatin1String("Offline")) return offline;
+    if (status == QLatin1String("Busy")) return busy;
+    return unknown;
+}
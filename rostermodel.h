@@ -0,0 +1,86 @@
+//rostermodel.h
+#ifndef ROSTERMODEL_H
+#define ROSTERMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct RosterEntry {
+    QString name;
+    QString status;  // "Online", "Offline", "Busy" as sent by the server
+    QString dialplan;
+    QString department;
+};
+
+// Presence list behind the client window's roster view. Rows keep server
+// order. Status changes are written with setStatus() and announced in
+// ranges with notifyRowsChanged(), so a caller applying many changes emits
+// one dataChanged() per contiguous block instead of one per row.
+// Conference selection is kept by name and survives snapshots; after
+// select-all, contacts who join later are selected too.
+class RosterModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        StatusRole = Qt::UserRole + 1,
+        DialplanRole,
+        DepartmentRole,
+        // True on section headers added by RosterGroupModel.
+        GroupHeaderRole
+    };
+
+    explicit RosterModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    int rowOf(const QString &name) const;
+    QString nameAt(int row) const;
+    QString statusAt(int row) const;
+    const QVector<RosterEntry> &entries() const;
+
+    // True when entries have exactly the current names in the current
+    // order, i.e. only statuses can differ.
+    bool sameMembers(const QList<RosterEntry> &entries) const;
+    void reset(const QList<RosterEntry> &entries);
+    void clear();
+
+    // Writes without notifying; returns the row or -1 when unknown or
+    // unchanged.
+    int setStatus(const QString &name, const QString &status);
+    void notifyRowsChanged(int first, int last);
+
+    // Conference selection
+    void setCheckable(bool checkable);
+    bool isCheckable() const;
+    void setAllChecked(bool checked);
+    bool isChecked(const QString &name) const;
+    int checkedCount() const;
+    QStringList checkedNames() const;
+
+    static const QPixmap &statusIcon(const QString &status);
+
+signals:
+    void selectionChanged();
+
+private:
+    QVector<RosterEntry> rows;
+    QHash<QString, int> rowByName;
+    // Selection is a default (everyone or no one) plus the names toggled
+    // away from it, so select-all and clear-all are O(1).
+    bool allChecked = false;
+    QSet<QString> toggled;
+    bool checkable = false;
+};
+
+#endif // ROSTERMODEL_H
@@ -0,0 +1,140 @@
+//rostersearchindex.cpp
+#include "rostersearchindex.h"
+#include "tracer.h"
+#include <algorithm>
+
+namespace {
+
+const int kExactScore = 1000;
+const int kNamePrefixScore = 800;
+const int kDialplanPrefixScore = 700;
+const int kWordPrefixScore = 600;
+// Trigram matches score between these two by overlap.
+const int kFuzzyBaseScore = 100;
+const int kFuzzyRangeScore = 400;
+
+bool isWordBreak(QChar c)
+{
+    return c.isSpace() || c == '.' || c == '_' || c == '-' || c == '@';
+}
+
+} // namespace
+
+QString RosterSearchIndex::fold(const QString &text)
+{
+    return text.toCaseFolded();
+}
+
+quint64 RosterSearchIndex::trigram(const QChar *chars)
+{
+    return (quint64(chars[0].unicode()) << 32) | (quint64(chars[1].unicode()) << 16) | chars[2].unicode();
+}
+
+void RosterSearchIndex::addTrigrams(const QString &text, int row)
+{
+    for (qsizetype i = 0; i + 3 <= text.size(); ++i) {
+        QVector<int> &rows = postings[trigram(text.constData() + i)];
+        // Rows are added in order, so a repeat within one entry is the last one.
+        if (rows.isEmpty() || rows.last() != row) rows.append(row);
+    }
+}
+
+void RosterSearchIndex::build(const QVector<RosterEntry> &entries)
+{
+    TRACE_SCOPE("roster", "RosterSearchIndex::build");
+    clear();
+    rowCount = int(entries.size());
+    keys.reserve(rowCount * 2);
+
+    for (int row = 0; row < rowCount; ++row) {
+        const QString name = fold(entries[row].name);
+        if (!name.isEmpty()) keys.append({name, row, kNamePrefixScore});
+        for (qsizetype i = 1; i < name.size(); ++i) {
+            if (isWordBreak(name[i - 1]) && !isWordBreak(name[i])) {
+                keys.append({name.mid(i), row, kWordPrefixScore});
+            }
+        }
+        addTrigrams(name, row);
+
+        const QString dialplan = fold(entries[row].dialplan);
+        if (!dialplan.isEmpty()) {
+            keys.append({dialplan, row, kDialplanPrefixScore});
+            addTrigrams(dialplan, row);
+        }
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const Key &a, const Key &b) { return a.text < b.text; });
+    scores.fill(0, rowCount);
+    shared.fill(0, rowCount);
+}
+
+void RosterSearchIndex::clear()
+{
+    keys.clear();
+    postings.clear();
+    rowCount = 0;
+    scores.clear();
+    shared.clear();
+    touched.clear();
+}
+
+bool RosterSearchIndex::isEmpty() const
+{
+    return rowCount == 0;
+}
+
+QVector<int> RosterSearchIndex::search(const QString &query) const
+{
+    const QString needle = fold(query.trimmed());
+    if (needle.isEmpty() || rowCount == 0) return {};
+    TRACE_SCOPE("roster", "RosterSearchIndex::search");
+
+    auto offer = [this](int row, int score) {
+        if (scores[row] == 0) touched.append(row);
+        scores[row] = std::max(scores[row], score);
+    };
+
+    // Prefix hits are one contiguous run of the sorted keys.
+    auto it = std::lower_bound(keys.cbegin(), keys.cend(), needle,
+                               [](const Key &key, const QString &text) { return key.text < text; });
+    for (; it != keys.cend() && it->text.startsWith(needle); ++it) {
+        // A whole name or dialplan typed out beats every prefix.
+        const bool whole = it->text.size() == needle.size() && it->score != kWordPrefixScore;
+        offer(it->row, whole ? kExactScore : it->score);
+    }
+
+    if (needle.size() >= 3) {
+        QVector<quint64> grams;
+        for (qsizetype i = 0; i + 3 <= needle.size(); ++i) {
+            const quint64 gram = trigram(needle.constData() + i);
+            if (!grams.contains(gram)) grams.append(gram);
+        }
+
+        QVector<int> candidates;
+        for (quint64 gram : std::as_const(grams)) {
+            const auto posting = postings.constFind(gram);
+            if (posting == postings.cend()) continue;
+            for (int row : *posting) {
+                if (shared[row]++ == 0) candidates.append(row);
+            }
+        }
+
+        const int needed = std::max<int>(1, int(grams.size() + 1) / 2);
+        for (int row : std::as_const(candidates)) {
+            if (shared[row] >= needed) {
+                offer(row, kFuzzyBaseScore + kFuzzyRangeScore * shared[row] / int(grams.size()));
+            }
+            shared[row] = 0;
+        }
+    }
+
+    std::sort(touched.begin(), touched.end(), [this](int a, int b) {
+        return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+    });
+    QVector<int> result = touched;
+    for (int row : std::as_const(touched)) {
+        scores[row] = 0;
+    }
+    touched.clear();
+    return result;
+}
@@ -0,0 +1,48 @@
+//rostersearchindex.h
+#ifndef ROSTERSEARCHINDEX_H
+#define ROSTERSEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "rostermodel.h"
+
+// Search structure over roster names and dialplans, built once per
+// membership change so each keystroke only walks the entries it matches.
+// Prefixes of the name, of each word in the name and of the dialplan are
+// found by binary search over sorted keys; from three characters on,
+// entries sharing at least half the query's trigrams match as well, which
+// covers substrings and small typos. Results come back best first: exact,
+// name prefix, word prefix, then by trigram overlap, ties in roster order.
+class RosterSearchIndex
+{
+public:
+    void build(const QVector<RosterEntry> &entries);
+    void clear();
+    bool isEmpty() const;
+
+    // Row numbers of the entries the query matches, ranked.
+    QVector<int> search(const QString &query) const;
+
+private:
+    struct Key {
+        QString text;
+        int row;
+        int score;  // rank of a prefix hit on this key
+    };
+
+    static QString fold(const QString &text);
+    static quint64 trigram(const QChar *chars);
+    void addTrigrams(const QString &text, int row);
+
+    QVector<Key> keys;  // sorted by text
+    QHash<quint64, QVector<int>> postings;  // trigram -> rows, ascending
+    int rowCount = 0;
+
+    // Scratch space reused between searches.
+    mutable QVector<int> scores;
+    mutable QVector<quint16> shared;
+    mutable QVector<int> touched;
+};
+
+#endif // ROSTERSEARCHINDEX_H
@@ -0,0 +1,189 @@
+//rosterupdatescheduler.cpp
+#include "rosterupdatescheduler.h"
+#include "metrics.h"
+#include "tracer.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QScrollBar>
+#include <QAbstractProxyModel>
+#include <algorithm>
+
+namespace {
+
+const int kDefaultFrameMs = 16;
+// How often the off-screen pass checks its time budget.
+const int kBudgetCheckInterval = 256;
+
+} // namespace
+
+RosterUpdateScheduler::RosterUpdateScheduler(RosterModel *model, QAbstractItemView *view, const QString &account,
+                                             QObject *parent)
+    : QObject(parent), model(model), view(view),
+      rosterSize(Metrics::gauge(QString("voip_roster_size{account=\"%1\"}").arg(Metrics::labelValue(account)),
+                                "Clients in the last roster snapshot."))
+{
+    frameTimer.setSingleShot(true);
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, &QTimer::timeout, this, &RosterUpdateScheduler::onFrame);
+
+    // Rows scrolled into view jump the queue on the next frame.
+    if (view) {
+        connect(view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() {
+            if (!pending.isEmpty()) schedule();
+        });
+    }
+}
+
+void RosterUpdateScheduler::submitSnapshot(const QList<RosterEntry> &entries)
+{
+    // The snapshot is newer than any single change still waiting.
+    snapshot = entries;
+    hasSnapshot = true;
+    pending.clear();
+    schedule();
+}
+
+void RosterUpdateScheduler::submitChange(const QString &name, const QString &status)
+{
+    pending.insert(name, status);
+    schedule();
+}
+
+void RosterUpdateScheduler::clear()
+{
+    frameTimer.stop();
+    snapshot.clear();
+    hasSnapshot = false;
+    pending.clear();
+}
+
+int RosterUpdateScheduler::pendingCount() const
+{
+    return int(pending.size()) + (hasSnapshot ? int(snapshot.size()) : 0);
+}
+
+int RosterUpdateScheduler::frameIntervalMs() const
+{
+    const QScreen *screen = view ? view->screen() : QGuiApplication::primaryScreen();
+    const qreal rate = screen ? screen->refreshRate() : 0.0;
+    return rate >= 1.0 ? std::max(1, int(1000.0 / rate)) : kDefaultFrameMs;
+}
+
+void RosterUpdateScheduler::schedule()
+{
+    if (frameTimer.isActive()) return;
+
+    // Right away if a frame has passed since the last apply, otherwise at
+    // the next frame boundary.
+    const int interval = frameIntervalMs();
+    const qint64 since = lastFrame.isValid() ? lastFrame.elapsed() : interval;
+    frameTimer.start(int(std::max<qint64>(0, interval - since)));
+}
+
+QVector<int> RosterUpdateScheduler::visibleRows(const RosterModel *model, const QAbstractItemView *view, int margin)
+{
+    // View rows are mapped back through the proxies (filter, grouping) to
+    // model rows.
+    QVector<int> rows;
+    if (!view || !view->isVisible() || !model) return rows;
+
+    const QRect area = view->viewport()->rect();
+    const QModelIndex top = view->indexAt(area.topLeft());
+    if (!top.isValid()) return rows;
+    const QModelIndex bottom = view->indexAt(QPoint(area.left(), area.bottom()));
+    const QAbstractItemModel *shown = view->model();
+    const int first = std::max(0, top.row() - margin);
+    const int last = std::min(shown->rowCount() - 1, (bottom.isValid() ? bottom.row() : shown->rowCount() - 1) + margin);
+
+    for (int row = first; row <= last; ++row) {
+        QModelIndex index = shown->index(row, 0);
+        while (index.isValid() && index.model() != model) {
+            const auto *proxy = qobject_cast<const QAbstractProxyModel *>(index.model());
+            index = proxy ? proxy->mapToSource(index) : QModelIndex();
+        }
+        // Section headers have no model row.
+        if (index.isValid()) rows.append(index.row());
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+void RosterUpdateScheduler::applyRows(QList<int> &rows)
+{
+    // One dataChanged() per contiguous run of rows.
+    if (rows.isEmpty()) return;
+    std::sort(rows.begin(), rows.end());
+    int runStart = rows.first();
+    int runEnd = runStart;
+    for (qsizetype i = 1; i < rows.size(); ++i) {
+        if (rows[i] == runEnd + 1) {
+            runEnd = rows[i];
+            continue;
+        }
+        model->notifyRowsChanged(runStart, runEnd);
+        runStart = runEnd = rows[i];
+    }
+    model->notifyRowsChanged(runStart, runEnd);
+    rows.clear();
+}
+
+void RosterUpdateScheduler::onFrame()
+{
+    if (!model) return;
+    TRACE_SCOPE("roster", "RosterUpdateScheduler::onFrame");
+    static MetricSummary &refreshTime = Metrics::summary("voip_roster_refresh_seconds", "Time to apply a roster snapshot.");
+
+    lastFrame.start();
+    QElapsedTimer budget;
+    budget.start();
+
+    if (hasSnapshot) {
+        if (model->sameMembers(snapshot)) {
+            // Anything already pending was submitted after the snapshot and
+            // wins over it.
+            for (int row = 0; row < snapshot.size(); ++row) {
+                if (model->statusAt(row) != snapshot[row].status && !pending.contains(snapshot[row].name)) {
+                    pending.insert(snapshot[row].name, snapshot[row].status);
+                }
+            }
+        } else {
+            // Membership changed: nothing to defer, the rows themselves move.
+            model->reset(snapshot);
+        }
+        rosterSize.set(snapshot.size());
+        snapshot.clear();
+        hasSnapshot = false;
+    }
+
+    const QVector<int> visible = visibleRows(model, view);
+
+    QList<int> changed;
+    for (auto it = pending.begin(); it != pending.end();) {
+        const int row = model->rowOf(it.key());
+        if (row < 0) {
+            it = pending.erase(it);
+        } else if (std::binary_search(visible.cbegin(), visible.cend(), row)) {
+            if (model->setStatus(it.key(), it.value()) >= 0) changed.append(row);
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    applyRows(changed);
+
+    int checked = 0;
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (++checked % kBudgetCheckInterval == 0 && budget.nsecsElapsed() / 1000 > OFFSCREEN_BUDGET_US) {
+            break;
+        }
+        const int row = model->setStatus(it.key(), it.value());
+        if (row >= 0) changed.append(row);
+        it = pending.erase(it);
+    }
+    applyRows(changed);
+
+    refreshTime.observeUs(budget.nsecsElapsed() / 1000);
+    if (!pending.isEmpty()) {
+        schedule();
+    }
+}
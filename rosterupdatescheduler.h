@@ -0,0 +1,66 @@
+//rosterupdatescheduler.h
+#ifndef ROSTERUPDATESCHEDULER_H
+#define ROSTERUPDATESCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QAbstractItemView>
+#include "rostermodel.h"
+#include "metrics.h"
+
+// Collects presence updates and applies them to the roster model at most
+// once per display frame. Between frames a newer snapshot replaces an
+// older one and a newer status for a user replaces the older one, so a
+// storm of updates costs one model update per frame. Rows on screen are
+// applied first; changes to off-screen rows get what is left of
+// OFFSCREEN_BUDGET_US each frame and carry over to the next one.
+class RosterUpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    // account is AccountData::id(), used as the metrics label.
+    RosterUpdateScheduler(RosterModel *model, QAbstractItemView *view, const QString &account,
+                          QObject *parent = nullptr);
+
+    // Full roster as sent by the server.
+    void submitSnapshot(const QList<RosterEntry> &entries);
+    // A single status change.
+    void submitChange(const QString &name, const QString &status);
+    // Drops everything pending, e.g. on disconnect.
+    void clear();
+
+    int pendingCount() const;
+
+    // Model rows shown in view, plus margin view rows above and below,
+    // sorted. The view may show the model through proxies.
+    static QVector<int> visibleRows(const RosterModel *model, const QAbstractItemView *view, int margin = 0);
+
+private slots:
+    void onFrame();
+
+private:
+    void schedule();
+    int frameIntervalMs() const;
+    void applyRows(QList<int> &rows);
+
+    QPointer<RosterModel> model;
+    QPointer<QAbstractItemView> view;
+
+    QList<RosterEntry> snapshot;
+    bool hasSnapshot = false;
+    QHash<QString, QString> pending;
+
+    QTimer frameTimer;
+    QElapsedTimer lastFrame;
+    MetricGauge &rosterSize;
+
+    static const int OFFSCREEN_BUDGET_US = 4000;
+};
+
+#endif // ROSTERUPDATESCHEDULER_H
@@ -0,0 +1,155 @@
+//socketframequeue.cpp
+#include "socketframequeue.h"
+#include "metrics.h"
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+const char *const kChannelNames[] = {"signaling", "chat", "background", "bulk"};
+const int kBulkChannel = 3;
+
+} // namespace
+
+SocketFrameQueue::SocketFrameQueue(QWebSocket *socket, const QString &account, QObject *parent)
+    : QObject(parent), socket(socket), backgroundTokens(BACKGROUND_BURST), flushTimer(this)
+{
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &SocketFrameQueue::flush);
+
+    if (socket) {
+        connect(socket, &QWebSocket::bytesWritten, this, &SocketFrameQueue::onBytesWritten);
+        connect(socket, &QWebSocket::connected, this, &SocketFrameQueue::flush);
+        connect(socket, &QWebSocket::disconnected, this, &SocketFrameQueue::onDisconnected);
+    }
+    tokenClock.start();
+
+    for (int channel = 0; channel < CHANNELS; ++channel) {
+        const QString labels = QString("{account=\"%1\",channel=\"%2\",direction=\"out\"}")
+                                   .arg(Metrics::labelValue(account), QString::fromLatin1(kChannelNames[channel]));
+        framesSent[channel] = &Metrics::counter("voip_ws_frames_total" + labels, "WebSocket frames by channel and direction.");
+        bytesSent[channel] = &Metrics::counter("voip_ws_bytes_total" + labels, "WebSocket payload bytes by channel and direction.");
+    }
+}
+
+void SocketFrameQueue::enqueue(Priority priority, const QString &frame)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, priority, frame]() { enqueue(priority, frame); });
+        return;
+    }
+    if (priority == Background) {
+        enqueueCoalesced(QString("#%1").arg(++backgroundSequence), frame);
+        return;
+    }
+    urgent[priority].enqueue(frame);
+    scheduleFlush(0);
+}
+
+void SocketFrameQueue::enqueueCoalesced(const QString &key, const QString &frame)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, key, frame]() { enqueueCoalesced(key, frame); });
+        return;
+    }
+    if (!background.contains(key)) {
+        backgroundOrder.append(key);
+    }
+    background.insert(key, frame);
+    scheduleFlush(0);
+}
+
+void SocketFrameQueue::enqueueBinary(const QByteArray &frame)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, frame]() { enqueueBinary(frame); });
+        return;
+    }
+    bulk.enqueue(frame);
+    scheduleFlush(0);
+}
+
+int SocketFrameQueue::pendingCount(Priority priority) const
+{
+    return priority == Background ? int(background.size()) : int(urgent[priority].size());
+}
+
+bool SocketFrameQueue::socketReady() const
+{
+    return socket && socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void SocketFrameQueue::scheduleFlush(int delayMs)
+{
+    if (!flushTimer.isActive() || flushTimer.remainingTime() > delayMs) {
+        flushTimer.start(delayMs);
+    }
+}
+
+void SocketFrameQueue::send(int channel, const QString &frame)
+{
+    const qint64 bytes = socket->sendTextMessage(frame);
+    textInFlight += bytes;
+    framesSent[channel]->add();
+    bytesSent[channel]->add(bytes);
+}
+
+void SocketFrameQueue::flush()
+{
+    if (!socketReady()) return;
+
+    for (int priority = Signaling; priority <= Chat; ++priority) {
+        while (!urgent[priority].isEmpty()) {
+            send(priority, urgent[priority].dequeue());
+        }
+    }
+
+    if (!backgroundOrder.isEmpty()) {
+        // Refill the token bucket for low-priority frames.
+        const qint64 elapsed = tokenClock.restart();
+        backgroundTokens = std::min<double>(BACKGROUND_BURST,
+                                            backgroundTokens + elapsed * BACKGROUND_RATE_PER_SECOND / 1000.0);
+
+        while (!backgroundOrder.isEmpty()
+               && backgroundTokens >= 1.0
+               && textInFlight < BACKGROUND_WATERMARK_BYTES) {
+            const QString key = backgroundOrder.takeFirst();
+            send(Background, background.take(key));
+            backgroundTokens -= 1.0;
+        }
+
+        if (!backgroundOrder.isEmpty()) {
+            scheduleFlush(1000 / BACKGROUND_RATE_PER_SECOND);
+        }
+    }
+
+    while (!bulk.isEmpty() && textInFlight + bulkInFlight < BULK_WATERMARK_BYTES) {
+        const qint64 bytes = socket->sendBinaryMessage(bulk.dequeue());
+        bulkInFlight += bytes;
+        framesSent[kBulkChannel]->add();
+        bytesSent[kBulkChannel]->add(bytes);
+    }
+}
+
+void SocketFrameQueue::onBytesWritten(qint64 bytes)
+{
+    const qint64 text = std::min(textInFlight, bytes);
+    textInFlight -= text;
+    bulkInFlight = std::max<qint64>(0, bulkInFlight - (bytes - text));
+
+    if ((!backgroundOrder.isEmpty() && textInFlight < BACKGROUND_WATERMARK_BYTES)
+        || (!bulk.isEmpty() && textInFlight + bulkInFlight < BULK_WATERMARK_BYTES)) {
+        scheduleFlush(0);
+    }
+}
+
+void SocketFrameQueue::onDisconnected()
+{
+    // Typing state and receipts are stale by the time we reconnect, and
+    // file transfers resume from the server's acknowledged offset.
+    background.clear();
+    backgroundOrder.clear();
+    bulk.clear();
+    textInFlight = 0;
+    bulkInFlight = 0;
+}
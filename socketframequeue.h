@@ -0,0 +1,83 @@
+//socketframequeue.h
+#ifndef SOCKETFRAMEQUEUE_H
+#define SOCKETFRAMEQUEUE_H
+
+#include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QWebSocket>
+
+class MetricCounter;
+
+// Single outbound path for frames on the shared WebSocket. Signaling
+// and chat frames go out in priority order as soon as the socket allows.
+// Background frames (typing, read receipts) are keyed and coalesced, so
+// only the newest frame per key is kept, and they are sent only when nothing
+// more important is waiting and little text is still unacknowledged by
+// the socket, at a bounded rate. Binary bulk frames (file chunks) go last
+// and only while the socket has less than BULK_WATERMARK_BYTES queued.
+// The enqueue calls may be made from any thread and are forwarded to the
+// thread the queue lives on; pendingCount() is only meaningful there.
+class SocketFrameQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Signaling = 0,
+        Chat = 1,
+        Background = 2
+    };
+
+    // account labels the frame metrics (AccountData::id()).
+    SocketFrameQueue(QWebSocket *socket, const QString &account, QObject *parent = nullptr);
+
+    void enqueue(Priority priority, const QString &frame);
+    void enqueueCoalesced(const QString &key, const QString &frame);
+    void enqueueBinary(const QByteArray &frame);
+    int pendingCount(Priority priority) const;
+
+public slots:
+    void flush();
+
+private slots:
+    void onBytesWritten(qint64 bytes);
+    void onDisconnected();
+
+private:
+    bool socketReady() const;
+    void scheduleFlush(int delayMs);
+    void send(int channel, const QString &frame);
+
+    QPointer<QWebSocket> socket;
+    QQueue<QString> urgent[2];
+    QHash<QString, QString> background;
+    QStringList backgroundOrder;
+    quint64 backgroundSequence = 0;
+    QQueue<QByteArray> bulk;
+
+    // Text is always flushed ahead of bulk data, so written bytes are
+    // credited to text first; both figures are estimates.
+    qint64 textInFlight = 0;
+    qint64 bulkInFlight = 0;
+    double backgroundTokens;
+    QElapsedTimer tokenClock;
+    QTimer flushTimer;
+
+    // Per channel: the three priorities, then bulk.
+    static const int CHANNELS = 4;
+    MetricCounter *framesSent[CHANNELS];
+    MetricCounter *bytesSent[CHANNELS];
+
+    static const int BACKGROUND_RATE_PER_SECOND = 5;
+    static const int BACKGROUND_BURST = 5;
+    static const int BACKGROUND_WATERMARK_BYTES = 16 * 1024;
+    static const int BULK_WATERMARK_BYTES = 512 * 1024;
+};
+
+#endif // SOCKETFRAMEQUEUE_H
@@ -0,0 +1,81 @@
+//spscringbuffer.h
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Fixed-capacity single-producer/single-consumer ring. push() and pop()
+// never block or allocate, so the producer can be a real-time audio
+// callback. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRingBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer needs trivially copyable T");
+
+public:
+    explicit SpscRingBuffer(size_t minCapacity)
+    {
+        size_t capacity = 1;
+        while (capacity < minCapacity) capacity <<= 1;
+        storage.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    size_t capacity() const { return storage.size(); }
+
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Producer side. Returns how many items fit; the rest are dropped.
+    size_t push(const T *items, size_t count)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_acquire);
+        const size_t n = std::min(count, storage.size() - (h - t));
+        copyIn(h, items, n);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side. Returns how many items were copied out.
+    size_t pop(T *items, size_t count)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t h = head.load(std::memory_order_acquire);
+        const size_t n = std::min(count, h - t);
+        copyOut(t, items, n);
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    void copyIn(size_t position, const T *items, size_t n)
+    {
+        const size_t start = position & mask;
+        const size_t first = std::min(n, storage.size() - start);
+        std::memcpy(storage.data() + start, items, first * sizeof(T));
+        std::memcpy(storage.data(), items + first, (n - first) * sizeof(T));
+    }
+
+    void copyOut(size_t position, T *items, size_t n) const
+    {
+        const size_t start = position & mask;
+        const size_t first = std::min(n, storage.size() - start);
+        std::memcpy(items, storage.data() + start, first * sizeof(T));
+        std::memcpy(items + first, storage.data(), (n - first) * sizeof(T));
+    }
+
+    std::vector<T> storage;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif // SPSCRINGBUFFER_H
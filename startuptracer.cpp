@@ -0,0 +1,35 @@
+//startuptracer.cpp
+#include "startuptracer.h"
+
+namespace {
+
+QString &outputPath()
+{
+    static QString path;
+    return path;
+}
+
+} // namespace
+
+void StartupTracer::enable(const QString &path)
+{
+    outputPath() = path;
+    Tracer::setEnabled(true);
+}
+
+bool StartupTracer::isEnabled()
+{
+    return !outputPath().isEmpty() && Tracer::isEnabled();
+}
+
+void StartupTracer::mark(const char *name)
+{
+    if (!isEnabled()) return;
+    Tracer::instant("startup", name);
+}
+
+void StartupTracer::flush()
+{
+    if (!isEnabled()) return;
+    Tracer::dump(outputPath());
+}
@@ -0,0 +1,29 @@
+//startuptracer.h
+#ifndef STARTUPTRACER_H
+#define STARTUPTRACER_H
+
+#include <QString>
+#include "tracer.h"
+
+// Startup view of Tracer: phases go into the "startup" category and
+// flush() writes the trace to the file given to enable(), which main()
+// does for --trace-startup. When off a Phase costs one branch.
+class StartupTracer
+{
+public:
+    static void enable(const QString &outputPath);
+    static bool isEnabled();
+
+    // Instant marker, e.g. "first paint".
+    static void mark(const char *name);
+    // Writes everything recorded so far; may be called more than once.
+    static void flush();
+
+    class Phase : public Tracer::Span
+    {
+    public:
+        explicit Phase(const char *name) : Tracer::Span("startup", name) {}
+    };
+};
+
+#endif // STARTUPTRACER_H
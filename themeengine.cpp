@@ -0,0 +1,183 @@
+//themeengine.cpp
+#include "themeengine.h"
+#include "tracer.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPainterPath>
+#include <QProxyStyle>
+#include <QStyleFactory>
+#include <QStyleOption>
+
+namespace {
+
+const char kThemeProperty[] = "themeDark";
+const int kEmojiPixelSize = 16;
+
+QPalette buildPalette(bool dark)
+{
+    // Same colours the old per-window stylesheets used.
+    const QColor window = dark ? QColor("#1E2922") : QColor("#E0E3DE");
+    const QColor text = dark ? QColor("#E0E3DE") : QColor("#2F3E2C");
+    const QColor base = dark ? QColor("#2A362F") : QColor("#FFFFFF");
+    const QColor button = dark ? QColor("#3F4A3C") : QColor("#4A5D45");
+    const QColor hover = dark ? QColor("#4A5D45") : QColor("#5B705A");
+    const QColor buttonBorder("#2F3E2C");
+    const QColor frame = dark ? QColor("#3F4A3C") : QColor("#A3A69F");
+
+    QPalette palette;
+    palette.setColor(QPalette::Window, window);
+    palette.setColor(QPalette::WindowText, text);
+    palette.setColor(QPalette::Base, base);
+    palette.setColor(QPalette::AlternateBase, window);
+    palette.setColor(QPalette::Text, text);
+    palette.setColor(QPalette::PlaceholderText, frame);
+    palette.setColor(QPalette::ToolTipBase, base);
+    palette.setColor(QPalette::ToolTipText, text);
+    palette.setColor(QPalette::Button, button);
+    palette.setColor(QPalette::ButtonText, Qt::white);
+    palette.setColor(QPalette::BrightText, Qt::white);
+    palette.setColor(QPalette::Light, hover);
+    palette.setColor(QPalette::Midlight, hover);
+    palette.setColor(QPalette::Mid, frame);
+    palette.setColor(QPalette::Dark, buttonBorder);
+    palette.setColor(QPalette::Shadow, buttonBorder);
+    palette.setColor(QPalette::Highlight, hover);
+    palette.setColor(QPalette::HighlightedText, Qt::white);
+    palette.setColor(QPalette::Link, hover);
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, frame);
+    palette.setColor(QPalette::Disabled, QPalette::Text, frame);
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, frame);
+    return palette;
+}
+
+// Rounded buttons and input frames in palette colours, on top of Fusion.
+class ThemeStyle : public QProxyStyle
+{
+public:
+    ThemeStyle() : QProxyStyle(QStyleFactory::create("Fusion"))
+    {
+        setObjectName("ThemeStyle");
+    }
+
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option,
+                       QPainter *painter, const QWidget *widget) const override
+    {
+        switch (element) {
+        case PE_PanelButtonCommand: {
+            const bool hovered = option->state & State_MouseOver;
+            const bool sunken = option->state & (State_Sunken | State_On);
+            QColor fill = option->palette.color(QPalette::Button);
+            if (sunken) fill = option->palette.color(QPalette::Dark);
+            else if (hovered) fill = option->palette.color(QPalette::Light);
+            drawRounded(painter, option->rect, fill, option->palette.color(QPalette::Dark));
+            return;
+        }
+        case PE_FrameLineEdit:
+        case PE_Frame:
+            drawRounded(painter, option->rect, Qt::transparent, option->palette.color(QPalette::Mid));
+            return;
+        case PE_PanelLineEdit:
+            drawRounded(painter, option->rect, option->palette.color(QPalette::Base),
+                        option->palette.color(QPalette::Mid));
+            return;
+        default:
+            QProxyStyle::drawPrimitive(element, option, painter, widget);
+        }
+    }
+
+    int pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const override
+    {
+        if (metric == PM_ButtonMargin) return 10;
+        return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+
+    void polish(QWidget *widget) override
+    {
+        QProxyStyle::polish(widget);
+        // Needed for the hover colour on buttons.
+        if (widget->inherits("QAbstractButton")) {
+            widget->setAttribute(Qt::WA_Hover);
+        }
+    }
+
+private:
+    static void drawRounded(QPainter *painter, const QRect &rect, const QColor &fill, const QColor &border)
+    {
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        QPainterPath path;
+        path.addRoundedRect(QRectF(rect).adjusted(0.5, 0.5, -0.5, -0.5),
+                            ThemeEngine::CORNER_RADIUS, ThemeEngine::CORNER_RADIUS);
+        painter->fillPath(path, fill);
+        painter->setPen(border);
+        painter->drawPath(path);
+        painter->restore();
+    }
+};
+
+} // namespace
+
+void ThemeEngine::install()
+{
+    if (QApplication::style()->objectName() != "ThemeStyle") {
+        QApplication::setStyle(new ThemeStyle);
+    }
+}
+
+const QPalette &ThemeEngine::palette(bool dark)
+{
+    static const QPalette light = buildPalette(false);
+    static const QPalette darkPalette = buildPalette(true);
+    return dark ? darkPalette : light;
+}
+
+bool ThemeEngine::isApplied(const QWidget *widget, bool dark)
+{
+    const QVariant applied = widget->property(kThemeProperty);
+    return applied.isValid() && applied.toBool() == dark;
+}
+
+void ThemeEngine::apply(QWidget *widget, bool dark)
+{
+    if (!widget || isApplied(widget, dark)) return;
+    TRACE_SCOPE("theme", "ThemeEngine::apply");
+
+    // A complete palette on the widget also stops palette propagation from
+    // its parent, so hidden views cost nothing until they are applied.
+    widget->setPalette(palette(dark));
+    widget->setAutoFillBackground(true);
+    widget->setProperty(kThemeProperty, dark);
+}
+
+void ThemeEngine::applyStatusIndicator(QWidget *indicator, bool online)
+{
+    // A mask instead of border-radius keeps the dot round at any size.
+    QPalette palette = indicator->palette();
+    palette.setColor(QPalette::Window, online ? QColor(Qt::green) : QColor(Qt::red));
+    indicator->setPalette(palette);
+    indicator->setAutoFillBackground(true);
+    indicator->setMask(QRegion(indicator->rect(), QRegion::Ellipse));
+}
+
+void ThemeEngine::applyErrorText(QWidget *label)
+{
+    QPalette palette = label->palette();
+    palette.setColor(QPalette::WindowText, Qt::red);
+    label->setPalette(palette);
+}
+
+void ThemeEngine::applyEmojiButton(QWidget *button)
+{
+    // Light tiles in either theme; ThemeStyle draws the rounded frame and
+    // uses Light for hover.
+    QPalette palette = button->palette();
+    palette.setColor(QPalette::Button, Qt::white);
+    palette.setColor(QPalette::ButtonText, Qt::black);
+    palette.setColor(QPalette::Dark, QColor("#cccccc"));
+    palette.setColor(QPalette::Light, QColor("#e0e0e0"));
+    button->setPalette(palette);
+
+    QFont font = button->font();
+    font.setPixelSize(kEmojiPixelSize);
+    button->setFont(font);
+}
@@ -0,0 +1,30 @@
+//themeengine.h
+#ifndef THEMEENGINE_H
+#define THEMEENGINE_H
+
+#include <QPalette>
+#include <QWidget>
+
+// Light and dark themes as prebuilt palettes drawn by one application-wide
+// proxy style, so switching never parses or re-polishes a stylesheet.
+// apply() only touches the given subtree; a top-level view that is hidden
+// can keep its old palette and be brought up to date when it is shown.
+class ThemeEngine
+{
+public:
+    // Installs the theme style on the application. Safe to call repeatedly.
+    static void install();
+
+    static const QPalette &palette(bool dark);
+    static void apply(QWidget *widget, bool dark);
+    static bool isApplied(const QWidget *widget, bool dark);
+
+    // Fixed-colour widgets that used to carry their own stylesheet.
+    static void applyStatusIndicator(QWidget *indicator, bool online);
+    static void applyErrorText(QWidget *label);
+    static void applyEmojiButton(QWidget *button);
+
+    static const int CORNER_RADIUS = 4;
+};
+
+#endif // THEMEENGINE_H
@@ -0,0 +1,135 @@
+//thumbnailpipeline.cpp
+#include "thumbnailpipeline.h"
+#include "tracer.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// A file saved over in place gets a new key, so neither cache level can
+// hand back the old picture.
+QString identityKey(const QFileInfo &info)
+{
+    return QString("%1|%2|%3").arg(info.absoluteFilePath())
+        .arg(info.size())
+        .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QString diskKey(const QString &identity)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+QImage buildThumbnail(const QString &filePath, const QString &identity, const QString &cacheDir, int edge)
+{
+    const QString cached = cacheDir.isEmpty() ? QString()
+                                              : QDir(cacheDir).filePath(diskKey(identity) + ".png");
+    if (!cached.isEmpty()) {
+        QImage image(cached);
+        if (!image.isNull()) return image;
+    }
+
+    QImageReader reader(filePath);
+    reader.setAutoTransform(true);
+
+    // Let the codec decode at the target size (JPEG scales by DCT) instead
+    // of materialising the full photo first.
+    QSize size = reader.size();
+    if (size.isValid() && (size.width() > edge || size.height() > edge)) {
+        size.scale(edge, edge, Qt::KeepAspectRatio);
+        reader.setScaledSize(size);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Failed to decode image preview:" << filePath << reader.errorString();
+        return image;
+    }
+    if (image.width() > edge || image.height() > edge) {
+        image = image.scaled(edge, edge, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    if (!cached.isEmpty() && !image.save(cached, "PNG")) {
+        qWarning() << "Failed to write thumbnail:" << cached;
+    }
+    return image;
+}
+
+} // namespace
+
+ThumbnailPipeline::ThumbnailPipeline(QObject *parent)
+    : QObject(parent)
+{
+    // Leave cores for audio and the GUI; previews are never urgent.
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    pool.setThreadPriority(QThread::LowPriority);
+    memory.setMaxCost(MEMORY_CACHE_BYTES);
+
+    const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheLocation.isEmpty()) {
+        qWarning() << "Failed to get writable location";
+        return;
+    }
+    QDir dir(cacheLocation);
+    if (!dir.mkpath("thumbnails")) {
+        qWarning() << "Failed to create directory:" << dir.filePath("thumbnails");
+        return;
+    }
+    diskPath = dir.filePath("thumbnails");
+}
+
+ThumbnailPipeline::~ThumbnailPipeline()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+bool ThumbnailPipeline::isImageFile(const QString &filePath)
+{
+    static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+    return formats.contains(QFileInfo(filePath).suffix().toLower().toLatin1());
+}
+
+bool ThumbnailPipeline::request(const QString &filePath, QImage *image)
+{
+    const QString identity = identityKey(QFileInfo(filePath));
+    if (const QImage *cached = memory.object(identity)) {
+        *image = *cached;
+        return true;
+    }
+    if (pending.contains(filePath)) return false;
+
+    pending.insert(filePath);
+    const QString cacheDir = diskPath;
+    // The destructor waits for the pool, so this outlives every job; a
+    // queued call to a deleted receiver is dropped.
+    pool.start([this, filePath, identity, cacheDir]() {
+        QImage thumbnail;
+        {
+            TRACE_SCOPE("thumbnail", "ThumbnailPipeline::build");
+            thumbnail = buildThumbnail(filePath, identity, cacheDir, THUMBNAIL_EDGE);
+        }
+        QMetaObject::invokeMethod(this, [this, filePath, identity, thumbnail]() {
+            onJobFinished(filePath, identity, thumbnail);
+        }, Qt::QueuedConnection);
+    });
+    return false;
+}
+
+void ThumbnailPipeline::onJobFinished(const QString &filePath, const QString &identity, const QImage &image)
+{
+    pending.remove(filePath);
+    if (image.isNull()) {
+        emit thumbnailFailed(filePath);
+        return;
+    }
+
+    memory.insert(identity, new QImage(image), std::max<qsizetype>(1, image.sizeInBytes()));
+    emit thumbnailReady(filePath, image);
+}
@@ -0,0 +1,47 @@
+//thumbnailpipeline.h
+#ifndef THUMBNAILPIPELINE_H
+#define THUMBNAILPIPELINE_H
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+// Builds chat previews for image attachments on a private thread pool.
+// Images are decoded at thumbnail scale where the codec supports it and
+// kept in two levels: an in-memory LRU bounded by MEMORY_CACHE_BYTES and
+// small files under <Cache>/thumbnails keyed by path, size and mtime, so a
+// photo is only ever decoded in full once.
+class ThumbnailPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailPipeline(QObject *parent = nullptr);
+    ~ThumbnailPipeline();
+
+    static bool isImageFile(const QString &filePath);
+
+    // Returns true and fills image if the thumbnail is in memory; otherwise
+    // queues it and thumbnailReady or thumbnailFailed follows.
+    bool request(const QString &filePath, QImage *image);
+
+    static const int THUMBNAIL_EDGE = 240;
+    static const int MEMORY_CACHE_BYTES = 32 * 1024 * 1024;
+
+signals:
+    void thumbnailReady(const QString &filePath, const QImage &image);
+    void thumbnailFailed(const QString &filePath);
+
+private:
+    void onJobFinished(const QString &filePath, const QString &identity, const QImage &image);
+
+    QThreadPool pool;
+    QCache<QString, QImage> memory;  // keyed by path, size and mtime
+    QSet<QString> pending;
+    QString diskPath;
+};
+
+#endif // THUMBNAILPIPELINE_H
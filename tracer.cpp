@@ -0,0 +1,215 @@
+//tracer.cpp
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// 8192 events of 40 bytes: about 320 KB per recording thread.
+const quint64 kRingEvents = 8192;
+const quint64 kRingMask = kRingEvents - 1;
+
+struct Event {
+    const char *category;
+    const char *name;
+    qint64 timestampUs;
+    qint64 value;  // duration for 'X', sample for 'C'
+    int thread;
+    char phase;
+};
+
+struct ThreadBuffer {
+    std::atomic<quint64> head{0};
+    std::atomic<bool> inUse{false};
+    Event events[kRingEvents];
+};
+
+// Buffers outlive their threads so a dump still shows work done by threads
+// that have exited; a new thread takes over a free buffer before a new one
+// is allocated, which keeps pool threads that come and go bounded.
+struct Registry {
+    QMutex mutex;
+    QVector<ThreadBuffer *> buffers;
+    QHash<int, QString> threadNames;
+    int nextThread = 1;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point &epoch()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+struct ThreadSlot {
+    ThreadBuffer *buffer = nullptr;
+    int thread = 0;
+
+    ~ThreadSlot()
+    {
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadSlot slot;
+
+void attachThread()
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    for (ThreadBuffer *buffer : std::as_const(r.buffers)) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            slot.buffer = buffer;
+            break;
+        }
+    }
+    if (!slot.buffer) {
+        slot.buffer = new ThreadBuffer;
+        slot.buffer->inUse.store(true, std::memory_order_relaxed);
+        r.buffers.append(slot.buffer);
+    }
+
+    // Threads are labelled by QThread::objectName() in the viewer.
+    slot.thread = r.nextThread++;
+    QThread *thread = QThread::currentThread();
+    QString name = thread ? thread->objectName() : QString();
+    if (name.isEmpty()) {
+        const QCoreApplication *app = QCoreApplication::instance();
+        name = (app && thread == app->thread()) ? QString("main") : QString("thread %1").arg(slot.thread);
+    }
+    r.threadNames.insert(slot.thread, name);
+}
+
+void record(const char *category, const char *name, char phase, qint64 timestampUs, qint64 value)
+{
+    if (!slot.buffer) {
+        attachThread();
+    }
+
+    // Single writer per buffer: fill the slot, then publish it.
+    ThreadBuffer *buffer = slot.buffer;
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head & kRingMask] = Event{category, name, timestampUs, value, slot.thread, phase};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace
+
+void Tracer::setEnabled(bool enabled)
+{
+    epoch();
+    enabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Tracer::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - epoch()).count();
+}
+
+void Tracer::complete(const char *category, const char *name, qint64 startUs, qint64 durationUs)
+{
+    record(category, name, 'X', startUs, durationUs);
+}
+
+void Tracer::instant(const char *category, const char *name)
+{
+    if (!isEnabled()) return;
+    record(category, name, 'i', nowUs(), 0);
+}
+
+void Tracer::counter(const char *category, const char *name, qint64 value)
+{
+    if (!isEnabled()) return;
+    record(category, name, 'C', nowUs(), value);
+}
+
+bool Tracer::dump(const QString &path)
+{
+    Registry &r = registry();
+    QVector<ThreadBuffer *> buffers;
+    QHash<int, QString> threadNames;
+    {
+        QMutexLocker locker(&r.mutex);
+        buffers = r.buffers;
+        threadNames = r.threadNames;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for (auto it = threadNames.cbegin(); it != threadNames.cend(); ++it) {
+        events.append(QJsonObject{{"name", "thread_name"},
+                                  {"ph", "M"},
+                                  {"pid", pid},
+                                  {"tid", it.key()},
+                                  {"args", QJsonObject{{"name", it.value()}}}});
+    }
+
+    QVector<Event> copy;
+    for (ThreadBuffer *buffer : std::as_const(buffers)) {
+        // Copy the newest events, then drop any the owner overwrote while
+        // the copy was being taken.
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 first = head > kRingEvents ? head - kRingEvents : 0;
+        copy.resize(qsizetype(head - first));
+        for (quint64 i = first; i < head; ++i) {
+            copy[qsizetype(i - first)] = buffer->events[i & kRingMask];
+        }
+        // The fence keeps the copy ahead of the second head load. The owner
+        // may already be writing slot `after` before publishing it, so that
+        // slot counts as overwritten too.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const quint64 after = buffer->head.load(std::memory_order_relaxed);
+        const quint64 overwritten = after + 1 > first + kRingEvents ? after + 1 - first - kRingEvents : 0;
+
+        for (qsizetype i = qsizetype(std::min<quint64>(overwritten, copy.size())); i < copy.size(); ++i) {
+            const Event &event = copy[i];
+            QJsonObject object{{"name", QString::fromLatin1(event.name)},
+                               {"cat", QString::fromLatin1(event.category)},
+                               {"ph", QString(QChar(event.phase))},
+                               {"ts", event.timestampUs},
+                               {"pid", pid},
+                               {"tid", event.thread}};
+            if (event.phase == 'X') {
+                object.insert("dur", event.value);
+            } else if (event.phase == 'C') {
+                object.insert("args", QJsonObject{{"value", event.value}});
+            } else {
+                object.insert("s", "t");
+            }
+            events.append(object);
+        }
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open trace file for writing:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"traceEvents", events}, {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "Failed to write trace file:" << path;
+        return false;
+    }
+    return true;
+}
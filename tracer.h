@@ -0,0 +1,72 @@
+//tracer.h
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// Process-wide event tracer that writes the Chrome trace format
+// (chrome://tracing, Perfetto). Every thread records into its own fixed
+// ring, so recording takes no lock and never allocates after a thread's
+// first event; when a ring is full the oldest events are overwritten.
+// Nothing is recorded until setEnabled(true). Use the TRACE_* macros in
+// code: building with CONFIG+=no_tracing compiles them out entirely.
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+    static qint64 nowUs();
+
+    // Names and categories must be string literals; only the pointer is kept.
+    static void complete(const char *category, const char *name, qint64 startUs, qint64 durationUs);
+    static void instant(const char *category, const char *name);
+    static void counter(const char *category, const char *name, qint64 value);
+
+    // Writes what every thread has recorded so far. Threads may keep
+    // recording while this runs.
+    static bool dump(const QString &path);
+
+    class Span
+    {
+    public:
+        Span(const char *category, const char *name)
+            : category(category), name(name), startUs(isEnabled() ? nowUs() : -1) {}
+        ~Span() { end(); }
+
+        // Ends the span before the end of its scope.
+        void end()
+        {
+            if (startUs >= 0) {
+                complete(category, name, startUs, nowUs() - startUs);
+                startUs = -1;
+            }
+        }
+
+    private:
+        const char *category;
+        const char *name;
+        qint64 startUs;
+    };
+
+private:
+    static inline std::atomic<bool> enabledFlag{false};
+};
+
+#ifdef VOIP_NO_TRACING
+#define TRACE_SCOPE(category, name) do {} while (0)
+#define TRACE_INSTANT(category, name) do {} while (0)
+#define TRACE_COUNTER(category, name, value) do {} while (0)
+#else
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) Tracer::Span TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name) \
+    do { if (Tracer::isEnabled()) Tracer::instant(category, name); } while (0)
+#define TRACE_COUNTER(category, name, value) \
+    do { if (Tracer::isEnabled()) Tracer::counter(category, name, qint64(value)); } while (0)
+#endif
+
+#endif // TRACER_H